@@ -0,0 +1,42 @@
+set(CMAKE_ARCHIVE_OUTPUT_DIRECTORY ${LIBRARY_PRODUCT_DIR}/lib)
+set(CMAKE_LIBRARY_OUTPUT_DIRECTORY ${LIBRARY_PRODUCT_DIR}/lib)
+set(CMAKE_RUNTIME_OUTPUT_DIRECTORY ${LIBRARY_PRODUCT_DIR}/bin)
+
+link_directories(${CMAKE_LIBRARY_OUTPUT_DIRECTORY})
+
+# We do not use exceptions nor RTTI
+set(CMAKE_CXX_FLAGS "${CMAKE_CXX_FLAGS} -std=c++14 -fno-exceptions -fno-rtti -pthread")
+
+add_definitions(-D__STDC_FORMAT_MACROS)
+
+macro(ADD_PREFIX_HEADER _target _header)
+    get_target_property(_old_compile_flags ${_target} COMPILE_FLAGS)
+    if (${_old_compile_flags} STREQUAL "_old_compile_flags-NOTFOUND")
+        set(_old_compile_flags "")
+    endif ()
+    set_target_properties(${_target} PROPERTIES COMPILE_FLAGS "-include ${_header} ${_old_compile_flags}")
+endmacro()
+
+macro(ADD_POST_BUILD_COMMAND _library)
+    add_custom_command(TARGET ${_library} POST_BUILD COMMAND echo Running ${_library} post build tasks... VERBATIM)
+endmacro()
+
+macro(COPY_LIBRARY_HEADERS _library _list _destination)
+    add_custom_command(TARGET ${_library} POST_BUILD COMMAND echo Copying ${_library} library headers... VERBATIM)
+    foreach (_file ${_list})
+        get_filename_component(_absolute "${_file}" ABSOLUTE)
+        add_custom_command(TARGET ${_library} POST_BUILD COMMAND mkdir -p ${LIBRARY_PRODUCT_DIR}/${_destination} && cp -u ${_absolute} ${LIBRARY_PRODUCT_DIR}/${_destination} VERBATIM)
+    endforeach ()
+endmacro()
+
+macro(COPY_LIBRARY_HEADERS_DIRECTORY _library _source _destination)
+    add_custom_command(TARGET ${_library} POST_BUILD COMMAND echo Copying ${_library} library headers... VERBATIM)
+    get_filename_component(_absolute "${_source}" ABSOLUTE)
+    add_custom_command(TARGET ${_library} POST_BUILD COMMAND mkdir -p ${LIBRARY_PRODUCT_DIR}/${_destination} && rsync -rpuL --include='*.h' --include='*.hpp' --exclude='*.*' ${_absolute}/* ${LIBRARY_PRODUCT_DIR}/${_destination})
+endmacro()
+
+# jsoncpp installs its headers under include/jsoncpp, which pkg-config knows about.
+find_package(PkgConfig REQUIRED)
+pkg_check_modules(JSONCPP REQUIRED jsoncpp)
+include_directories(${JSONCPP_INCLUDE_DIRS})
+link_directories(${JSONCPP_LIBRARY_DIRS})
@@ -128,3 +128,6 @@ if (${MSVC_CXX_ARCHITECTURE_ID} STREQUAL "X86")
 else ()
     link_directories("${LIBRARY_PRODUCT_DIR}/lib64")
 endif ()
+
+# jsoncpp is built into the library product directory.
+set(JSONCPP_LIBRARIES jsoncpp)
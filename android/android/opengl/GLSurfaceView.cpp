@@ -27,6 +27,7 @@
 
 #include <platforms/LogHelper.h>
 #include <android/opengl/GLES2/esUtil.h>
+#include <android/os/appkit/Thread.h>
 #include <android/view/ViewHostWindow.h>
 #include <android/view/ViewPrivate.h>
 
@@ -246,6 +247,9 @@ public:
 
     void readyToRun()
     {
+        // Rendering has a frame deadline to meet, like the render thread of Android.
+        if (!Thread::setThreadPriority(Thread::THREAD_PRIORITY_DISPLAY))
+            LOGW("Could not raise the priority of GL thread %d", Thread::myTid());
         esInitContext(&m_eglHelper);
     }
 
@@ -355,7 +359,7 @@ private:
         bool createEglSurface = false;
         int32_t w = 0;
         int32_t h = 0;
-        std::function<void ()>* event = nullptr;
+        Runnable* event = nullptr;
 
         while (true) {
             synchronized (sGLThreadManager) {
@@ -516,7 +520,7 @@ private:
     }
 
 public:
-    void queueEvent(std::function<void ()> r)
+    void queueEvent(Runnable r)
     {
         if (!r) {
             LOGA("r must not be null");
@@ -542,7 +546,7 @@ private:
     bool m_hasEglSurface;
     bool m_requestRender;
     bool m_renderComplete;
-    std::deque<std::function<void ()>> m_eventQueue;
+    std::deque<Runnable> m_eventQueue;
 
     GLSurfaceView& m_view;
     EGLHelper m_eglHelper;
@@ -622,7 +626,7 @@ void GLSurfaceView::onPause()
     m_glThread->onPause();
 }
 
-void GLSurfaceView::queueEvent(std::function<void ()> r)
+void GLSurfaceView::queueEvent(Runnable r)
 {
     m_glThread->queueEvent(std::move(r));
 }
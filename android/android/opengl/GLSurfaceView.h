@@ -71,7 +71,7 @@ public:
     virtual void onPause();
 
     // Queue a runnable to be run on the GL rendering thread. 
-    virtual void queueEvent(std::function<void ()> r);
+    virtual void queueEvent(Runnable r);
 
     // view.View
     virtual void onAttachedToWindow() override;
@@ -0,0 +1,189 @@
+/*
+ * Copyright (C) 2016 Naver Corp. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "AsyncFile.h"
+
+#include <android/os/AsyncBufferPool.h>
+#include <android/os/AsyncIOProvider.h>
+#include <platforms/StringConversion.h>
+
+#include <assert>
+
+namespace android {
+namespace os {
+
+AsyncBuffer::AsyncBuffer()
+    : m_data(nullptr)
+    , m_size(0)
+    , m_capacity(0)
+    , m_poolIndex(-1)
+{
+}
+
+AsyncBuffer::AsyncBuffer(AsyncBuffer&& other)
+    : m_data(other.m_data)
+    , m_size(other.m_size)
+    , m_capacity(other.m_capacity)
+    , m_poolIndex(other.m_poolIndex)
+{
+    other.m_data = nullptr;
+    other.m_size = 0;
+    other.m_capacity = 0;
+    other.m_poolIndex = -1;
+}
+
+AsyncBuffer& AsyncBuffer::operator=(AsyncBuffer&& other)
+{
+    if (this == &other)
+        return *this;
+
+    release();
+    std::swap(m_data, other.m_data);
+    std::swap(m_size, other.m_size);
+    std::swap(m_capacity, other.m_capacity);
+    std::swap(m_poolIndex, other.m_poolIndex);
+    return *this;
+}
+
+AsyncBuffer::~AsyncBuffer()
+{
+    release();
+}
+
+// Returns a buffer which can hold at least capacity bytes.
+AsyncBuffer AsyncBuffer::obtain(size_t capacity)
+{
+    AsyncBuffer buffer;
+    if (capacity <= poolBufferSize) {
+        AsyncBufferPool& pool = AsyncBufferPool::shared();
+        int32_t index = pool.obtain();
+        if (index >= 0) {
+            buffer.m_data = pool.data(index);
+            buffer.m_capacity = poolBufferSize;
+            buffer.m_poolIndex = index;
+            return buffer;
+        }
+    }
+
+    buffer.m_data = new uint8_t[capacity];
+    buffer.m_capacity = capacity;
+    return buffer;
+}
+
+void AsyncBuffer::setSize(size_t size)
+{
+    assert(size <= m_capacity);
+    m_size = size;
+}
+
+void AsyncBuffer::release()
+{
+    if (m_poolIndex >= 0)
+        AsyncBufferPool::shared().recycle(m_poolIndex);
+    else
+        delete[] m_data;
+
+    m_data = nullptr;
+    m_size = 0;
+    m_capacity = 0;
+    m_poolIndex = -1;
+}
+
+AsyncFile::AsyncFile(std::shared_ptr<AsyncFileDescriptor> descriptor)
+    : m_descriptor(std::move(descriptor))
+{
+}
+
+AsyncFile::~AsyncFile()
+{
+}
+
+// Opens the file at path with the given mode, and posts the file, or nullptr and a negative errno value, to handler.
+void AsyncFile::openAsync(const String& path, int32_t mode, std::shared_ptr<Handler> handler, OpenCallback callback)
+{
+    std::unique_ptr<AsyncIORequest> request(new AsyncIORequest(AsyncIORequest::Operation::Open, std::move(handler)));
+    request->path = std::ws2s(path);
+    request->mode = mode;
+    request->completion = [callback = std::move(callback)] (AsyncIORequest& request) {
+        if (request.result < 0) {
+            callback(nullptr, request.result);
+            return;
+        }
+        callback(std::shared_ptr<AsyncFile>(new AsyncFile(std::move(request.descriptor))), 0);
+    };
+
+    AsyncIOProvider::shared().submit(std::move(request));
+}
+
+int32_t AsyncFile::getFd() const
+{
+    return m_descriptor->fd();
+}
+
+// Reads up to length bytes at offset, and posts the buffer holding them to handler.
+void AsyncFile::readAsync(int64_t offset, size_t length, std::shared_ptr<Handler> handler, ReadCallback callback)
+{
+    std::unique_ptr<AsyncIORequest> request(new AsyncIORequest(AsyncIORequest::Operation::Read, std::move(handler)));
+    request->descriptor = m_descriptor;
+    request->offset = offset;
+    request->length = length;
+    request->buffer = AsyncBuffer::obtain(length);
+    request->completion = [callback = std::move(callback)] (AsyncIORequest& request) {
+        request.buffer.setSize(static_cast<size_t>(std::max(request.result, 0)));
+        callback(std::move(request.buffer), request.result);
+    };
+
+    AsyncIOProvider::shared().submit(std::move(request));
+}
+
+// Writes the valid bytes of buffer at offset, and posts the number of bytes written to handler.
+void AsyncFile::writeAsync(int64_t offset, AsyncBuffer buffer, std::shared_ptr<Handler> handler, CompletionCallback callback)
+{
+    std::unique_ptr<AsyncIORequest> request(new AsyncIORequest(AsyncIORequest::Operation::Write, std::move(handler)));
+    request->descriptor = m_descriptor;
+    request->offset = offset;
+    request->length = buffer.size();
+    request->buffer = std::move(buffer);
+    request->completion = [callback = std::move(callback)] (AsyncIORequest& request) {
+        callback(request.result);
+    };
+
+    AsyncIOProvider::shared().submit(std::move(request));
+}
+
+// Flushes the data and metadata of the file to the storage device.
+void AsyncFile::fsyncAsync(std::shared_ptr<Handler> handler, CompletionCallback callback)
+{
+    std::unique_ptr<AsyncIORequest> request(new AsyncIORequest(AsyncIORequest::Operation::Fsync, std::move(handler)));
+    request->descriptor = m_descriptor;
+    request->completion = [callback = std::move(callback)] (AsyncIORequest& request) {
+        callback(request.result);
+    };
+
+    AsyncIOProvider::shared().submit(std::move(request));
+}
+
+} // namespace os
+} // namespace android
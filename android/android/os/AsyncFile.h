@@ -0,0 +1,117 @@
+/*
+ * Copyright (C) 2016 Naver Corp. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <android/os/Handler.h>
+
+#include <functional>
+#include <memory>
+
+namespace android {
+namespace os {
+
+class AsyncFileDescriptor;
+
+// A buffer for asynchronous file I/O. Buffers of up to AsyncBuffer::poolBufferSize bytes come from
+// a pool which is registered with the kernel where supported, so that reads and writes neither
+// allocate nor have the kernel map the buffer for every operation. Larger buffers are allocated.
+class ANDROID_EXPORT AsyncBuffer {
+public:
+    static const size_t poolBufferSize = 64 * 1024;
+
+    AsyncBuffer();
+    AsyncBuffer(AsyncBuffer&&);
+    AsyncBuffer& operator=(AsyncBuffer&&);
+    ~AsyncBuffer();
+
+    // Returns a buffer which can hold at least capacity bytes.
+    static AsyncBuffer obtain(size_t capacity);
+
+    uint8_t* data() { return m_data; }
+    const uint8_t* data() const { return m_data; }
+    // The number of valid bytes, which are the bytes read, or the bytes to write.
+    size_t size() const { return m_size; }
+    void setSize(size_t size);
+    size_t capacity() const { return m_capacity; }
+
+    // The index of the buffer in the pool, or -1 for allocated buffers.
+    int32_t poolIndex() const { return m_poolIndex; }
+
+private:
+    AsyncBuffer(const AsyncBuffer&) = delete;
+    AsyncBuffer& operator=(const AsyncBuffer&) = delete;
+
+    void release();
+
+    uint8_t* m_data;
+    size_t m_size;
+    size_t m_capacity;
+    int32_t m_poolIndex;
+};
+
+// A file whose operations complete asynchronously, backed by io_uring on Linux and by a thread pool
+// elsewhere. The completion of every operation is posted to the Handler passed to it. Results are
+// the number of bytes transferred, or a negative errno value on failure.
+// The file is closed once it and all of its pending operations are destroyed.
+class ANDROID_EXPORT AsyncFile final {
+public:
+    // Open modes, with the values of ParcelFileDescriptor.
+    static const int32_t MODE_READ_ONLY = 0x10000000;
+    static const int32_t MODE_WRITE_ONLY = 0x20000000;
+    static const int32_t MODE_READ_WRITE = 0x30000000;
+    static const int32_t MODE_CREATE = 0x08000000;
+    static const int32_t MODE_TRUNCATE = 0x04000000;
+    static const int32_t MODE_APPEND = 0x02000000;
+
+    typedef std::function<void (std::shared_ptr<AsyncFile> file, int32_t error)> OpenCallback;
+    typedef std::function<void (AsyncBuffer buffer, int32_t result)> ReadCallback;
+    typedef std::function<void (int32_t result)> CompletionCallback;
+
+    ~AsyncFile();
+
+    // Opens the file at path with the given mode, and posts the file, or nullptr and a negative errno value, to handler.
+    static void openAsync(const String& path, int32_t mode, std::shared_ptr<Handler> handler, OpenCallback callback);
+
+    int32_t getFd() const;
+
+    // Reads up to length bytes at offset, and posts the buffer holding them to handler.
+    void readAsync(int64_t offset, size_t length, std::shared_ptr<Handler> handler, ReadCallback callback);
+    // Writes the valid bytes of buffer at offset, and posts the number of bytes written to handler.
+    void writeAsync(int64_t offset, AsyncBuffer buffer, std::shared_ptr<Handler> handler, CompletionCallback callback);
+    // Flushes the data and metadata of the file to the storage device.
+    void fsyncAsync(std::shared_ptr<Handler> handler, CompletionCallback callback);
+
+private:
+    explicit AsyncFile(std::shared_ptr<AsyncFileDescriptor>);
+
+    std::shared_ptr<AsyncFileDescriptor> m_descriptor;
+};
+
+} // namespace os
+} // namespace android
+
+using AsyncBuffer = android::os::AsyncBuffer;
+using AsyncFile = android::os::AsyncFile;
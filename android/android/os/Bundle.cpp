@@ -46,6 +46,112 @@ Bundle::Bundle(Bundle&& o)
 {
 }
 
+Bundle::Bundle(std::shared_ptr<BundlePrivate> bundle)
+    : m_private(std::move(bundle))
+{
+}
+
+size_t Bundle::size()
+{
+    return m_private->size();
+}
+
+bool Bundle::isEmpty()
+{
+    return !m_private->size();
+}
+
+void Bundle::clear()
+{
+    m_private->clear();
+}
+
+bool Bundle::containsKey(const String& key)
+{
+    return m_private->containsKey(key);
+}
+
+void Bundle::remove(const String& key)
+{
+    m_private->remove(key);
+}
+
+std::vector<String> Bundle::keySet()
+{
+    return m_private->keySet();
+}
+
+bool Bundle::getBoolean(const String& key, bool defaultValue)
+{
+    return m_private->getValue(key, BundlePrivate::Type::Boolean, defaultValue);
+}
+
+void Bundle::putBoolean(const String& key, bool value)
+{
+    m_private->putValue(key, BundlePrivate::Type::Boolean, value);
+}
+
+int32_t Bundle::getInt(const String& key, int32_t defaultValue)
+{
+    return m_private->getValue(key, BundlePrivate::Type::Int, defaultValue);
+}
+
+void Bundle::putInt(const String& key, int32_t value)
+{
+    m_private->putValue(key, BundlePrivate::Type::Int, value);
+}
+
+int64_t Bundle::getLong(const String& key, int64_t defaultValue)
+{
+    return m_private->getValue(key, BundlePrivate::Type::Long, defaultValue);
+}
+
+void Bundle::putLong(const String& key, int64_t value)
+{
+    m_private->putValue(key, BundlePrivate::Type::Long, value);
+}
+
+float Bundle::getFloat(const String& key, float defaultValue)
+{
+    return m_private->getValue(key, BundlePrivate::Type::Float, defaultValue);
+}
+
+void Bundle::putFloat(const String& key, float value)
+{
+    m_private->putValue(key, BundlePrivate::Type::Float, value);
+}
+
+double Bundle::getDouble(const String& key, double defaultValue)
+{
+    return m_private->getValue(key, BundlePrivate::Type::Double, defaultValue);
+}
+
+void Bundle::putDouble(const String& key, double value)
+{
+    m_private->putValue(key, BundlePrivate::Type::Double, value);
+}
+
+String Bundle::getString(const String& key, const String& defaultValue)
+{
+    String result;
+    if (!m_private->getString(key, result))
+        return defaultValue;
+
+    return result;
+}
+
+String Bundle::getString(const String& key)
+{
+    String result;
+    m_private->getString(key, result);
+    return result;
+}
+
+void Bundle::putString(const String& key, const String& value)
+{
+    m_private->putString(key, value);
+}
+
 CharSequence Bundle::getCharSequence(const String& key, const CharSequence& defaultValue)
 {
     CharSequence result = getCharSequence(key);
@@ -57,12 +163,120 @@ CharSequence Bundle::getCharSequence(const String& key, const CharSequence& defa
 
 CharSequence Bundle::getCharSequence(const String& key)
 {
-    return m_private->getCharSequence(key);
+    return getString(key);
 }
 
 void Bundle::putCharSequence(const String& key, const CharSequence& value)
 {
-    m_private->putCharSequence(key, value);
+    putString(key, value);
+}
+
+Bundle Bundle::getBundle(const String& key)
+{
+    std::shared_ptr<BundlePrivate> bundle = m_private->getBundle(key);
+    return bundle ? Bundle(std::move(bundle)) : Bundle();
+}
+
+void Bundle::putBundle(const String& key, const Bundle& value)
+{
+    m_private->putBundle(key, *value.m_private);
+}
+
+std::vector<int8_t> Bundle::getByteArray(const String& key)
+{
+    std::vector<int8_t> result;
+    m_private->getArray(key, BundlePrivate::Type::ByteArray, result);
+    return result;
+}
+
+void Bundle::putByteArray(const String& key, const std::vector<int8_t>& value)
+{
+    m_private->putArray(key, BundlePrivate::Type::ByteArray, value.data(), value.size());
+}
+
+// std::vector<bool> is packed into bits, so booleans are kept as a byte each.
+std::vector<bool> Bundle::getBooleanArray(const String& key)
+{
+    std::vector<uint8_t> values;
+    m_private->getArray(key, BundlePrivate::Type::BooleanArray, values);
+    return std::vector<bool>(values.begin(), values.end());
+}
+
+void Bundle::putBooleanArray(const String& key, const std::vector<bool>& value)
+{
+    std::vector<uint8_t> values(value.begin(), value.end());
+    m_private->putArray(key, BundlePrivate::Type::BooleanArray, values.data(), values.size());
+}
+
+std::vector<int32_t> Bundle::getIntArray(const String& key)
+{
+    std::vector<int32_t> result;
+    m_private->getArray(key, BundlePrivate::Type::IntArray, result);
+    return result;
+}
+
+void Bundle::putIntArray(const String& key, const std::vector<int32_t>& value)
+{
+    m_private->putArray(key, BundlePrivate::Type::IntArray, value.data(), value.size());
+}
+
+std::vector<int64_t> Bundle::getLongArray(const String& key)
+{
+    std::vector<int64_t> result;
+    m_private->getArray(key, BundlePrivate::Type::LongArray, result);
+    return result;
+}
+
+void Bundle::putLongArray(const String& key, const std::vector<int64_t>& value)
+{
+    m_private->putArray(key, BundlePrivate::Type::LongArray, value.data(), value.size());
+}
+
+std::vector<float> Bundle::getFloatArray(const String& key)
+{
+    std::vector<float> result;
+    m_private->getArray(key, BundlePrivate::Type::FloatArray, result);
+    return result;
+}
+
+void Bundle::putFloatArray(const String& key, const std::vector<float>& value)
+{
+    m_private->putArray(key, BundlePrivate::Type::FloatArray, value.data(), value.size());
+}
+
+std::vector<double> Bundle::getDoubleArray(const String& key)
+{
+    std::vector<double> result;
+    m_private->getArray(key, BundlePrivate::Type::DoubleArray, result);
+    return result;
+}
+
+void Bundle::putDoubleArray(const String& key, const std::vector<double>& value)
+{
+    m_private->putArray(key, BundlePrivate::Type::DoubleArray, value.data(), value.size());
+}
+
+std::vector<String> Bundle::getStringArray(const String& key)
+{
+    std::vector<String> result;
+    m_private->getStringArray(key, result);
+    return result;
+}
+
+void Bundle::putStringArray(const String& key, const std::vector<String>& value)
+{
+    m_private->putStringArray(key, value);
+}
+
+int32_t Bundle::getFileDescriptor(const String& key)
+{
+    return m_private->getValue(key, BundlePrivate::Type::FileDescriptor, -1);
+}
+
+void Bundle::putFileDescriptor(const String& key, int32_t fd)
+{
+    assert(fd >= 0);
+    m_private->putValue(key, BundlePrivate::Type::FileDescriptor, fd);
 }
 
 void Bundle::writeToParcel(Parcel& dest, int32_t flags)
@@ -75,5 +289,10 @@ void Bundle::readFromParcel(Parcel& parcel)
     m_private->readFromParcel(parcel);
 }
 
+String Bundle::toString()
+{
+    return m_private->toString();
+}
+
 } // namespace os
 } // namespace android
@@ -40,14 +40,74 @@ public:
     ANDROID_EXPORT Bundle(Bundle&&);
     ANDROID_EXPORT virtual ~Bundle() = default;
 
+    // Returns the number of mappings contained in this Bundle.
+    ANDROID_EXPORT size_t size();
+    // Returns true if the mapping of this Bundle is empty, false otherwise.
+    ANDROID_EXPORT bool isEmpty();
+    // Removes all elements from the mapping of this Bundle.
+    ANDROID_EXPORT void clear();
+    // Returns true if the given key is contained in the mapping of this Bundle.
+    ANDROID_EXPORT bool containsKey(const String& key);
+    // Removes any entry with the given key from the mapping of this Bundle.
+    ANDROID_EXPORT void remove(const String& key);
+    // Returns the keys contained in this Bundle, in sorted order.
+    ANDROID_EXPORT std::vector<String> keySet();
+
+    // Getters return defaultValue, or an empty value, if no mapping of the desired type exists for the given key.
+    ANDROID_EXPORT bool getBoolean(const String& key, bool defaultValue = false);
+    ANDROID_EXPORT void putBoolean(const String& key, bool value);
+    ANDROID_EXPORT int32_t getInt(const String& key, int32_t defaultValue = 0);
+    ANDROID_EXPORT void putInt(const String& key, int32_t value);
+    ANDROID_EXPORT int64_t getLong(const String& key, int64_t defaultValue = 0);
+    ANDROID_EXPORT void putLong(const String& key, int64_t value);
+    ANDROID_EXPORT float getFloat(const String& key, float defaultValue = 0);
+    ANDROID_EXPORT void putFloat(const String& key, float value);
+    ANDROID_EXPORT double getDouble(const String& key, double defaultValue = 0);
+    ANDROID_EXPORT void putDouble(const String& key, double value);
+
+    ANDROID_EXPORT String getString(const String& key, const String& defaultValue);
+    ANDROID_EXPORT String getString(const String& key);
+    ANDROID_EXPORT void putString(const String& key, const String& value);
     ANDROID_EXPORT CharSequence getCharSequence(const String& key, const CharSequence& defaultValue);
     ANDROID_EXPORT CharSequence getCharSequence(const String& key);
     ANDROID_EXPORT void putCharSequence(const String& key, const CharSequence& value);
 
+    // Returns the Bundle associated with the given key, which changes along with this Bundle, or an empty Bundle.
+    ANDROID_EXPORT Bundle getBundle(const String& key);
+    // Inserts a copy of value into the mapping of this Bundle.
+    ANDROID_EXPORT void putBundle(const String& key, const Bundle& value);
+
+    ANDROID_EXPORT std::vector<int8_t> getByteArray(const String& key);
+    ANDROID_EXPORT void putByteArray(const String& key, const std::vector<int8_t>& value);
+    ANDROID_EXPORT std::vector<bool> getBooleanArray(const String& key);
+    ANDROID_EXPORT void putBooleanArray(const String& key, const std::vector<bool>& value);
+    ANDROID_EXPORT std::vector<int32_t> getIntArray(const String& key);
+    ANDROID_EXPORT void putIntArray(const String& key, const std::vector<int32_t>& value);
+    ANDROID_EXPORT std::vector<int64_t> getLongArray(const String& key);
+    ANDROID_EXPORT void putLongArray(const String& key, const std::vector<int64_t>& value);
+    ANDROID_EXPORT std::vector<float> getFloatArray(const String& key);
+    ANDROID_EXPORT void putFloatArray(const String& key, const std::vector<float>& value);
+    ANDROID_EXPORT std::vector<double> getDoubleArray(const String& key);
+    ANDROID_EXPORT void putDoubleArray(const String& key, const std::vector<double>& value);
+    ANDROID_EXPORT std::vector<String> getStringArray(const String& key);
+    ANDROID_EXPORT void putStringArray(const String& key, const std::vector<String>& value);
+
+    // Returns the file descriptor associated with the given key, or -1 if there is none.
+    // Descriptors of a Bundle received from another process belong to the receiver, which has to close them.
+    ANDROID_EXPORT int32_t getFileDescriptor(const String& key);
+    // Inserts a file descriptor into the mapping of this Bundle, which is duplicated into the receiving process
+    // when the Bundle is sent across processes. The Bundle does not take ownership of fd.
+    ANDROID_EXPORT void putFileDescriptor(const String& key, int32_t fd);
+
     ANDROID_EXPORT void writeToParcel(Parcel& dest, int32_t flags);
     ANDROID_EXPORT void readFromParcel(Parcel& parcel);
 
+    // Returns the contents of this Bundle as JSON, for debugging.
+    ANDROID_EXPORT String toString();
+
 private:
+    explicit Bundle(std::shared_ptr<BundlePrivate>);
+
     std::shared_ptr<BundlePrivate> m_private;
 };
 
@@ -0,0 +1,124 @@
+/*
+ * Copyright (C) 2016 Naver Corp. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "Coroutine.h"
+
+#include "Looper.h"
+
+#include <array>
+#include <new>
+#include <vector>
+
+namespace android {
+namespace os {
+
+// Frames are rounded up to multiples of frameGranularity, and those up to maxPooledFrameSize are pooled.
+static const size_t frameGranularity = 64;
+static const size_t maxPooledFrameSize = 1024;
+static const size_t frameClassCount = maxPooledFrameSize / frameGranularity;
+static const size_t maxCachedFrames = 32;
+
+class FrameCache {
+public:
+    ~FrameCache()
+    {
+        for (auto& frames : m_frames) {
+            for (void* frame : frames)
+                ::operator delete(frame);
+        }
+        m_destroyed = true;
+    }
+
+    void* obtain(size_t frameClass)
+    {
+        if (m_destroyed || m_frames[frameClass].empty())
+            return ::operator new((frameClass + 1) * frameGranularity);
+
+        std::vector<void*>& frames = m_frames[frameClass];
+        void* frame = frames.back();
+        frames.pop_back();
+        return frame;
+    }
+
+    void recycle(void* frame, size_t frameClass)
+    {
+        // Frames finishing while the thread exits are not cached any more.
+        if (m_destroyed || m_frames[frameClass].size() >= maxCachedFrames) {
+            ::operator delete(frame);
+            return;
+        }
+
+        m_frames[frameClass].push_back(frame);
+    }
+
+private:
+    std::array<std::vector<void*>, frameClassCount> m_frames;
+    bool m_destroyed = false;
+};
+
+static thread_local FrameCache frameCache;
+
+static size_t frameClassOf(size_t size)
+{
+    return (size + frameGranularity - 1) / frameGranularity - 1;
+}
+
+void* CoroutineFrame::allocate(size_t size)
+{
+    if (!size || size > maxPooledFrameSize)
+        return ::operator new(size);
+
+    return frameCache.obtain(frameClassOf(size));
+}
+
+void CoroutineFrame::deallocate(void* frame, size_t size)
+{
+    if (!size || size > maxPooledFrameSize) {
+        ::operator delete(frame);
+        return;
+    }
+
+    // A frame may finish on another thread than it started on, the size class is all that matters.
+    frameCache.recycle(frame, frameClassOf(size));
+}
+
+static thread_local std::shared_ptr<Handler> threadHandler;
+
+// Returns a Handler on the Looper of the calling thread, or nullptr if it has no Looper.
+std::shared_ptr<Handler> CoroutineFrame::currentHandler()
+{
+    Looper* looper = Looper::myLooper();
+    if (!looper)
+        return nullptr;
+
+    // The thread may have prepared a new Looper since the last call.
+    if (!threadHandler || threadHandler->getLooper() != looper)
+        threadHandler = Handler::create();
+
+    return threadHandler;
+}
+
+} // namespace os
+} // namespace android
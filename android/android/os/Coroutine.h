@@ -0,0 +1,122 @@
+/*
+ * Copyright (C) 2016 Naver Corp. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <android/os/Handler.h>
+
+#if COMPILER_SUPPORTS(CXX_COROUTINES)
+#include <coroutine>
+#include <exception>
+#endif
+
+namespace android {
+namespace os {
+
+// Allocates coroutine frames from per-thread pools of size classes, so that starting and
+// finishing coroutines does not go through the global heap in steady state.
+// The library itself does not need C++20; only clients awaiting on Handlers and channels do.
+class ANDROID_EXPORT CoroutineFrame {
+public:
+    static void* allocate(size_t size);
+    static void deallocate(void* frame, size_t size);
+
+    // Returns a Handler on the Looper of the calling thread, or nullptr if it has no Looper.
+    static std::shared_ptr<Handler> currentHandler();
+};
+
+#if COMPILER_SUPPORTS(CXX_COROUTINES)
+
+// The return type of coroutines run on Loopers. A coroutine starts running right away, until
+// it first suspends, and its frame is released once it completes.
+class Coroutine {
+public:
+    struct promise_type {
+        Coroutine get_return_object() { return Coroutine(); }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() { }
+        void unhandled_exception() { std::terminate(); }
+
+        static void* operator new(size_t size)
+        {
+            return CoroutineFrame::allocate(size);
+        }
+        static void operator delete(void* frame, size_t size)
+        {
+            CoroutineFrame::deallocate(frame, size);
+        }
+    };
+};
+
+// Resumes the awaiting coroutine on the thread of a Handler's Looper, after an optional delay.
+// A coroutine awaiting on a Handler which is destroyed before it posts is never resumed.
+class HandlerAwaitable {
+public:
+    HandlerAwaitable(Handler& handler, std::chrono::nanoseconds delay)
+        : m_handler(handler)
+        , m_delay(delay)
+    {
+    }
+
+    bool await_ready() const { return false; }
+    bool await_suspend(std::coroutine_handle<> coroutine)
+    {
+        // Keep running in place if the post fails, rather than leaving the coroutine suspended forever.
+        return m_handler.postDelayed([coroutine] { coroutine.resume(); }, m_delay);
+    }
+    void await_resume() { }
+
+private:
+    Handler& m_handler;
+    std::chrono::nanoseconds m_delay;
+};
+
+// Returns an awaitable which resumes the awaiting coroutine on the thread of this Handler's Looper.
+inline HandlerAwaitable Handler::schedule()
+{
+    return HandlerAwaitable(*this, std::chrono::nanoseconds::zero());
+}
+
+// Returns an awaitable which resumes the awaiting coroutine on the thread of the Handler's Looper, after the specified amount of time elapses.
+inline HandlerAwaitable delay(Handler& handler, std::chrono::nanoseconds delay)
+{
+    return HandlerAwaitable(handler, delay);
+}
+
+inline HandlerAwaitable delay(const std::shared_ptr<Handler>& handler, std::chrono::nanoseconds delay)
+{
+    return HandlerAwaitable(*handler, delay);
+}
+
+#endif
+
+} // namespace os
+} // namespace android
+
+using CoroutineFrame = android::os::CoroutineFrame;
+#if COMPILER_SUPPORTS(CXX_COROUTINES)
+using Coroutine = android::os::Coroutine;
+#endif
@@ -0,0 +1,311 @@
+/*
+ * Copyright (C) 2016 Naver Corp. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <android/os/Handler.h>
+
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include <assert>
+
+namespace android {
+namespace os {
+
+template<typename T> class Future;
+template<typename T> class Promise;
+
+// The shared state between a Promise and its Future. Futures of void hold a placeholder value.
+// The state is cancelled when every Promise of it is gone without setting the value.
+template<typename T>
+class FutureState final : public Object {
+public:
+    typedef typename std::conditional<std::is_void<T>::value, bool, T>::type Value;
+
+    FutureState()
+        : m_ready(false)
+        , m_taken(false)
+        , m_cancelled(false)
+    {
+    }
+    ~FutureState()
+    {
+        if (m_ready && !m_taken)
+            value().~Value();
+    }
+
+    bool isReady()
+    {
+        synchronized (this) {
+            return m_ready;
+        }
+        return false;
+    }
+
+    bool isCancelled()
+    {
+        synchronized (this) {
+            return m_cancelled;
+        }
+        return false;
+    }
+
+    void setValue(Value&& newValue)
+    {
+        Runnable continuation;
+
+        synchronized (this) {
+            assert(!m_ready);
+            new (&m_storage) Value(std::move(newValue));
+            m_ready = true;
+            continuation = std::move(m_continuation);
+            notifyAll();
+        }
+
+        if (continuation)
+            continuation();
+    }
+
+    // Wakes up takeValue() and runs the continuation without a value, unless the value is set already.
+    void cancel()
+    {
+        Runnable continuation;
+
+        synchronized (this) {
+            if (m_ready || m_cancelled)
+                return;
+            m_cancelled = true;
+            continuation = std::move(m_continuation);
+            notifyAll();
+        }
+
+        if (continuation)
+            continuation();
+    }
+
+    // Blocks until the value is set, then moves it out. Returns a default-constructed value if cancelled.
+    Value takeValue()
+    {
+        synchronized (this) {
+            while (!m_ready && !m_cancelled)
+                wait();
+            if (!m_ready)
+                return Value();
+            assert(!m_taken);
+            m_taken = true;
+        }
+
+        Value result(std::move(value()));
+        value().~Value();
+        return result;
+    }
+
+    // Runs continuation on the thread setting the value or cancelling, or right away if either happened already.
+    void setContinuation(Runnable continuation)
+    {
+        synchronized (this) {
+            assert(!m_continuation);
+            if (!m_ready && !m_cancelled) {
+                m_continuation = std::move(continuation);
+                return;
+            }
+        }
+
+        continuation();
+    }
+
+private:
+    Value& value()
+    {
+        return *reinterpret_cast<Value*>(&m_storage);
+    }
+
+    typename std::aligned_storage<sizeof(Value), alignof(Value)>::type m_storage;
+    bool m_ready;
+    bool m_taken;
+    bool m_cancelled;
+    Runnable m_continuation;
+};
+
+// Calls functions with the value of a FutureState, and fulfils promises with what they return.
+struct FutureCall {
+    template<typename T, typename Function, bool = std::is_void<T>::value>
+    struct Result {
+        typedef decltype(std::declval<Function&>()(std::declval<T>())) Type;
+    };
+    template<typename T, typename Function>
+    struct Result<T, Function, true> {
+        typedef decltype(std::declval<Function&>()()) Type;
+    };
+
+    template<typename T, typename Function>
+    static typename std::enable_if<std::is_void<T>::value, typename Result<T, Function>::Type>::type call(Function& function, FutureState<T>& state)
+    {
+        state.takeValue();
+        return function();
+    }
+    template<typename T, typename Function>
+    static typename std::enable_if<!std::is_void<T>::value, typename Result<T, Function>::Type>::type call(Function& function, FutureState<T>& state)
+    {
+        return function(state.takeValue());
+    }
+
+    template<typename Result, typename Producer>
+    static typename std::enable_if<std::is_void<Result>::value>::type fulfil(Promise<Result>& promise, Producer&& producer)
+    {
+        producer();
+        promise.setValue();
+    }
+    template<typename Result, typename Producer>
+    static typename std::enable_if<!std::is_void<Result>::value>::type fulfil(Promise<Result>& promise, Producer&& producer)
+    {
+        promise.setValue(producer());
+    }
+};
+
+// The result of an asynchronous computation, such as a function posted with Handler::postForResult().
+// A Future has a single consumer: either get() its value, or chain a continuation with then().
+template<typename T>
+class Future {
+    friend class Promise<T>;
+public:
+    Future() = default;
+
+    // Returns true if the Future refers to a pending or finished computation.
+    bool isValid() const { return !!m_state; }
+    // Returns true if the result is available.
+    bool isDone() const { return m_state && m_state->isReady(); }
+    // Returns true if every Promise of the result is gone without setting it.
+    bool isCancelled() const { return m_state && m_state->isCancelled(); }
+
+    // Waits for the result and returns it, or a default-constructed value if the Future is cancelled.
+    // Must not be called on the thread which is going to produce the result.
+    T get()
+    {
+        assert(m_state);
+        std::shared_ptr<FutureState<T>> state = std::move(m_state);
+        return static_cast<T>(state->takeValue());
+    }
+
+    // Calls function with the result on the thread of handler's Looper once it is available,
+    // and returns a Future of what function returns. The returned Future is cancelled instead
+    // if this one is, or if handler is gone or its Looper has quit by then.
+    template<typename Function>
+    Future<typename FutureCall::Result<T, typename std::decay<Function>::type>::Type> then(const std::shared_ptr<Handler>& handler, Function&& function)
+    {
+        typedef typename std::decay<Function>::type Callable;
+        typedef typename FutureCall::Result<T, Callable>::Type Result;
+
+        assert(m_state);
+        assert(handler);
+        std::shared_ptr<FutureState<T>> state = std::move(m_state);
+        Promise<Result> promise;
+        Future<Result> future = promise.getFuture();
+        std::weak_ptr<Handler> target = handler;
+
+        // The continuation only hops to the Looper of the handler, the function runs there.
+        // Dropping the promise on the way cancels the returned Future.
+        FutureState<T>& continuationState = *state;
+        continuationState.setContinuation([target, state, promise, callable = Callable(std::forward<Function>(function))] () mutable {
+            std::shared_ptr<Handler> handler = target.lock();
+            if (!handler || state->isCancelled())
+                return;
+            handler->post([state = std::move(state), promise = std::move(promise), callable = std::move(callable)] () mutable {
+                FutureCall::fulfil(promise, [&] { return FutureCall::call(callable, *state); });
+            });
+        });
+        return future;
+    }
+
+private:
+    explicit Future(std::shared_ptr<FutureState<T>> state)
+        : m_state(std::move(state))
+    {
+    }
+
+    std::shared_ptr<FutureState<T>> m_state;
+};
+
+// The producing side of a Future. Copies share the result; when the last of them is destroyed
+// without setting it, the Future is cancelled.
+template<typename T>
+class Promise {
+public:
+    typedef typename FutureState<T>::Value Value;
+
+    Promise()
+        : m_owner(std::make_shared<Owner>())
+    {
+    }
+
+    Future<T> getFuture() const
+    {
+        return Future<T>(m_owner->state);
+    }
+
+    // Sets the result, waking up get() and running the continuation set by then(). Futures of void take no value.
+    void setValue(Value value = Value())
+    {
+        m_owner->state->setValue(std::move(value));
+    }
+
+private:
+    struct Owner {
+        Owner() : state(std::make_shared<FutureState<T>>()) { }
+        ~Owner() { state->cancel(); }
+
+        std::shared_ptr<FutureState<T>> state;
+    };
+
+    std::shared_ptr<Owner> m_owner;
+};
+
+// Causes function to be run on the thread of this Handler's Looper, and returns a Future of its result.
+template<typename T, typename Function>
+Future<T> Handler::postForResult(Function&& function)
+{
+    typedef typename std::decay<Function>::type Callable;
+
+    Promise<T> promise;
+    Future<T> future = promise.getFuture();
+    post([promise, callable = Callable(std::forward<Function>(function))] () mutable {
+        FutureCall::fulfil(promise, callable);
+    });
+    return future;
+}
+
+template<typename Function>
+auto Handler::postForResult(Function&& function) -> Future<decltype(function())>
+{
+    return postForResult<decltype(function())>(std::forward<Function>(function));
+}
+
+} // namespace os
+} // namespace android
+
+using android::os::Future;
+using android::os::Promise;
@@ -27,47 +27,21 @@
 
 #include "Looper.h"
 #include "Message.h"
+#include "MessageQueue.h"
+#include "SystemClock.h"
 #include <android/os/HandlerProvider.h>
-#include <java/lang/System.h>
-
-#include <algorithm>
-#include <mutex>
+#include <android/os/MessagePool.h>
+#include <android/os/WorkItem.h>
 
 #include <assert>
 
 namespace android {
 namespace os {
 
-class WorkItem {
-public:
-    WorkItem(Handler& h, std::chrono::milliseconds fireTime)
-        : m_owner(h)
-        , m_fireTime(fireTime)
-    {
-    }
-    virtual ~WorkItem()
-    {
-    }
-
-    virtual void performWork() = 0;
-
-    virtual bool isMessageOf(int32_t what) = 0;
-    virtual bool isMessageOf(std::function<void()> r) = 0;
-
-    virtual std::chrono::milliseconds fireTime()
-    {
-        return m_fireTime;
-    }
-
-protected:
-    Handler& m_owner;
-    std::chrono::milliseconds m_fireTime;
-};
-
 class MessageWorkItem : public WorkItem {
 public:
-    MessageWorkItem(Handler& h, std::chrono::milliseconds fireTime, Message& msg)
-        : WorkItem(h, fireTime)
+    MessageWorkItem(Handler& h, std::chrono::nanoseconds fireTime, Message& msg)
+        : WorkItem(h, fireTime, MessageType, msg.what, msg.isAsynchronous())
         , m_message(msg)
     {
     }
@@ -75,19 +49,19 @@ public:
     {
     }
 
-    void performWork()
+    static void* operator new(size_t size)
     {
-        m_owner.handleMessage(m_message);
-        delete this;
+        return MessagePool::obtain(size);
     }
-
-    bool isMessageOf(int32_t what)
+    static void operator delete(void* p)
     {
-        return what == m_message.what;
+        MessagePool::recycle(p);
     }
-    bool isMessageOf(std::function<void ()> r)
+
+    void performWork()
     {
-        return false;
+        m_owner.handleMessage(m_message);
+        m_message.recycle();
     }
 
 private:
@@ -96,58 +70,90 @@ private:
 
 class RunnableWorkItem : public WorkItem {
 public:
-    RunnableWorkItem(Handler& h, std::chrono::milliseconds fireTime, std::function<void()> r)
-        : WorkItem(h, fireTime)
-        , m_runnable(r)
+    RunnableWorkItem(Handler& h, std::chrono::nanoseconds fireTime, Runnable&& r, bool asynchronous)
+        : WorkItem(h, fireTime, keyOf(r) ? RunnableType : UnindexedType, keyOf(r), asynchronous)
+        , m_runnable(std::move(r))
     {
     }
     ~RunnableWorkItem()
     {
     }
 
+    static void* operator new(size_t size)
+    {
+        return MessagePool::obtain(size);
+    }
+    static void operator delete(void* p)
+    {
+        MessagePool::recycle(p);
+    }
+
     void performWork()
     {
         m_runnable();
-        delete this;
     }
 
-    bool isMessageOf(int32_t what)
+    const void* callback() const
     {
-        return false;
+        return m_runnable.code();
     }
-    bool isMessageOf(std::function<void ()> r)
+
+    // Only runnables wrapping the same plain function can be told apart, so only those are indexed.
+    static intptr_t keyOf(const Runnable& r)
     {
-        return m_runnable.target<void(*)()>() == r.target<void(*)()>();
+        auto* function = r.target<void (*)()>();
+        return function ? reinterpret_cast<intptr_t>(*function) : 0;
     }
 
 private:
-    std::function<void ()> m_runnable;
+    Runnable m_runnable;
 };
 
-static void enqueueWorkItem(std::vector<std::unique_ptr<WorkItem>>& workQueue, std::unique_ptr<WorkItem>&& item)
-{
-    workQueue.push_back(std::move(item));
-    std::stable_sort(workQueue.begin(), workQueue.end(), [=] (const std::unique_ptr<WorkItem>& lhs, const std::unique_ptr<WorkItem>& rhs) {
-        return lhs->fireTime() < rhs->fireTime();
-    });
-}
+static_assert(sizeof(MessageWorkItem) <= MessagePool::nodeSize, "MessageWorkItem must fit in a pooled node");
+static_assert(sizeof(RunnableWorkItem) <= MessagePool::nodeSize, "RunnableWorkItem must fit in a pooled node");
 
-static const std::chrono::milliseconds oneMillisecond = std::chrono::duration<int32_t, std::milli>(1);
+// Items posted at the front of the queue are due before anything scheduled at a real uptime.
+static const std::chrono::nanoseconds frontOfQueue = std::chrono::nanoseconds::zero();
 
 std::shared_ptr<Handler> Handler::create()
 {
     return std::shared_ptr<Handler>(new Handler);
 }
 
+std::shared_ptr<Handler> Handler::createAsync()
+{
+    return std::shared_ptr<Handler>(new Handler(true));
+}
+
+// Handlers created on a thread without a Looper prepare one, so that the platform
+// message pump of that thread can still dispatch them.
+static Looper* prepareLooper()
+{
+    Looper::prepare();
+    return Looper::myLooper();
+}
+
 Handler::Handler()
+    : Handler(false)
+{
+}
+
+Handler::Handler(bool async)
     : m_handler(HandlerProvider::create(*this))
-    , m_nextFireTime(std::chrono::milliseconds::max())
-    , m_looper(Looper::myLooper())
+    , m_looper(prepareLooper())
+    , m_queue(m_looper->m_queue)
+    , m_asynchronous(async)
+    , m_timerSlack(std::chrono::nanoseconds::zero())
+    , m_priority(Priority::Normal)
 {
 }
 
 Handler::~Handler()
 {
+    // Unregisters the endpoint first, so that no message from another thread is enqueued for this Handler
+    // after its pending ones are removed.
+    m_handler.reset();
+    m_queue->removeWorkItems(*this);
 }
 
 Looper* Handler::getLooper()
@@ -164,12 +170,7 @@ void Handler::handleMessage(Message& msg)
 // Check if there are any pending posts of messages with code 'what' in the message queue.
 bool Handler::hasMessages(int32_t what)
 {
-    synchronized (this) {
-        for (auto& workItem : m_workQueue)
-            if (workItem->isMessageOf(what))
-                return true;
-    }
-    return false;
+    return m_queue->hasWorkItems(*this, WorkItem::MessageType, what);
 }
 
 // Returns a new Message from the global message pool.
@@ -190,180 +191,121 @@ Message Handler::obtainMessage(int32_t what, int32_t arg1, int32_t arg2)
     return Message::obtain(this, what, arg1, arg2);
 }
 
-// Remove any pending posts of std::function<void ()> r that are in the message queue.
-void Handler::removeCallbacks(std::function<void()> r)
+// Remove any pending posts of Runnable r that are in the message queue.
+void Handler::removeCallbacks(const Runnable& r)
 {
-    removeWorkItems(r);
+    if (intptr_t key = RunnableWorkItem::keyOf(r))
+        m_queue->removeWorkItems(*this, WorkItem::RunnableType, key);
 }
 
-// Causes the std::function<void ()> r to be added to the message queue.
-bool Handler::post(std::function<void()> r)
+// Remove the pending post identified by token, if it has not run yet.
+void Handler::removeCallbacks(const Token& token)
 {
-    synchronized (this) {
-        enqueueWorkItem(m_workQueue, std::make_unique<RunnableWorkItem>(*this, System::currentTimeMillis(), r));
-        return start();
-    }
+    m_queue->removeWorkItem(*this, token);
 }
 
-// Posts a message to an object that implements std::function<void ()>.
-bool Handler::postAtFrontOfQueue(std::function<void()> r)
+// Allow delayed messages and runnables of this Handler to run up to slack late.
+void Handler::setTimerSlack(std::chrono::nanoseconds slack)
 {
-    synchronized (this) {
-        enqueueWorkItem(m_workQueue, std::make_unique<RunnableWorkItem>(*this, System::currentTimeMillis() - oneMillisecond, r));
-        return start();
-    }
+    m_queue->setTimerSlack(*this, std::max(slack, std::chrono::nanoseconds::zero()));
 }
 
-// Causes the std::function<void ()> r to be added to the message queue, to be run at a specific time given by uptimeMillis.
-bool Handler::postAtTime(std::function<void()> r, std::chrono::milliseconds uptimeMillis)
+std::chrono::nanoseconds Handler::getTimerSlack() const
 {
-    synchronized (this) {
-        enqueueWorkItem(m_workQueue, std::make_unique<RunnableWorkItem>(*this, uptimeMillis, r));
-        return startAtTime();
-    }
+    return m_timerSlack;
 }
 
-// Causes the std::function<void ()> r to be added to the message queue, to be run after the specified amount of time elapses.
-bool Handler::postDelayed(std::function<void()> r, std::chrono::milliseconds delayMillis)
+// Set the lane the messages and runnables posted from now on to this Handler are dispatched in.
+void Handler::setPriority(Priority priority)
 {
-    return postAtTime(r, System::currentTimeMillis() + delayMillis);
+    m_queue->setPriority(*this, priority);
 }
 
-// Remove any pending posts of messages with code 'what' that are in the message queue.
-void Handler::removeMessages(int32_t what)
+Handler::Priority Handler::getPriority() const
 {
-    removeWorkItems(what);
+    return m_priority;
 }
 
-// Sends a Message containing only the what value.
-bool Handler::sendEmptyMessage(int32_t what)
+// Causes the Runnable r to be added to the message queue.
+Handler::Token Handler::post(Runnable r)
 {
-    return sendMessage(obtainMessage(what));
+    return m_queue->enqueueWorkItem(std::make_unique<RunnableWorkItem>(*this, SystemClock::uptimeNanos(), std::move(r), m_asynchronous));
 }
 
-// Sends a Message containing only the what value, to be delivered at a specific time.
-bool Handler::sendEmptyMessageAtTime(int32_t what, std::chrono::milliseconds uptimeMillis)
+// Posts a message to an object that implements Runnable.
+Handler::Token Handler::postAtFrontOfQueue(Runnable r)
 {
-    return sendMessageAtTime(obtainMessage(what), uptimeMillis);
+    return m_queue->enqueueWorkItem(std::make_unique<RunnableWorkItem>(*this, frontOfQueue, std::move(r), m_asynchronous));
 }
 
-// Sends a Message containing only the what value, to be delivered after the specified amount of time elapses.
-bool Handler::sendEmptyMessageDelayed(int32_t what, std::chrono::milliseconds delayMillis)
+// Causes the Runnable r to be added to the message queue, to be run at a specific time given by uptime, in the SystemClock::uptimeNanos() time base.
+Handler::Token Handler::postAtTime(Runnable r, std::chrono::nanoseconds uptime)
 {
-    return sendMessageDelayed(obtainMessage(what), delayMillis);
+    return m_queue->enqueueWorkItem(std::make_unique<RunnableWorkItem>(*this, uptime, std::move(r), m_asynchronous));
 }
 
-// Pushes a message onto the end of the message queue after all pending messages before the current time.
-bool Handler::sendMessage(Message& msg)
+// Causes the Runnable r to be added to the message queue, to be run after the specified amount of time elapses.
+Handler::Token Handler::postDelayed(Runnable r, std::chrono::nanoseconds delay)
 {
-    synchronized (this) {
-        enqueueWorkItem(m_workQueue, std::make_unique<MessageWorkItem>(*this, System::currentTimeMillis(), msg));
-        return start();
-    }
+    return postAtTime(std::move(r), SystemClock::uptimeNanos() + delay);
 }
 
-// Enqueue a message at the front of the message queue, to be processed on the next iteration of the message loop.
-bool Handler::sendMessageAtFrontOfQueue(Message& msg)
+// Remove any pending posts of messages with code 'what' that are in the message queue.
+void Handler::removeMessages(int32_t what)
 {
-    synchronized (this) {
-        enqueueWorkItem(m_workQueue, std::make_unique<MessageWorkItem>(*this, System::currentTimeMillis() - oneMillisecond, msg));
-        return start();
-    }
+    m_queue->removeWorkItems(*this, WorkItem::MessageType, what);
 }
 
-// Enqueue a message into the message queue after all pending messages before the absolute time (in milliseconds) uptimeMillis.
-bool Handler::sendMessageAtTime(Message& msg, std::chrono::milliseconds uptimeMillis)
+// Sends a Message containing only the what value.
+bool Handler::sendEmptyMessage(int32_t what)
 {
-    synchronized (this) {
-        enqueueWorkItem(m_workQueue, std::make_unique<MessageWorkItem>(*this, uptimeMillis, msg));
-        return startAtTime();
-    }
+    Message msg = obtainMessage(what);
+    return sendMessage(msg);
 }
 
-// Enqueue a message into the message queue after all pending messages before (current time + delayMillis).
-bool Handler::sendMessageDelayed(Message& msg, std::chrono::milliseconds delayMillis)
+// Sends a Message containing only the what value, to be delivered at a specific time.
+bool Handler::sendEmptyMessageAtTime(int32_t what, std::chrono::nanoseconds uptime)
 {
-    return sendMessageAtTime(msg, System::currentTimeMillis() + delayMillis);
+    Message msg = obtainMessage(what);
+    return sendMessageAtTime(msg, uptime);
 }
 
-template<typename... Arguments>
-void Handler::removeWorkItems(Arguments... args)
+// Sends a Message containing only the what value, to be delivered after the specified amount of time elapses.
+bool Handler::sendEmptyMessageDelayed(int32_t what, std::chrono::nanoseconds delay)
 {
-    synchronized (this) {
-        std::vector<int32_t> indices;
-
-        int32_t i = 0;
-        for (auto& workItem : m_workQueue) {
-            if (workItem->isMessageOf(args...))
-                indices.push_back(i);
-            ++i;
-        }
-
-        stop();
-
-        for (int32_t i = indices.size() - 1; i >= 0; --i)
-            m_workQueue.erase(m_workQueue.begin() + indices[i]);
-
-        startAtTime();
-    }
+    Message msg = obtainMessage(what);
+    return sendMessageDelayed(msg, delay);
 }
 
-bool Handler::start()
+// Pushes a message onto the end of the message queue after all pending messages before the current time.
+bool Handler::sendMessage(Message& msg)
 {
-    stop();
-
-    if (!m_workQueue.empty()) {
-        m_nextFireTime = System::currentTimeMillis();
-        return m_handler->start();
-    }
-
-    return false;
+    return enqueueMessage(msg, SystemClock::uptimeNanos());
 }
 
-bool Handler::startAtTime()
+// Enqueue a message at the front of the message queue, to be processed on the next iteration of the message loop.
+bool Handler::sendMessageAtFrontOfQueue(Message& msg)
 {
-    if (m_workQueue.empty())
-        return false;
-
-    std::chrono::milliseconds nextFireTime = m_workQueue[0]->fireTime();
-    if (nextFireTime > m_nextFireTime)
-        return true;
-
-    m_nextFireTime = nextFireTime;
-    return m_handler->startAtTime(nextFireTime);
+    return enqueueMessage(msg, frontOfQueue);
 }
 
-void Handler::stop()
+// Enqueue a message into the message queue after all pending messages before the absolute time uptime, in the SystemClock::uptimeNanos() time base.
+bool Handler::sendMessageAtTime(Message& msg, std::chrono::nanoseconds uptime)
 {
-    m_nextFireTime = std::chrono::milliseconds::max();
-    m_handler->stop();
+    return enqueueMessage(msg, uptime);
 }
 
-void Handler::performMessages()
+// Enqueue a message into the message queue after all pending messages before (current time + delay).
+bool Handler::sendMessageDelayed(Message& msg, std::chrono::nanoseconds delay)
 {
-    if (m_workQueue.size() == 0)
-        return;
-
-    std::chrono::milliseconds currentTime = System::currentTimeMillis();
-    std::vector<WorkItem*> firedItems;
-
-    synchronized (this) {
-        for (auto& workItem : m_workQueue) {
-            if (workItem->fireTime() > currentTime)
-                break;
-            firedItems.push_back(workItem.release());
-        }
-
-        stop();
-
-        if (firedItems.size() > 0)
-            m_workQueue.erase(m_workQueue.begin(), m_workQueue.begin() + firedItems.size());
-
-        startAtTime();
-    }
+    return sendMessageAtTime(msg, SystemClock::uptimeNanos() + delay);
+}
 
-    for (int32_t i = 0; i < firedItems.size(); i++)
-        firedItems[i]->performWork();
+bool Handler::enqueueMessage(Message& msg, std::chrono::nanoseconds uptime)
+{
+    if (m_asynchronous)
+        msg.setAsynchronous(true);
+    return m_queue->enqueueWorkItem(std::make_unique<MessageWorkItem>(*this, uptime, msg));
 }
 
 void Handler::receivedMessage(Message& message)
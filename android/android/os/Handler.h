@@ -27,24 +27,60 @@
 
 #include <java/lang.h>
 
+#include <functional>
 #include <vector>
 
 namespace android {
 namespace os {
 
+template<typename T> class Future;
+class HandlerAwaitable;
 class HandlerProvider;
 class Looper;
 class Message;
+class MessageQueue;
 class MessageTarget;
-class WorkItem;
 
 class ANDROID_EXPORT Handler : public Object {
     friend class HandlerProvider;
+    friend class MessageQueue;
     friend class MessageTarget;
 public:
     typedef Handler* ptr_t;
 
+    // The lanes of a Looper queue. Due work of a higher priority is dispatched first, but every lane
+    // gets a weighted share of the dispatches, so that a burst of high priority work cannot starve the others.
+    enum class Priority : uint8_t {
+        Input,
+        Animation,
+        Normal,
+        Background,
+    };
+
+    static const size_t priorityCount = 4;
+
+    // Identifies a pending post, so that it can be removed from the message queue later.
+    class Token {
+        friend class MessageQueue;
+    public:
+        Token()
+            : m_sequence(0)
+        { }
+
+        // Returns true if the post was successfully placed into the message queue.
+        operator bool() const { return m_sequence != 0; }
+
+    private:
+        explicit Token(uint64_t sequence)
+            : m_sequence(sequence)
+        { }
+
+        uint64_t m_sequence;
+    };
+
     static std::shared_ptr<Handler> create();
+    // Create a new Handler whose posted messages and runnables are not subject to synchronization barriers such as display vsync.
+    static std::shared_ptr<Handler> createAsync();
     virtual ~Handler();
 
     Looper* getLooper();
@@ -65,52 +101,72 @@ public:
     // Remove any pending posts of messages with code 'what' that are in the message queue.
     void removeMessages(int32_t what);
 
-    // Causes the std::function<void ()> r to be added to the message queue.
-    bool post(std::function<void ()> r);
-    // Posts a message to an object that implements std::function<void ()>.
-    bool postAtFrontOfQueue(std::function<void ()> r);
-    // Causes the std::function<void ()> r to be added to the message queue, to be run at a specific time given by uptimeMillis.
-    bool postAtTime(std::function<void ()> r, std::chrono::milliseconds uptimeMillis);
-    // Causes the std::function<void ()> r to be added to the message queue, to be run after the specified amount of time elapses.
-    bool postDelayed(std::function<void ()> r, std::chrono::milliseconds delayMillis);
-
-    // Remove any pending posts of std::function<void ()> r that are in the message queue.
-    void removeCallbacks(std::function<void ()> r);
+    // Causes the Runnable r to be added to the message queue.
+    Token post(Runnable r);
+    // Posts a message to an object that implements Runnable.
+    Token postAtFrontOfQueue(Runnable r);
+    // Causes the Runnable r to be added to the message queue, to be run at a specific time given by uptime, in the SystemClock::uptimeNanos() time base.
+    Token postAtTime(Runnable r, std::chrono::nanoseconds uptime);
+    // Causes the Runnable r to be added to the message queue, to be run after the specified amount of time elapses.
+    Token postDelayed(Runnable r, std::chrono::nanoseconds delay);
+
+    // Causes function to be run on the thread of this Handler's Looper, and returns a Future of its result.
+    // Defined in Future.h.
+    template<typename T, typename Function> Future<T> postForResult(Function&& function);
+    template<typename Function> auto postForResult(Function&& function) -> Future<decltype(function())>;
+
+    // Returns an awaitable which resumes the awaiting coroutine on the thread of this Handler's Looper.
+    // Defined in Coroutine.h, for clients built with C++20 coroutines.
+    HandlerAwaitable schedule();
+
+    // Remove any pending posts of Runnable r that are in the message queue.
+    // Only Runnables wrapping a plain function can be matched; use the Token returned by post*() otherwise.
+    void removeCallbacks(const Runnable& r);
+    // Remove the pending post identified by token, if it has not run yet.
+    void removeCallbacks(const Token& token);
+
+    // Allow delayed messages and runnables of this Handler to run up to slack late, so that the
+    // Looper can serve them with a wakeup it needs anyway, like the timer slack of a Linux thread.
+    void setTimerSlack(std::chrono::nanoseconds slack);
+    std::chrono::nanoseconds getTimerSlack() const;
+
+    // Set the lane the messages and runnables posted from now on to this Handler are dispatched in.
+    void setPriority(Priority priority);
+    Priority getPriority() const;
 
     // Sends a Message containing only the what value.
     bool sendEmptyMessage(int32_t what);
     // Sends a Message containing only the what value, to be delivered at a specific time.
-    bool sendEmptyMessageAtTime(int32_t what, std::chrono::milliseconds uptimeMillis);
+    bool sendEmptyMessageAtTime(int32_t what, std::chrono::nanoseconds uptime);
     // Sends a Message containing only the what value, to be delivered after the specified amount of time elapses.
-    bool sendEmptyMessageDelayed(int32_t what, std::chrono::milliseconds delayMillis);
+    bool sendEmptyMessageDelayed(int32_t what, std::chrono::nanoseconds delay);
 
     // Pushes a message onto the end of the message queue after all pending messages before the current time.
     bool sendMessage(Message& msg);
     // Enqueue a message at the front of the message queue, to be processed on the next iteration of the message loop.
     bool sendMessageAtFrontOfQueue(Message& msg);
-    // Enqueue a message into the message queue after all pending messages before the absolute time (in milliseconds); uptimeMillis.
-    virtual bool sendMessageAtTime(Message& msg, std::chrono::milliseconds uptimeMillis);
-    // Enqueue a message into the message queue after all pending messages before (current time + delayMillis);.
-    bool sendMessageDelayed(Message& msg, std::chrono::milliseconds delayMillis);
+    // Enqueue a message into the message queue after all pending messages before the absolute time uptime, in the SystemClock::uptimeNanos() time base.
+    virtual bool sendMessageAtTime(Message& msg, std::chrono::nanoseconds uptime);
+    // Enqueue a message into the message queue after all pending messages before (current time + delay).
+    bool sendMessageDelayed(Message& msg, std::chrono::nanoseconds delay);
 
 protected:
     Handler();
+    // Use the provided Looper of the current thread, and set whether the handler should be asynchronous.
+    explicit Handler(bool async);
 
 private:
-    template<typename... Arguments> void removeWorkItems(Arguments...);
-
-    bool start();
-    bool startAtTime();
-    void stop();
+    bool enqueueMessage(Message&, std::chrono::nanoseconds uptime);
 
     // HandlerProvider
-    void performMessages();
     void receivedMessage(Message&);
 
     std::unique_ptr<HandlerProvider> m_handler;
-    std::vector<std::unique_ptr<WorkItem>> m_workQueue;
-    std::chrono::milliseconds m_nextFireTime;
     Looper* m_looper;
+    std::shared_ptr<MessageQueue> m_queue;
+    bool m_asynchronous;
+    std::chrono::nanoseconds m_timerSlack;
+    Priority m_priority;
 };
 
 } // namespace os
@@ -25,13 +25,15 @@
 
 #include "Looper.h"
 
+#include "SystemClock.h"
+
 #include <assert>
-#include <pthread.h>
 
 namespace android {
 namespace os {
 
 Looper::Looper()
+    : m_queue(new MessageQueue)
 {
 }
 
@@ -40,7 +42,6 @@ Looper::~Looper()
 }
 
 static Looper* mainLooper;
-extern pthread_main_np_t mainThreadIdentifier; // Thread.cpp
 
 // Returns the application's main looper, which lives in the main thread of the application.
 Looper* Looper::getMainLooper()
@@ -59,6 +60,13 @@ Looper* Looper::myLooper()
     return threadLooper;
 }
 
+// Return the MessageQueue object associated with the current thread.
+MessageQueue& Looper::myQueue()
+{
+    assert(threadLooper);
+    return threadLooper->getQueue();
+}
+
 // Initialize the current thread as a looper, marking it as an application's main looper.
 void Looper::prepareMainLooper()
 {
@@ -66,10 +74,8 @@ void Looper::prepareMainLooper()
         return;
 
     prepare();
-    pthread_init_main_np();
 
     mainLooper = threadLooper;
-    mainThreadIdentifier = pthread_get_main_np();
 
     platformLooperPrepareMain();
 }
@@ -91,6 +97,7 @@ void Looper::loop()
     platformLooperLoop();
 
     delete threadLooper;
+    threadLooper = nullptr;
 }
 
 // Quits the looper.
@@ -105,5 +112,92 @@ void Looper::quitSafely()
     platformLooperQuit(0);
 }
 
+// Gets this looper's message queue.
+MessageQueue& Looper::getQueue()
+{
+    return *m_queue;
+}
+
+// Add a new IdleHandler to this looper's message queue.
+void Looper::addIdleHandler(std::shared_ptr<MessageQueue::IdleHandler> handler)
+{
+    m_queue->addIdleHandler(std::move(handler));
+}
+
+// Remove an IdleHandler that was previously added with addIdleHandler().
+void Looper::removeIdleHandler(const std::shared_ptr<MessageQueue::IdleHandler>& handler)
+{
+    m_queue->removeIdleHandler(handler);
+}
+
+// Adds a file descriptor to be watched by this looper.
+bool Looper::addFd(int32_t fd, int32_t events, MessageQueue::TriggerMode mode, std::function<int32_t (int32_t, int32_t)> callback,
+    std::shared_ptr<Handler> handler)
+{
+    return m_queue->addFileDescriptor(fd, events, mode, std::move(callback), std::move(handler));
+}
+
+// Removes a file descriptor previously added with addFd().
+void Looper::removeFd(int32_t fd)
+{
+    m_queue->removeOnFileDescriptorEventListener(fd);
+}
+
+// Control logging of messages as they are processed by this Looper.
+void Looper::setMessageLogging(std::function<void (const LooperStats::Dispatch&)> logging)
+{
+    m_queue->setMessageLogging(std::move(logging));
+}
+
+// Log a warning for every dispatch which runs longer than threshold.
+void Looper::setSlowDispatchThreshold(std::chrono::nanoseconds threshold)
+{
+    m_queue->setSlowDispatchThreshold(threshold);
+}
+
+// Enable or disable collecting dispatch statistics for this Looper.
+void Looper::setStatisticsEnabled(bool enabled)
+{
+    m_queue->setStatisticsEnabled(enabled);
+}
+
+// Returns the statistics collected since they were enabled or last reset.
+LooperStats Looper::getStatistics()
+{
+    return m_queue->getStatistics();
+}
+
+// Clears the statistics collected so far.
+void Looper::resetStatistics()
+{
+    m_queue->resetStatistics();
+}
+
+// Keep work which is not due soon in a hierarchical timing wheel.
+void Looper::setTimingWheelEnabled(bool enabled)
+{
+    m_queue->setTimingWheelEnabled(enabled);
+}
+
+// Dispatch all work which is due at the current time.
+void Looper::idle()
+{
+    m_queue->performWorkItemsUntil(SystemClock::uptimeNanos());
+}
+
+// Advance the virtual clock by duration, dispatching the work due in between at its fire time.
+void Looper::idleFor(std::chrono::nanoseconds duration)
+{
+    assert(SystemClock::isVirtualTimeEnabled());
+    m_queue->performWorkItemsUntil(SystemClock::uptimeNanos() + duration);
+}
+
+// Dispatch all pending work, advancing the virtual clock to the fire time of each item.
+void Looper::runToEndOfTasks()
+{
+    assert(SystemClock::isVirtualTimeEnabled());
+    m_queue->performWorkItemsUntil(std::chrono::nanoseconds::max());
+}
+
 } // namespace os
 } // namespace android
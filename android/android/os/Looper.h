@@ -26,18 +26,23 @@
 #pragma once
 
 #include <android/os/Message.h>
+#include <android/os/MessageQueue.h>
 
 namespace android {
 namespace os {
 
+class Handler;
 class LooperHolder;
 
 class ANDROID_EXPORT Looper {
+    friend class Handler;
 public:
     // Returns the application's main looper, which lives in the main thread of the application.
     static Looper* getMainLooper();
     // Return the Looper object associated with the current thread.
     static Looper* myLooper();
+    // Return the MessageQueue object associated with the current thread.
+    static MessageQueue& myQueue();
 
     // Initialize the current thread as a looper, marking it as an application's main looper.
     static void prepareMainLooper();
@@ -52,13 +57,56 @@ public:
     // Quits the looper safely.
     virtual void quitSafely();
 
+    // Gets this looper's message queue.
+    MessageQueue& getQueue();
+
+    // Add a new IdleHandler to this looper's message queue.
+    void addIdleHandler(std::shared_ptr<MessageQueue::IdleHandler> handler);
+    // Remove an IdleHandler that was previously added with addIdleHandler().
+    void removeIdleHandler(const std::shared_ptr<MessageQueue::IdleHandler>& handler);
+
+    // Adds a file descriptor to be watched by this looper, with the MessageQueue::OnFileDescriptorEventListener events.
+    // callback is called on the thread of this looper, or posted to handler if one is given, and returns the events to
+    // keep watching, or 0 to remove the file descriptor. Returns false where the platform cannot watch file descriptors.
+    bool addFd(int32_t fd, int32_t events, MessageQueue::TriggerMode mode, std::function<int32_t (int32_t fd, int32_t events)> callback,
+        std::shared_ptr<Handler> handler = nullptr);
+    // Removes a file descriptor previously added with addFd().
+    void removeFd(int32_t fd);
+
+    // Control logging of messages as they are processed by this Looper. Pass an empty function to disable it.
+    void setMessageLogging(std::function<void (const LooperStats::Dispatch&)> logging);
+    // Log a warning for every dispatch which runs longer than threshold. A zero threshold disables it.
+    void setSlowDispatchThreshold(std::chrono::nanoseconds threshold);
+    // Enable or disable collecting dispatch statistics for this Looper.
+    void setStatisticsEnabled(bool enabled);
+    // Returns the statistics collected since they were enabled or last reset.
+    LooperStats getStatistics();
+    // Clears the statistics collected so far.
+    void resetStatistics();
+
+    // Keep work which is not due soon in a hierarchical timing wheel, which arms and cancels in O(1).
+    // Worth it for loopers holding many long timeouts, most of which are removed before they fire.
+    void setTimingWheelEnabled(bool enabled);
+
+    // Drive this looper from its own thread without loop(), like a paused Looper of Robolectric.
+    // Combined with SystemClock::setVirtualTimeEnabled(), delayed work runs as fast as it is
+    // dispatched, in the same order as it would in real time.
+    // Dispatch all work which is due at the current time.
+    void idle();
+    // Advance the virtual clock by duration, dispatching the work due in between at its fire time.
+    void idleFor(std::chrono::nanoseconds duration);
+    // Dispatch all pending work, advancing the virtual clock to the fire time of each item.
+    void runToEndOfTasks();
+
 private:
     Looper();
     ~Looper();
 
     static void platformLooperPrepareMain();
     static void platformLooperLoop();
-    static void platformLooperQuit(int32_t);
+    void platformLooperQuit(int32_t);
+
+    std::shared_ptr<MessageQueue> m_queue;
 };
 
 } // namespace os
@@ -0,0 +1,80 @@
+/*
+ * Copyright (C) 2016 Naver Corp. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "LooperStats.h"
+
+#include <algorithm>
+
+namespace android {
+namespace os {
+
+LooperStats::Histogram::Histogram()
+    : m_count(0)
+    , m_total(std::chrono::nanoseconds::zero())
+    , m_max(std::chrono::nanoseconds::zero())
+{
+    m_buckets.fill(0);
+}
+
+void LooperStats::Histogram::add(std::chrono::nanoseconds duration)
+{
+    uint64_t micros = static_cast<uint64_t>(std::max<int64_t>(std::chrono::duration_cast<std::chrono::microseconds>(duration).count(), 0));
+    size_t index = 0;
+    while (micros && index < bucketCount - 1) {
+        micros >>= 1;
+        ++index;
+    }
+
+    ++m_buckets[index];
+    ++m_count;
+    m_total += duration;
+    m_max = std::max(m_max, duration);
+}
+
+std::chrono::nanoseconds LooperStats::Histogram::percentile(double fraction) const
+{
+    if (!m_count)
+        return std::chrono::nanoseconds::zero();
+
+    uint64_t threshold = static_cast<uint64_t>(fraction * m_count);
+    uint64_t count = 0;
+    for (size_t index = 0; index < bucketCount - 1; ++index) {
+        count += m_buckets[index];
+        if (count > threshold || count == m_count)
+            return std::chrono::microseconds(1ll << index);
+    }
+    return m_max;
+}
+
+LooperStats::LooperStats()
+    : queueDepthHighWaterMark(0)
+    , slowDispatchCount(0)
+    , wakeupCount(0)
+    , wakeupsSaved(0)
+{
+}
+
+} // namespace os
+} // namespace android
@@ -0,0 +1,99 @@
+/*
+ * Copyright (C) 2016 Naver Corp. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <android/os/Handler.h>
+
+#include <array>
+#include <chrono>
+
+namespace android {
+namespace os {
+
+// Dispatch statistics of a Looper, collected while enabled with Looper::setStatisticsEnabled().
+class ANDROID_EXPORT LooperStats {
+public:
+    // Counts durations in power-of-two microsecond buckets: bucket 0 holds durations below 1us,
+    // bucket i those in [2^(i-1)us, 2^i us), and the last bucket everything longer.
+    class ANDROID_EXPORT Histogram {
+    public:
+        static const size_t bucketCount = 24;
+
+        Histogram();
+
+        void add(std::chrono::nanoseconds duration);
+
+        uint64_t count() const { return m_count; }
+        uint64_t bucket(size_t index) const { return m_buckets[index]; }
+        std::chrono::nanoseconds total() const { return m_total; }
+        std::chrono::nanoseconds max() const { return m_max; }
+        // Returns the upper bound of the bucket holding the given fraction of all durations.
+        std::chrono::nanoseconds percentile(double fraction) const;
+
+    private:
+        std::array<uint64_t, bucketCount> m_buckets;
+        uint64_t m_count;
+        std::chrono::nanoseconds m_total;
+        std::chrono::nanoseconds m_max;
+    };
+
+    // One dispatched message or runnable, as passed to the message logging of a Looper.
+    struct Dispatch {
+        Handler* target;
+        Handler::Priority priority;
+        // The what of a message, or 0 for runnables.
+        int32_t what;
+        // The code a runnable was posted with, see Runnable::code(), or nullptr for messages.
+        const void* callback;
+        // The time between the item being due, or enqueued if that was later, and its dispatch.
+        std::chrono::nanoseconds latency;
+        // The time spent in handleMessage() or running the runnable.
+        std::chrono::nanoseconds duration;
+    };
+
+    LooperStats();
+
+    // Time between work being due and being dispatched.
+    Histogram dispatchLatency;
+    // Time between work being due and being dispatched, for each priority lane.
+    std::array<Histogram, Handler::priorityCount> priorityLatency;
+    // Time spent dispatching work.
+    Histogram executionTime;
+    // The largest number of pending items seen in the queue.
+    size_t queueDepthHighWaterMark;
+    // Dispatches which exceeded the slow dispatch threshold.
+    uint64_t slowDispatchCount;
+    // Times the looper woke up to dispatch due work.
+    uint64_t wakeupCount;
+    // Later fire times served by the wakeup of an earlier one thanks to timer slack, each of which
+    // would have taken a wakeup of its own.
+    uint64_t wakeupsSaved;
+};
+
+} // namespace os
+} // namespace android
+
+using LooperStats = android::os::LooperStats;
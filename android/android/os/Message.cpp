@@ -27,10 +27,32 @@
 
 #include "Bundle.h"
 #include "Messenger.h"
+#include <android/os/MessagePool.h>
+
+#include <new>
 
 namespace android {
 namespace os {
 
+// The Bundles of Messages come from the global pool too, so that copying a sent Message
+// into its queue entry does not allocate. Copies share the contents of the Bundle.
+template<typename... Arguments>
+static Bundle* obtainBundle(Arguments&&... arguments)
+{
+    return new (MessagePool::obtain(sizeof(Bundle))) Bundle(std::forward<Arguments>(arguments)...);
+}
+
+static void recycleBundle(Bundle* bundle)
+{
+    if (!bundle)
+        return;
+
+    bundle->~Bundle();
+    MessagePool::recycle(bundle);
+}
+
+static_assert(sizeof(Bundle) <= MessagePool::nodeSize, "Bundle must fit in a pooled node");
+
 Message::Message()
     : what(0)
     , arg1(0)
@@ -39,6 +61,8 @@ Message::Message()
     , target(0)
     , replyTo(0)
     , data(nullptr)
+    , asynchronous(false)
+    , requestId(0)
 {
 }
 
@@ -49,7 +73,9 @@ Message::Message(const Message& o)
     , obj(o.obj)
     , target(o.target)
     , replyTo(o.replyTo)
-    , data((o.data) ? new Bundle(*o.data) : nullptr)
+    , data((o.data) ? obtainBundle(*o.data) : nullptr)
+    , asynchronous(o.asynchronous)
+    , requestId(o.requestId)
 {
 }
 
@@ -61,14 +87,15 @@ Message::Message(Message&& o)
     , target(o.target)
     , replyTo(std::move(o.replyTo))
     , data(o.data)
+    , asynchronous(o.asynchronous)
+    , requestId(o.requestId)
 {
     o.data = nullptr;
 }
 
 Message::~Message()
 {
-    if (data)
-        delete data;
+    recycleBundle(data);
 }
 
 Message Message::obtain()
@@ -130,30 +157,77 @@ Message Message::obtain(const Message& orig)
     m.obj = orig.obj;
     m.target = orig.target;
     m.replyTo = orig.replyTo;
-    m.data = (orig.data) ? new Bundle(*orig.data) : nullptr;
+    m.data = (orig.data) ? obtainBundle(*orig.data) : nullptr;
+    m.asynchronous = orig.asynchronous;
+    m.requestId = orig.requestId;
     return m;
 }
 
+void Message::recycle()
+{
+    what = 0;
+    arg1 = 0;
+    arg2 = 0;
+    obj = 0;
+    target = nullptr;
+    replyTo = nullptr;
+    asynchronous = false;
+    requestId = 0;
+
+    if (data) {
+        recycleBundle(data);
+        data = nullptr;
+    }
+}
+
+bool Message::isAsynchronous() const
+{
+    return asynchronous;
+}
+
+void Message::setAsynchronous(bool async)
+{
+    asynchronous = async;
+}
+
+int32_t Message::getRequestId() const
+{
+    return requestId;
+}
+
+void Message::setRequestId(int32_t id)
+{
+    requestId = id;
+}
+
+uint64_t Message::getPoolHitCount()
+{
+    return MessagePool::hitCount();
+}
+
+uint64_t Message::getPoolMissCount()
+{
+    return MessagePool::missCount();
+}
+
 void Message::setData(Bundle& data)
 {
-    if (this->data)
-        delete this->data;
+    recycleBundle(this->data);
 
-    this->data = new Bundle(data);
+    this->data = obtainBundle(data);
 }
 
 void Message::setData(Bundle&& data)
 {
-    if (this->data)
-        delete this->data;
+    recycleBundle(this->data);
 
-    this->data = new Bundle(data);
+    this->data = obtainBundle(std::move(data));
 }
 
 Bundle& Message::getData()
 {
     if (!data)
-        data = new Bundle;
+        data = obtainBundle();
 
     return *data;
 }
@@ -171,7 +245,11 @@ Message& Message::operator=(Message&& other)
     obj = other.obj;
     target = other.target;
     replyTo = std::move(other.replyTo);
+    if (data != other.data)
+        recycleBundle(data);
     data = other.data;
+    asynchronous = other.asynchronous;
+    requestId = other.requestId;
     other.data = nullptr;
     return *this;
 }
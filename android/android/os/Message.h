@@ -47,8 +47,7 @@ public:
     Message(Message&&);
     ~Message();
 
-    // FIXME: Implement a global pool for obtain()s.
-    // Return a new Message instance from the global pool.
+    // Return a new Message instance. Messages are values, only their queue entries and Bundles come from the global pool.
     static Message obtain();
 
     // Same as obtain(), but sets the value for the target member on the Message returned.
@@ -67,6 +66,24 @@ public:
     // Same as obtain(), but copies the values of an existing message (including its target) into the new one.
     static Message obtain(const Message& orig);
 
+    // Clears all fields of this Message and releases its Bundle, so that the Message can be reused.
+    void recycle();
+
+    // Returns true if the message is asynchronous, meaning that it is not subject to Looper synchronization barriers.
+    bool isAsynchronous() const;
+    // Sets whether the message is asynchronous, meaning that it is not subject to Looper synchronization barriers.
+    void setAsynchronous(bool async);
+
+    // Returns the id correlating a request sent over a channel with its reply, or 0 if there is none.
+    int32_t getRequestId() const;
+    // Sets the id correlating a request sent over a channel with its reply.
+    void setRequestId(int32_t id);
+
+    // Returns the number of queued messages whose storage was reused from the global pool.
+    static uint64_t getPoolHitCount();
+    // Returns the number of queued messages whose storage had to be allocated.
+    static uint64_t getPoolMissCount();
+
     // Sets a Bundle of arbitrary data values. 
     void setData(Bundle& data);
     void setData(Bundle&& data);
@@ -79,6 +96,8 @@ public:
 
 private:
     mutable Bundle* data;
+    bool asynchronous;
+    int32_t requestId;
 };
 
 } // namespace os
@@ -0,0 +1,999 @@
+/*
+ * Copyright (C) 2016 Naver Corp. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "MessageQueue.h"
+
+#include <android/os/LooperProvider.h>
+#include <android/os/SystemClock.h>
+#include <android/os/TimingWheel.h>
+#include <android/os/WorkItem.h>
+
+#include <algorithm>
+
+#include <assert>
+
+namespace android {
+namespace os {
+
+// The share of the dispatches each lane gets while all of them have due work, indexed by Handler::Priority.
+// The background lane gets at least one dispatch in every round, however much input is pending.
+static const uint32_t laneWeights[Handler::priorityCount] = { 8, 4, 2, 1 };
+
+size_t MessageQueue::IndexKeyHash::operator()(const IndexKey& key) const
+{
+    size_t hash = std::hash<Handler*>()(key.owner);
+    hash ^= std::hash<intptr_t>()(key.key) + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+    return hash ^ key.type;
+}
+
+MessageQueue::MessageQueue()
+    : m_provider(LooperProvider::create(*this))
+    , m_thread(std::this_thread::get_id())
+    , m_inbox(nullptr)
+    , m_nextBarrierToken(0)
+    , m_nextFileDescriptorGeneration(1)
+    , m_tokenCount(0)
+    , m_nextFireTime(std::chrono::nanoseconds::max())
+    , m_armedHeadTime(std::chrono::nanoseconds::max())
+    , m_coalescedFireTime(std::chrono::nanoseconds::max())
+    , m_nextSequence(1)
+    , m_instrumented(false)
+    , m_slowDispatchThreshold(std::chrono::nanoseconds::zero())
+    , m_statisticsEnabled(false)
+{
+    for (size_t priority = 0; priority < m_lanes.size(); ++priority)
+        m_lanes[priority].credits = laneWeights[priority];
+}
+
+MessageQueue::~MessageQueue()
+{
+    m_provider->stop();
+
+    WorkItem* item = m_inbox.exchange(nullptr, std::memory_order_acquire);
+    while (item) {
+        WorkItem* next = item->m_nextInInbox;
+        delete item;
+        item = next;
+    }
+}
+
+// Returns true if the looper has no pending messages which are due to be processed.
+bool MessageQueue::isIdle()
+{
+    synchronized (this) {
+        drainInbox();
+        return nextFireTime() > SystemClock::uptimeNanos();
+    }
+    return true;
+}
+
+// Add a new IdleHandler to this message queue.
+void MessageQueue::addIdleHandler(std::shared_ptr<IdleHandler> handler)
+{
+    assert(handler);
+
+    synchronized (this) {
+        m_idleHandlers.push_back(std::move(handler));
+    }
+}
+
+// Remove an IdleHandler from the queue that was previously added with addIdleHandler().
+void MessageQueue::removeIdleHandler(const std::shared_ptr<IdleHandler>& handler)
+{
+    synchronized (this) {
+        m_idleHandlers.erase(std::remove(m_idleHandlers.begin(), m_idleHandlers.end(), handler), m_idleHandlers.end());
+    }
+}
+
+// Posts a synchronization barrier to the Looper's message queue.
+int32_t MessageQueue::postSyncBarrier()
+{
+    // Barriers take a sequence number like any post, so that work posted earlier at the same time still runs.
+    uint64_t sequence = m_nextSequence.fetch_add(1, std::memory_order_relaxed);
+    std::chrono::nanoseconds when = SystemClock::uptimeNanos();
+
+    synchronized (this) {
+        int32_t token = m_nextBarrierToken++;
+        m_syncBarriers.push_back({ token, when, sequence });
+        return token;
+    }
+    return -1;
+}
+
+// Removes a synchronization barrier.
+void MessageQueue::removeSyncBarrier(int32_t token)
+{
+    synchronized (this) {
+        auto it = std::find_if(m_syncBarriers.begin(), m_syncBarriers.end(), [=] (const SyncBarrier& barrier) {
+            return barrier.token == token;
+        });
+        if (it == m_syncBarriers.end()) {
+            LOGA("The specified message queue synchronization barrier token %d has not been posted or has already been removed.", token);
+            return;
+        }
+
+        m_syncBarriers.erase(it);
+        drainInbox();
+        // The work the barrier held back counts toward the coalesced wakeup again.
+        m_armedHeadTime = std::chrono::nanoseconds::max();
+        scheduleWorkItems();
+    }
+}
+
+// Adds a file descriptor listener to receive notification when file descriptor related events occur.
+bool MessageQueue::addOnFileDescriptorEventListener(int32_t fd, int32_t events, std::shared_ptr<OnFileDescriptorEventListener> listener,
+    TriggerMode mode, std::shared_ptr<Handler> handler)
+{
+    assert(listener);
+
+    return addFileDescriptor(fd, events, mode, [listener = std::move(listener)] (int32_t fd, int32_t events) {
+        return listener->onFileDescriptorEvents(fd, events);
+    }, std::move(handler));
+}
+
+// Removes a file descriptor listener.
+void MessageQueue::removeOnFileDescriptorEventListener(int32_t fd)
+{
+    std::function<int32_t (int32_t, int32_t)> removedCallback;
+
+    synchronized (this) {
+        auto it = m_fileDescriptors.find(fd);
+        if (it == m_fileDescriptors.end())
+            return;
+
+        m_provider->unwatchFileDescriptor(fd);
+        removedCallback = std::move(it->second.callback);
+        m_fileDescriptors.erase(it);
+    }
+
+    // The callback is destroyed outside of the lock, since it may own objects using this queue.
+}
+
+// A listener posted to a handler is watched one shot, so that a level triggered file descriptor
+// is not reported again while the listener waits in the queue. It is rearmed once the listener ran.
+bool MessageQueue::addFileDescriptor(int32_t fd, int32_t events, TriggerMode mode, std::function<int32_t (int32_t, int32_t)> callback, std::shared_ptr<Handler> handler)
+{
+    assert(fd >= 0 && events);
+    assert(!handler || handler->m_queue.get() == this);
+
+    std::function<int32_t (int32_t, int32_t)> replacedCallback;
+
+    synchronized (this) {
+        if (!m_provider->watchFileDescriptor(fd, events, mode == TriggerMode::Edge, !!handler))
+            return false;
+
+        FileDescriptorRecord& record = m_fileDescriptors[fd];
+        replacedCallback = std::move(record.callback);
+        record.events = events;
+        record.mode = mode;
+        record.callback = std::move(callback);
+        record.handler = std::move(handler);
+        record.generation = m_nextFileDescriptorGeneration++;
+        return true;
+    }
+    return false;
+}
+
+Handler::Token MessageQueue::enqueueWorkItem(std::unique_ptr<WorkItem>&& item)
+{
+    uint64_t sequence = m_nextSequence.fetch_add(1, std::memory_order_relaxed);
+    item->m_sequence = sequence;
+    if (UNLIKELY(m_instrumented.load(std::memory_order_relaxed)))
+        item->m_enqueueTime = SystemClock::uptimeNanos();
+
+    if (std::this_thread::get_id() == m_thread) {
+        std::unique_ptr<WorkItem> rejectedItem;
+        synchronized (this) {
+            WorkItem& insertedItem = *item;
+            insertWorkItem(std::move(item));
+            if (scheduleWorkItems())
+                return Handler::Token(sequence);
+
+            // Work which cannot be scheduled is not posted, rather than left to run at some later wakeup.
+            rejectedItem = detachWorkItem(insertedItem);
+        }
+        return Handler::Token();
+    }
+
+    WorkItem* inboxItem = item.release();
+    WorkItem* head = m_inbox.load(std::memory_order_relaxed);
+    do {
+        inboxItem->m_nextInInbox = head;
+    } while (!m_inbox.compare_exchange_weak(head, inboxItem, std::memory_order_release, std::memory_order_relaxed));
+
+    // Only the post that makes the inbox non-empty has to wake the looper.
+    if (!head)
+        m_provider->start();
+
+    return Handler::Token(sequence);
+}
+
+bool MessageQueue::hasWorkItems(Handler& owner, uint8_t type, intptr_t key)
+{
+    synchronized (this) {
+        drainInbox();
+        auto it = m_index.find({ &owner, key, type });
+        return it != m_index.end() && it->second;
+    }
+    return false;
+}
+
+void MessageQueue::removeWorkItems(Handler& owner, uint8_t type, intptr_t key)
+{
+    std::vector<std::unique_ptr<WorkItem>> removedItems;
+
+    synchronized (this) {
+        drainInbox();
+        auto it = m_index.find({ &owner, key, type });
+        if (it == m_index.end())
+            return;
+
+        while (WorkItem* item = it->second)
+            removedItems.push_back(detachWorkItem(*item));
+    }
+
+    // Removed items are destroyed outside of the lock, since they may own objects posting to this queue.
+}
+
+bool MessageQueue::removeWorkItem(Handler& owner, const Handler::Token& token)
+{
+    std::unique_ptr<WorkItem> removedItem;
+
+    synchronized (this) {
+        drainInbox();
+        WorkItem* item = findToken(token.m_sequence);
+        if (!item || &item->owner() != &owner)
+            return false;
+
+        removedItem = detachWorkItem(*item);
+    }
+
+    return true;
+}
+
+void MessageQueue::removeWorkItems(Handler& owner)
+{
+    std::vector<std::unique_ptr<WorkItem>> removedItems;
+
+    synchronized (this) {
+        drainInbox();
+
+        std::vector<WorkItem*> items;
+        for (auto& lane : m_lanes) {
+            for (auto* queue : { &lane.syncQueue, &lane.asyncQueue }) {
+                for (auto& item : queue->items())
+                    items.push_back(item.get());
+            }
+        }
+        if (m_timingWheel)
+            m_timingWheel->collectItems(items);
+
+        for (auto* item : items) {
+            if (&item->owner() == &owner)
+                removedItems.push_back(detachWorkItem(*item));
+        }
+
+        for (auto it = m_index.begin(); it != m_index.end();) {
+            if (it->first.owner == &owner)
+                it = m_index.erase(it);
+            else
+                ++it;
+        }
+    }
+}
+
+void MessageQueue::setTimerSlack(Handler& owner, std::chrono::nanoseconds slack)
+{
+    synchronized (this) {
+        owner.m_timerSlack = slack;
+        drainInbox();
+        // A smaller slack can pull the coalesced wakeup earlier than the head of the queue tells.
+        m_armedHeadTime = std::chrono::nanoseconds::max();
+        scheduleWorkItems();
+    }
+}
+
+// Work already in the queue stays in the lane it was posted to.
+void MessageQueue::setPriority(Handler& owner, Handler::Priority priority)
+{
+    synchronized (this) {
+        drainInbox();
+        owner.m_priority = priority;
+    }
+}
+
+void MessageQueue::performWorkItems()
+{
+    std::chrono::nanoseconds wakeupTime;
+
+    synchronized (this) {
+        // The provider consumed the wakeup it was armed for.
+        wakeupTime = m_nextFireTime;
+        m_nextFireTime = std::chrono::nanoseconds::max();
+        m_armedHeadTime = std::chrono::nanoseconds::max();
+        m_coalescedFireTime = std::chrono::nanoseconds::max();
+    }
+
+    // Work due after the first item run but no later than the armed wakeup time was batched
+    // into this wakeup by timer slack. Fire times are taken in order, so counting changes counts distinct ones.
+    std::chrono::nanoseconds firstFireTime = std::chrono::nanoseconds::max();
+    std::chrono::nanoseconds lastFireTime = std::chrono::nanoseconds::max();
+    uint64_t wakeupsSaved = 0;
+    // Sampled once per wakeup, so that the uninstrumented path only pays for this branch.
+    bool instrumented = m_instrumented.load(std::memory_order_relaxed);
+
+    std::chrono::nanoseconds currentTime = SystemClock::uptimeNanos();
+    while (std::unique_ptr<WorkItem> workItem = takeWorkItem(currentTime)) {
+        if (LIKELY(!instrumented)) {
+            workItem->performWork();
+            continue;
+        }
+
+        std::chrono::nanoseconds fireTime = workItem->fireTime();
+        if (firstFireTime == std::chrono::nanoseconds::max())
+            firstFireTime = fireTime;
+        else if (fireTime > firstFireTime && fireTime <= wakeupTime && fireTime != lastFireTime)
+            ++wakeupsSaved;
+        lastFireTime = fireTime;
+
+        performInstrumentedWorkItem(*workItem);
+    }
+
+    if (UNLIKELY(instrumented)) {
+        synchronized (this) {
+            if (m_statisticsEnabled) {
+                ++m_statistics.wakeupCount;
+                m_statistics.wakeupsSaved += wakeupsSaved;
+            }
+        }
+    }
+
+    performIdleHandlers();
+}
+
+// Runs the work due until time on the calling looper thread, stepping the virtual clock to the
+// fire time of each batch, so that work runs in the order it would in real time.
+void MessageQueue::performWorkItemsUntil(std::chrono::nanoseconds time)
+{
+    assert(std::this_thread::get_id() == m_thread);
+
+    while (true) {
+        std::chrono::nanoseconds fireTime;
+        synchronized (this) {
+            drainInbox();
+            fireTime = nextFireTime();
+        }
+
+        if (fireTime > time || fireTime == std::chrono::nanoseconds::max())
+            break;
+
+        std::chrono::nanoseconds currentTime = SystemClock::uptimeNanos();
+        if (fireTime > currentTime)
+            SystemClock::advanceVirtualTime(fireTime - currentTime);
+
+        performWorkItems();
+    }
+
+    if (time != std::chrono::nanoseconds::max() && time > SystemClock::uptimeNanos())
+        SystemClock::advanceVirtualTime(time - SystemClock::uptimeNanos());
+}
+
+void MessageQueue::performFileDescriptorEvents(int32_t fd, int32_t events)
+{
+    std::function<int32_t (int32_t, int32_t)> callback;
+    std::shared_ptr<Handler> handler;
+    uint64_t generation;
+
+    synchronized (this) {
+        // A listener called earlier in the same wakeup may have removed this one.
+        auto it = m_fileDescriptors.find(fd);
+        if (it == m_fileDescriptors.end())
+            return;
+
+        callback = it->second.callback;
+        handler = it->second.handler;
+        generation = it->second.generation;
+    }
+
+    if (!handler) {
+        fileDescriptorEventsPerformed(fd, generation, callback(fd, events));
+        return;
+    }
+
+    handler->post([this, fd, events, generation, callback = std::move(callback)] {
+        fileDescriptorEventsPerformed(fd, generation, callback(fd, events));
+    });
+}
+
+void MessageQueue::fileDescriptorEventsPerformed(int32_t fd, uint64_t generation, int32_t events)
+{
+    std::function<int32_t (int32_t, int32_t)> removedCallback;
+
+    synchronized (this) {
+        // The listener may have been removed or replaced while it ran.
+        auto it = m_fileDescriptors.find(fd);
+        if (it == m_fileDescriptors.end() || it->second.generation != generation)
+            return;
+
+        FileDescriptorRecord& record = it->second;
+        if (!events) {
+            m_provider->unwatchFileDescriptor(fd);
+            removedCallback = std::move(record.callback);
+            m_fileDescriptors.erase(it);
+            return;
+        }
+
+        if (events != record.events || record.handler) {
+            record.events = events;
+            m_provider->watchFileDescriptor(fd, events, record.mode == TriggerMode::Edge, !!record.handler);
+        }
+    }
+}
+
+void MessageQueue::performInstrumentedWorkItem(WorkItem& item)
+{
+    // Messages are recycled once handled, so describe the item before running it.
+    LooperStats::Dispatch dispatch;
+    dispatch.target = &item.owner();
+    dispatch.priority = static_cast<Handler::Priority>(item.m_priority);
+    dispatch.what = item.m_type == WorkItem::MessageType ? static_cast<int32_t>(item.m_key) : 0;
+    dispatch.callback = item.callback();
+
+    std::chrono::nanoseconds dispatchTime = SystemClock::uptimeNanos();
+    item.performWork();
+    std::chrono::nanoseconds finishTime = SystemClock::uptimeNanos();
+
+    // Items enqueued before instrumentation was enabled and posted at the front of the queue have no reference time.
+    std::chrono::nanoseconds dueTime = std::max(item.m_enqueueTime, item.fireTime());
+    dispatch.latency = dueTime.count() ? std::max(dispatchTime - dueTime, std::chrono::nanoseconds::zero()) : std::chrono::nanoseconds::zero();
+    dispatch.duration = finishTime - dispatchTime;
+
+    std::function<void (const LooperStats::Dispatch&)> messageLogging;
+    bool slowDispatch = false;
+
+    synchronized (this) {
+        slowDispatch = m_slowDispatchThreshold.count() && dispatch.duration > m_slowDispatchThreshold;
+        if (m_statisticsEnabled) {
+            if (dueTime.count()) {
+                m_statistics.dispatchLatency.add(dispatch.latency);
+                m_statistics.priorityLatency[item.m_priority].add(dispatch.latency);
+            }
+            m_statistics.executionTime.add(dispatch.duration);
+            if (slowDispatch)
+                ++m_statistics.slowDispatchCount;
+        }
+        messageLogging = m_messageLogging;
+    }
+
+    if (slowDispatch)
+        LOGW("Slow dispatch took %lldms h=%p c=%p m=%d", static_cast<long long>(std::chrono::duration_cast<std::chrono::milliseconds>(dispatch.duration).count()), dispatch.target, dispatch.callback, dispatch.what);
+
+    if (messageLogging)
+        messageLogging(dispatch);
+}
+
+void MessageQueue::setMessageLogging(std::function<void (const LooperStats::Dispatch&)> logging)
+{
+    synchronized (this) {
+        m_messageLogging = std::move(logging);
+        updateInstrumented();
+    }
+}
+
+void MessageQueue::setSlowDispatchThreshold(std::chrono::nanoseconds threshold)
+{
+    synchronized (this) {
+        m_slowDispatchThreshold = std::max(threshold, std::chrono::nanoseconds::zero());
+        updateInstrumented();
+    }
+}
+
+void MessageQueue::setStatisticsEnabled(bool enabled)
+{
+    synchronized (this) {
+        m_statisticsEnabled = enabled;
+        updateInstrumented();
+    }
+}
+
+LooperStats MessageQueue::getStatistics()
+{
+    synchronized (this) {
+        return m_statistics;
+    }
+    return LooperStats();
+}
+
+void MessageQueue::resetStatistics()
+{
+    synchronized (this) {
+        m_statistics = LooperStats();
+    }
+}
+
+void MessageQueue::setTimingWheelEnabled(bool enabled)
+{
+    synchronized (this) {
+        if (enabled == !!m_timingWheel)
+            return;
+
+        drainInbox();
+
+        if (enabled) {
+            m_timingWheel.reset(new TimingWheel(SystemClock::uptimeNanos()));
+            return;
+        }
+
+        // Hand the work waiting in the wheel over to the heaps.
+        std::vector<WorkItem*> items;
+        m_timingWheel->collectItems(items);
+        for (WorkItem* item : items)
+            m_expiredWorkItems.push_back(m_timingWheel->remove(*item));
+        m_timingWheel.reset();
+
+        for (auto& item : m_expiredWorkItems)
+            placeWorkItem(std::move(item));
+        m_expiredWorkItems.clear();
+
+        scheduleWorkItems();
+    }
+}
+
+void MessageQueue::updateInstrumented()
+{
+    m_instrumented.store(m_messageLogging || m_slowDispatchThreshold.count() || m_statisticsEnabled, std::memory_order_relaxed);
+}
+
+// Runs the idle handlers once the due work is done, before the looper goes back to sleep.
+void MessageQueue::performIdleHandlers()
+{
+    std::chrono::nanoseconds idleTime;
+    // An idle handler may idle the Looper again, so each call iterates its own copy.
+    std::vector<std::shared_ptr<IdleHandler>> idleHandlers;
+
+    synchronized (this) {
+        if (m_idleHandlers.empty())
+            return;
+
+        drainInbox();
+        std::chrono::nanoseconds fireTime = nextFireTime();
+        if (fireTime != std::chrono::nanoseconds::max()) {
+            idleTime = fireTime - SystemClock::uptimeNanos();
+            if (idleTime <= std::chrono::nanoseconds::zero())
+                return;
+        } else {
+            idleTime = std::chrono::nanoseconds::max();
+        }
+
+        idleHandlers = m_idleHandlers;
+    }
+
+    for (auto& idleHandler : idleHandlers) {
+        if (!idleHandler->queueIdle(idleTime))
+            removeIdleHandler(idleHandler);
+    }
+}
+
+std::unique_ptr<WorkItem> MessageQueue::takeWorkItem(std::chrono::nanoseconds currentTime)
+{
+    synchronized (this) {
+        drainInbox();
+        if (m_timingWheel)
+            advanceTimingWheel(currentTime);
+
+        WorkItem* item = nextDueWorkItem(currentTime);
+        if (!item) {
+            scheduleWorkItems();
+            return nullptr;
+        }
+
+        return detachWorkItem(*item);
+    }
+    return nullptr;
+}
+
+// Moves the posts of other threads into the heap. Must be called with the queue locked,
+// which makes the lock holder the single consumer of the inbox.
+void MessageQueue::drainInbox()
+{
+    WorkItem* item = m_inbox.exchange(nullptr, std::memory_order_acquire);
+    while (item) {
+        WorkItem* next = item->m_nextInInbox;
+        item->m_nextInInbox = nullptr;
+        insertWorkItem(std::unique_ptr<WorkItem>(item));
+        item = next;
+    }
+}
+
+void MessageQueue::insertWorkItem(std::unique_ptr<WorkItem>&& item)
+{
+    item->m_priority = static_cast<uint8_t>(item->owner().m_priority);
+    link(*item);
+    addToken(*item);
+    placeWorkItem(std::move(item));
+
+    if (UNLIKELY(m_statisticsEnabled))
+        m_statistics.queueDepthHighWaterMark = std::max(m_statistics.queueDepthHighWaterMark, m_tokenCount);
+}
+
+void MessageQueue::placeWorkItem(std::unique_ptr<WorkItem>&& item)
+{
+    if (m_timingWheel && m_timingWheel->insert(item))
+        return;
+
+    // Folding the item into the coalesced wakeup time here saves walking the heaps for it when scheduling.
+    std::chrono::nanoseconds slack = item->owner().m_timerSlack;
+    if (item->fireTime() < m_coalescedFireTime - slack && (item->m_asynchronous || !isBlockedBySyncBarrier(*item)))
+        m_coalescedFireTime = item->fireTime() + slack;
+
+    WorkItemHeap& queue = queueOf(*item);
+    queue.push(std::move(item));
+}
+
+// Moves the work whose wheel slot expired closer to its fire time, either to a lower level of the wheel or into the heaps.
+void MessageQueue::advanceTimingWheel(std::chrono::nanoseconds currentTime)
+{
+    m_timingWheel->advance(currentTime, m_expiredWorkItems);
+    for (auto& item : m_expiredWorkItems)
+        placeWorkItem(std::move(item));
+    m_expiredWorkItems.clear();
+}
+
+// Removes the item from the heap, its index list and the token table, in O(log n).
+std::unique_ptr<WorkItem> MessageQueue::detachWorkItem(WorkItem& item)
+{
+    std::unique_ptr<WorkItem> detachedItem;
+    if (item.m_wheelLevel)
+        detachedItem = m_timingWheel->remove(item);
+    else
+        detachedItem = queueOf(item).remove(item);
+
+    unlink(item);
+    removeToken(item);
+
+    if (!hasPendingWorkItems() && m_nextFireTime != std::chrono::nanoseconds::max()) {
+        m_nextFireTime = std::chrono::nanoseconds::max();
+        m_armedHeadTime = std::chrono::nanoseconds::max();
+        m_coalescedFireTime = std::chrono::nanoseconds::max();
+        m_provider->stop();
+    }
+
+    return detachedItem;
+}
+
+bool MessageQueue::scheduleWorkItems()
+{
+    // Only rearm the platform wakeup when the head of the queue moved before the armed fire time.
+    std::chrono::nanoseconds headTime = nextFireTime();
+    if (headTime >= m_nextFireTime)
+        return true;
+
+    // Work which is due already runs right away, timer slack only delays wakeups for future work.
+    std::chrono::nanoseconds fireTime = headTime;
+    bool scheduled;
+    if (fireTime <= SystemClock::uptimeNanos()) {
+        scheduled = m_provider->start();
+    } else {
+        // The heaps are only walked again when the head moved before the armed one. Work placed behind it
+        // was folded into the coalesced time already, and so was work going into the wheel through its expiry.
+        if (headTime < m_armedHeadTime)
+            m_coalescedFireTime = coalescedFireTime();
+        else if (m_timingWheel)
+            m_coalescedFireTime = std::min(m_coalescedFireTime, m_timingWheel->nextExpiryTime());
+        m_armedHeadTime = headTime;
+
+        fireTime = m_coalescedFireTime;
+        if (fireTime >= m_nextFireTime)
+            return true;
+        scheduled = m_provider->startAtTime(fireTime);
+    }
+
+    // Nothing is armed after a failure, so that the next schedule tries again.
+    m_nextFireTime = scheduled ? fireTime : std::chrono::nanoseconds::max();
+    m_armedHeadTime = scheduled ? headTime : std::chrono::nanoseconds::max();
+    m_coalescedFireTime = scheduled ? fireTime : std::chrono::nanoseconds::max();
+    return scheduled;
+}
+
+MessageQueue::WorkItemHeap& MessageQueue::queueOf(const WorkItem& item)
+{
+    Lane& lane = m_lanes[item.m_priority];
+    return item.m_asynchronous ? lane.asyncQueue : lane.syncQueue;
+}
+
+// Returns the item of the lane to dispatch next, skipping synchronous work held back by a sync barrier.
+WorkItem* MessageQueue::nextWorkItem(const Lane& lane) const
+{
+    WorkItem* syncItem = lane.syncQueue.top();
+    if (syncItem && isBlockedBySyncBarrier(*syncItem))
+        syncItem = nullptr;
+
+    WorkItem* asyncItem = lane.asyncQueue.top();
+    if (!syncItem || !asyncItem)
+        return syncItem ? syncItem : asyncItem;
+
+    return asyncItem->isLaterThan(*syncItem) ? syncItem : asyncItem;
+}
+
+// Returns the due item of the highest priority lane with credits left, and charges the lane for it.
+// Once every lane with due work has used up its credits, a new round starts with all credits restored.
+WorkItem* MessageQueue::nextDueWorkItem(std::chrono::nanoseconds currentTime)
+{
+    for (int round = 0; round < 2; ++round) {
+        bool hasDueWork = false;
+        for (auto& lane : m_lanes) {
+            WorkItem* item = nextWorkItem(lane);
+            if (!item || item->fireTime() > currentTime)
+                continue;
+
+            hasDueWork = true;
+            if (lane.credits) {
+                --lane.credits;
+                return item;
+            }
+        }
+
+        if (!hasDueWork)
+            return nullptr;
+
+        for (size_t priority = 0; priority < m_lanes.size(); ++priority)
+            m_lanes[priority].credits = laneWeights[priority];
+    }
+    return nullptr;
+}
+
+// Returns when the looper has to wake up next, either to dispatch work or to advance the timing wheel.
+std::chrono::nanoseconds MessageQueue::nextFireTime() const
+{
+    std::chrono::nanoseconds fireTime = std::chrono::nanoseconds::max();
+    for (auto& lane : m_lanes) {
+        if (WorkItem* item = nextWorkItem(lane))
+            fireTime = std::min(fireTime, item->fireTime());
+    }
+    if (m_timingWheel)
+        fireTime = std::min(fireTime, m_timingWheel->nextExpiryTime());
+    return fireTime;
+}
+
+// Returns the latest time the looper can wake up at without running any work later than
+// its fire time plus the timer slack of its handler, like the soft and hard expiry of a
+// Linux hrtimer. Only the items due before that time are visited, and those are going to
+// be run by that wakeup anyway.
+std::chrono::nanoseconds MessageQueue::coalescedFireTime() const
+{
+    std::chrono::nanoseconds deadline = std::chrono::nanoseconds::max();
+    if (m_timingWheel)
+        deadline = m_timingWheel->nextExpiryTime();
+
+    for (auto& lane : m_lanes) {
+        WorkItem* syncItem = lane.syncQueue.top();
+        if (syncItem && !isBlockedBySyncBarrier(*syncItem))
+            deadline = coalescedFireTime(lane.syncQueue, 0, deadline);
+        if (!lane.asyncQueue.isEmpty())
+            deadline = coalescedFireTime(lane.asyncQueue, 0, deadline);
+    }
+
+    return deadline;
+}
+
+std::chrono::nanoseconds MessageQueue::coalescedFireTime(const WorkItemHeap& queue, size_t index, std::chrono::nanoseconds deadline) const
+{
+    // Children fire no earlier than their parent, so whole subtrees past the deadline are skipped.
+    if (index >= queue.size())
+        return deadline;
+
+    WorkItem& item = *queue.at(index);
+    if (item.fireTime() >= deadline || (!item.m_asynchronous && isBlockedBySyncBarrier(item)))
+        return deadline;
+
+    std::chrono::nanoseconds slack = item.owner().m_timerSlack;
+    if (item.fireTime() < deadline - slack)
+        deadline = item.fireTime() + slack;
+
+    deadline = coalescedFireTime(queue, index * 2 + 1, deadline);
+    return coalescedFireTime(queue, index * 2 + 2, deadline);
+}
+
+bool MessageQueue::hasPendingWorkItems() const
+{
+    for (auto& lane : m_lanes) {
+        if (!lane.syncQueue.isEmpty() || !lane.asyncQueue.isEmpty())
+            return true;
+    }
+    return m_timingWheel && !m_timingWheel->isEmpty();
+}
+
+// Like in Android, a barrier only holds back synchronous work scheduled after it.
+bool MessageQueue::isBlockedBySyncBarrier(const WorkItem& item) const
+{
+    for (auto& barrier : m_syncBarriers) {
+        if (item.fireTime() > barrier.when || (item.fireTime() == barrier.when && item.m_sequence > barrier.sequence))
+            return true;
+    }
+    return false;
+}
+
+void MessageQueue::WorkItemHeap::push(std::unique_ptr<WorkItem>&& item)
+{
+    m_items.push_back(std::move(item));
+    siftUp(m_items.size() - 1);
+}
+
+std::unique_ptr<WorkItem> MessageQueue::WorkItemHeap::remove(WorkItem& item)
+{
+    size_t index = item.m_heapIndex;
+    std::unique_ptr<WorkItem> removedItem = std::move(m_items[index]);
+
+    size_t last = m_items.size() - 1;
+    if (index != last) {
+        m_items[index] = std::move(m_items[last]);
+        m_items.pop_back();
+        setHeapIndex(index);
+        siftUp(index);
+        siftDown(index);
+    } else {
+        m_items.pop_back();
+    }
+
+    return removedItem;
+}
+
+void MessageQueue::WorkItemHeap::siftUp(size_t index)
+{
+    while (index > 0) {
+        size_t parent = (index - 1) / 2;
+        if (!m_items[parent]->isLaterThan(*m_items[index]))
+            break;
+
+        std::swap(m_items[parent], m_items[index]);
+        setHeapIndex(index);
+        index = parent;
+    }
+    setHeapIndex(index);
+}
+
+void MessageQueue::WorkItemHeap::siftDown(size_t index)
+{
+    size_t size = m_items.size();
+    while (true) {
+        size_t earliest = index;
+        size_t left = index * 2 + 1;
+        size_t right = left + 1;
+        if (left < size && m_items[earliest]->isLaterThan(*m_items[left]))
+            earliest = left;
+        if (right < size && m_items[earliest]->isLaterThan(*m_items[right]))
+            earliest = right;
+        if (earliest == index)
+            break;
+
+        std::swap(m_items[earliest], m_items[index]);
+        setHeapIndex(index);
+        index = earliest;
+    }
+    if (index < size)
+        setHeapIndex(index);
+}
+
+void MessageQueue::WorkItemHeap::setHeapIndex(size_t index)
+{
+    m_items[index]->m_heapIndex = static_cast<uint32_t>(index);
+}
+
+// Index lists are kept once created, so re-posting the same what does not allocate.
+void MessageQueue::link(WorkItem& item)
+{
+    if (item.m_type == WorkItem::UnindexedType)
+        return;
+
+    WorkItem*& head = m_index[{ &item.owner(), item.m_key, item.m_type }];
+    item.m_previousInIndex = nullptr;
+    item.m_nextInIndex = head;
+    if (head)
+        head->m_previousInIndex = &item;
+    head = &item;
+}
+
+void MessageQueue::unlink(WorkItem& item)
+{
+    if (item.m_type == WorkItem::UnindexedType)
+        return;
+
+    if (item.m_nextInIndex)
+        item.m_nextInIndex->m_previousInIndex = item.m_previousInIndex;
+
+    if (item.m_previousInIndex)
+        item.m_previousInIndex->m_nextInIndex = item.m_nextInIndex;
+    else
+        m_index[{ &item.owner(), item.m_key, item.m_type }] = item.m_nextInIndex;
+
+    item.m_previousInIndex = nullptr;
+    item.m_nextInIndex = nullptr;
+}
+
+size_t MessageQueue::tokenHome(uint64_t sequence) const
+{
+    return static_cast<size_t>((sequence * 0x9e3779b97f4a7c15ull) >> 32) & (m_tokens.size() - 1);
+}
+
+void MessageQueue::addToken(WorkItem& item)
+{
+    // Keep the load factor at or below one half.
+    if ((m_tokenCount + 1) * 2 > m_tokens.size()) {
+        std::vector<WorkItem*> tokens(std::max<size_t>(m_tokens.size() * 2, 64), nullptr);
+        tokens.swap(m_tokens);
+        m_tokenCount = 0;
+        for (WorkItem* token : tokens) {
+            if (token)
+                addToken(*token);
+        }
+    }
+
+    size_t mask = m_tokens.size() - 1;
+    size_t index = tokenHome(item.m_sequence);
+    while (m_tokens[index])
+        index = (index + 1) & mask;
+
+    m_tokens[index] = &item;
+    ++m_tokenCount;
+}
+
+WorkItem* MessageQueue::findToken(uint64_t sequence) const
+{
+    if (!sequence || m_tokens.empty())
+        return nullptr;
+
+    size_t mask = m_tokens.size() - 1;
+    for (size_t index = tokenHome(sequence); m_tokens[index]; index = (index + 1) & mask) {
+        if (m_tokens[index]->m_sequence == sequence)
+            return m_tokens[index];
+    }
+    return nullptr;
+}
+
+void MessageQueue::removeToken(WorkItem& item)
+{
+    size_t mask = m_tokens.size() - 1;
+    size_t index = tokenHome(item.m_sequence);
+    while (m_tokens[index] != &item)
+        index = (index + 1) & mask;
+
+    m_tokens[index] = nullptr;
+    --m_tokenCount;
+
+    // Shift the following entries of the probe run back, so that lookups never stop at the hole.
+    size_t hole = index;
+    for (size_t next = (hole + 1) & mask; m_tokens[next]; next = (next + 1) & mask) {
+        size_t home = tokenHome(m_tokens[next]->m_sequence);
+        bool movable = (hole <= next) ? (home <= hole || home > next) : (home <= hole && home > next);
+        if (movable) {
+            m_tokens[hole] = m_tokens[next];
+            m_tokens[next] = nullptr;
+            hole = next;
+        }
+    }
+}
+
+} // namespace os
+} // namespace android
@@ -0,0 +1,268 @@
+/*
+ * Copyright (C) 2016 Naver Corp. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <android/os/Handler.h>
+#include <android/os/LooperStats.h>
+
+#include <array>
+#include <atomic>
+#include <functional>
+#include <thread>
+#include <unordered_map>
+
+namespace android {
+namespace os {
+
+class Looper;
+class LooperProvider;
+class TimingWheel;
+class WorkItem;
+
+// Low-level class holding the list of messages to be dispatched by a Looper.
+// All Handlers of a thread share the queue of its Looper, which keeps pending work
+// ordered by fire time in a binary heap and drives a single platform wakeup source.
+// Pending work is also indexed by Handler and what, and by the token of each post,
+// so that lookups and removals only touch the matching items.
+// Posts from other threads are pushed onto a lock-free inbox instead, which is
+// drained into the heap by whoever next takes the queue lock, usually the looper.
+// Asynchronous work is kept in a heap of its own, so that it can still be found
+// in O(1) while a sync barrier holds back all synchronous work.
+// Each Handler priority has a lane with its own pair of heaps. Due work is taken from
+// the highest priority lane which has credits left in the current round of dispatches.
+// Optionally, work which is not due soon waits in a timing wheel instead of the heaps,
+// which makes arming and cancelling large numbers of timeouts O(1).
+class ANDROID_EXPORT MessageQueue final : public Object {
+    friend class Handler;
+    friend class Looper;
+    friend class LooperProvider;
+public:
+    // Callback interface for discovering when a thread is going to block waiting for more messages.
+    class IdleHandler {
+    public:
+        virtual ~IdleHandler() = default;
+
+        // Called when the message queue has run out of messages which are due. idleTime is the time
+        // until the next pending message is due, or nanoseconds::max() if there is none, so that the
+        // work can be time-boxed. Return true to keep the idle handler active, false to have it removed.
+        virtual bool queueIdle(std::chrono::nanoseconds idleTime) = 0;
+    };
+
+    // A listener which is invoked when file descriptor related events occur.
+    class OnFileDescriptorEventListener {
+    public:
+        // The file descriptor is ready for input operations, such as reading.
+        static const int32_t EVENT_INPUT = 1 << 0;
+        // The file descriptor is ready for output operations, such as writing.
+        static const int32_t EVENT_OUTPUT = 1 << 1;
+        // The file descriptor encountered a fatal error or was hung up. Always reported.
+        static const int32_t EVENT_ERROR = 1 << 2;
+
+        virtual ~OnFileDescriptorEventListener() = default;
+
+        // Called when a file descriptor receives events. Return the new set of events to watch, or 0 to unregister the listener.
+        virtual int32_t onFileDescriptorEvents(int32_t fd, int32_t events) = 0;
+    };
+
+    // Level triggered listeners are called as long as the file descriptor stays ready, edge triggered
+    // ones only when it becomes ready again, and so have to drain it on every call, like with EPOLLET.
+    enum class TriggerMode {
+        Level,
+        Edge,
+    };
+
+    ~MessageQueue();
+
+    // Returns true if the looper has no pending messages which are due to be processed.
+    bool isIdle();
+
+    // Add a new IdleHandler to this message queue.
+    void addIdleHandler(std::shared_ptr<IdleHandler> handler);
+    // Remove an IdleHandler from the queue that was previously added with addIdleHandler().
+    void removeIdleHandler(const std::shared_ptr<IdleHandler>& handler);
+
+    // Posts a synchronization barrier to the Looper's message queue. Until it is removed,
+    // only asynchronous messages and runnables are dispatched. Returns a token which
+    // uniquely identifies the barrier.
+    int32_t postSyncBarrier();
+    // Removes a synchronization barrier.
+    void removeSyncBarrier(int32_t token);
+
+    // Adds a file descriptor listener to receive notification when file descriptor related events occur.
+    // With a handler, which must belong to the Looper of this queue, the listener is posted to it instead
+    // of being called right away, so that it runs in the priority lane of that Handler.
+    // Returns false where the platform cannot watch file descriptors.
+    bool addOnFileDescriptorEventListener(int32_t fd, int32_t events, std::shared_ptr<OnFileDescriptorEventListener> listener,
+        TriggerMode mode = TriggerMode::Level, std::shared_ptr<Handler> handler = nullptr);
+    // Removes a file descriptor listener.
+    void removeOnFileDescriptorEventListener(int32_t fd);
+
+private:
+    MessageQueue();
+
+    // A binary min-heap of work items, which keep track of their own position so that
+    // any of them can be removed in O(log n).
+    class WorkItemHeap {
+    public:
+        bool isEmpty() const { return m_items.empty(); }
+        WorkItem* top() const { return m_items.empty() ? nullptr : m_items.front().get(); }
+        const std::vector<std::unique_ptr<WorkItem>>& items() const { return m_items; }
+        size_t size() const { return m_items.size(); }
+        WorkItem* at(size_t index) const { return m_items[index].get(); }
+
+        void push(std::unique_ptr<WorkItem>&&);
+        std::unique_ptr<WorkItem> remove(WorkItem&);
+
+    private:
+        void siftUp(size_t index);
+        void siftDown(size_t index);
+        void setHeapIndex(size_t index);
+
+        std::vector<std::unique_ptr<WorkItem>> m_items;
+    };
+
+    struct Lane {
+        WorkItemHeap syncQueue;
+        WorkItemHeap asyncQueue;
+        // Dispatches left to the lane in the current round.
+        uint32_t credits;
+    };
+
+    struct FileDescriptorRecord {
+        int32_t events;
+        TriggerMode mode;
+        std::function<int32_t (int32_t fd, int32_t events)> callback;
+        std::shared_ptr<Handler> handler;
+        // Tells a re-added file descriptor apart from the registration a pending callback was posted for.
+        uint64_t generation;
+    };
+
+    struct SyncBarrier {
+        int32_t token;
+        std::chrono::nanoseconds when;
+        uint64_t sequence;
+    };
+
+    struct IndexKey {
+        Handler* owner;
+        intptr_t key;
+        uint8_t type;
+
+        bool operator==(const IndexKey& other) const
+        {
+            return owner == other.owner && key == other.key && type == other.type;
+        }
+    };
+    struct IndexKeyHash {
+        size_t operator()(const IndexKey&) const;
+    };
+
+    Handler::Token enqueueWorkItem(std::unique_ptr<WorkItem>&&);
+    bool hasWorkItems(Handler&, uint8_t type, intptr_t key);
+    void removeWorkItems(Handler&, uint8_t type, intptr_t key);
+    bool removeWorkItem(Handler&, const Handler::Token&);
+    void removeWorkItems(Handler&);
+    void setTimerSlack(Handler&, std::chrono::nanoseconds);
+    void setPriority(Handler&, Handler::Priority);
+
+    // Looper
+    void setMessageLogging(std::function<void (const LooperStats::Dispatch&)>);
+    void setSlowDispatchThreshold(std::chrono::nanoseconds);
+    void setStatisticsEnabled(bool);
+    LooperStats getStatistics();
+    void resetStatistics();
+    void setTimingWheelEnabled(bool);
+    void performWorkItemsUntil(std::chrono::nanoseconds time);
+    bool addFileDescriptor(int32_t fd, int32_t events, TriggerMode, std::function<int32_t (int32_t, int32_t)>, std::shared_ptr<Handler>);
+
+    // LooperProvider
+    void performWorkItems();
+    void performFileDescriptorEvents(int32_t fd, int32_t events);
+    void fileDescriptorEventsPerformed(int32_t fd, uint64_t generation, int32_t events);
+
+    void performInstrumentedWorkItem(WorkItem&);
+    void updateInstrumented();
+
+    void performIdleHandlers();
+
+    void drainInbox();
+    void insertWorkItem(std::unique_ptr<WorkItem>&&);
+    void placeWorkItem(std::unique_ptr<WorkItem>&&);
+    void advanceTimingWheel(std::chrono::nanoseconds currentTime);
+    std::unique_ptr<WorkItem> takeWorkItem(std::chrono::nanoseconds currentTime);
+    std::unique_ptr<WorkItem> detachWorkItem(WorkItem&);
+    bool scheduleWorkItems();
+
+    WorkItemHeap& queueOf(const WorkItem&);
+    WorkItem* nextWorkItem(const Lane&) const;
+    WorkItem* nextDueWorkItem(std::chrono::nanoseconds currentTime);
+    std::chrono::nanoseconds nextFireTime() const;
+    std::chrono::nanoseconds coalescedFireTime() const;
+    std::chrono::nanoseconds coalescedFireTime(const WorkItemHeap&, size_t index, std::chrono::nanoseconds deadline) const;
+    bool hasPendingWorkItems() const;
+    bool isBlockedBySyncBarrier(const WorkItem&) const;
+
+    void link(WorkItem&);
+    void unlink(WorkItem&);
+
+    size_t tokenHome(uint64_t sequence) const;
+    void addToken(WorkItem&);
+    WorkItem* findToken(uint64_t sequence) const;
+    void removeToken(WorkItem&);
+
+    std::unique_ptr<LooperProvider> m_provider;
+    std::thread::id m_thread;
+    std::atomic<WorkItem*> m_inbox;
+    std::array<Lane, Handler::priorityCount> m_lanes;
+    std::unique_ptr<TimingWheel> m_timingWheel;
+    std::vector<std::unique_ptr<WorkItem>> m_expiredWorkItems;
+    std::vector<SyncBarrier> m_syncBarriers;
+    int32_t m_nextBarrierToken;
+    std::vector<std::shared_ptr<IdleHandler>> m_idleHandlers;
+    std::unordered_map<int32_t, FileDescriptorRecord> m_fileDescriptors;
+    uint64_t m_nextFileDescriptorGeneration;
+    std::unordered_map<IndexKey, WorkItem*, IndexKeyHash> m_index;
+    // Pending items by sequence number, in an open addressing table with linear probing.
+    std::vector<WorkItem*> m_tokens;
+    size_t m_tokenCount;
+    // The wakeup the provider is armed for, and the fire time of the head of the queue when it was armed.
+    std::chrono::nanoseconds m_nextFireTime;
+    std::chrono::nanoseconds m_armedHeadTime;
+    // The coalesced wakeup time, pulled earlier by the work placed since it was computed.
+    std::chrono::nanoseconds m_coalescedFireTime;
+    std::atomic<uint64_t> m_nextSequence;
+    // Instrumentation is opt-in, so that dispatching only pays for checking this flag.
+    std::atomic<bool> m_instrumented;
+    std::function<void (const LooperStats::Dispatch&)> m_messageLogging;
+    std::chrono::nanoseconds m_slowDispatchThreshold;
+    bool m_statisticsEnabled;
+    LooperStats m_statistics;
+};
+
+} // namespace os
+} // namespace android
+
+using MessageQueue = android::os::MessageQueue;
@@ -44,6 +44,7 @@ public:
 
     // Send a Message to this Messenger's Handler.
     ANDROID_EXPORT void send(Message&);
+    void send(Message&& message) { send(message); }
 
     // Retrieve the IBinder that this Messenger is using to communicate with its associated Handler.
     ANDROID_EXPORT IBinder getBinder();
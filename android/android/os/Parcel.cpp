@@ -0,0 +1,394 @@
+/*
+ * Copyright (C) 2016 Naver Corp. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "Parcel.h"
+
+#include <platforms/LogHelper.h>
+#include <assert>
+#include <stdlib.h>
+#include <string.h>
+
+namespace android {
+namespace os {
+
+// Buffers of the parcel start out at this size and double from there.
+static const size_t minimumCapacity = 256;
+
+Parcel::Parcel()
+    : m_data(nullptr)
+    , m_size(0)
+    , m_capacity(0)
+    , m_position(0)
+    , m_owned(false)
+    , m_readOnly(false)
+{
+}
+
+Parcel::Parcel(Parcel&& o)
+    : m_data(o.m_data)
+    , m_size(o.m_size)
+    , m_capacity(o.m_capacity)
+    , m_position(o.m_position)
+    , m_owned(o.m_owned)
+    , m_readOnly(o.m_readOnly)
+    , m_fileDescriptors(std::move(o.m_fileDescriptors))
+{
+    o.m_data = nullptr;
+    o.m_owned = false;
+    o.freeData();
+}
+
+Parcel::~Parcel()
+{
+    if (m_owned)
+        free(m_data);
+}
+
+Parcel& Parcel::operator=(Parcel&& o)
+{
+    if (this == &o)
+        return *this;
+
+    freeData();
+    std::swap(m_data, o.m_data);
+    std::swap(m_size, o.m_size);
+    std::swap(m_capacity, o.m_capacity);
+    std::swap(m_position, o.m_position);
+    std::swap(m_owned, o.m_owned);
+    std::swap(m_readOnly, o.m_readOnly);
+    std::swap(m_fileDescriptors, o.m_fileDescriptors);
+    return *this;
+}
+
+void Parcel::setDataSize(size_t size)
+{
+    if (size > m_capacity && !reserve(size))
+        return;
+
+    m_size = size;
+    m_position = std::min(m_position, m_size);
+}
+
+void Parcel::setDataPosition(size_t position)
+{
+    m_position = std::min(position, m_size);
+}
+
+void Parcel::setDataCapacity(size_t capacity)
+{
+    if (capacity > m_capacity)
+        reserve(capacity);
+}
+
+void Parcel::setData(const void* data, size_t size)
+{
+    freeData();
+    if (!size || !reserve(size))
+        return;
+
+    memcpy(m_data, data, size);
+    m_size = size;
+}
+
+void Parcel::setDataReference(const void* data, size_t size)
+{
+    freeData();
+    m_data = static_cast<uint8_t*>(const_cast<void*>(data));
+    m_size = size;
+    m_capacity = size;
+    m_readOnly = true;
+}
+
+void Parcel::setDataBuffer(void* buffer, size_t capacity)
+{
+    freeData();
+    m_data = static_cast<uint8_t*>(buffer);
+    m_capacity = capacity;
+}
+
+void Parcel::freeData()
+{
+    if (m_owned)
+        free(m_data);
+
+    m_data = nullptr;
+    m_size = 0;
+    m_capacity = 0;
+    m_position = 0;
+    m_owned = false;
+    m_readOnly = false;
+    m_fileDescriptors.clear();
+}
+
+// Makes room for capacity bytes in a writable buffer, moving the data out of the buffer of the caller if needed.
+bool Parcel::reserve(size_t capacity)
+{
+    if (capacity <= m_capacity && !m_readOnly)
+        return true;
+
+    size_t newCapacity = std::max(m_capacity, minimumCapacity);
+    while (newCapacity < capacity)
+        newCapacity *= 2;
+
+    uint8_t* data;
+    if (m_owned) {
+        data = static_cast<uint8_t*>(realloc(m_data, newCapacity));
+    } else {
+        data = static_cast<uint8_t*>(malloc(newCapacity));
+        if (data && m_size)
+            memcpy(data, m_data, m_size);
+    }
+    if (!data) {
+        LOGE("Failed to allocate %zu bytes for a parcel", newCapacity);
+        return false;
+    }
+
+    m_data = data;
+    m_capacity = newCapacity;
+    m_owned = true;
+    m_readOnly = false;
+    return true;
+}
+
+void Parcel::write(const void* data, size_t size)
+{
+    if (void* out = writeInplace(size))
+        memcpy(out, data, size);
+}
+
+void* Parcel::writeInplace(size_t size)
+{
+    size_t paddedSize = padded(size);
+    if (!reserve(m_position + paddedSize))
+        return nullptr;
+
+    uint8_t* out = m_data + m_position;
+    // Zero the padding, so that no uninitialized memory is sent along.
+    if (paddedSize > size)
+        memset(out + size, 0, paddedSize - size);
+
+    m_position += paddedSize;
+    m_size = std::max(m_size, m_position);
+    return out;
+}
+
+void Parcel::writeInt32(int32_t value)
+{
+    write(&value, sizeof(value));
+}
+
+void Parcel::writeInt64(int64_t value)
+{
+    write(&value, sizeof(value));
+}
+
+void Parcel::writeFloat(float value)
+{
+    write(&value, sizeof(value));
+}
+
+void Parcel::writeDouble(double value)
+{
+    write(&value, sizeof(value));
+}
+
+void Parcel::writeString16(const String& value)
+{
+    writeString16(value.data(), value.size());
+}
+
+void Parcel::writeString16(const wchar_t* value, size_t length)
+{
+    if (sizeof(wchar_t) == sizeof(char16_t)) {
+        writeString16(reinterpret_cast<const char16_t*>(value), length);
+        return;
+    }
+
+    // Encode the UTF-32 of wide strings into UTF-16 in place, with surrogate pairs outside of the BMP.
+    size_t utf16Length = length;
+    for (size_t i = 0; i < length; ++i)
+        utf16Length += (static_cast<uint32_t>(value[i]) >= 0x10000) ? 1 : 0;
+
+    writeInt32(static_cast<int32_t>(utf16Length));
+    char16_t* out = static_cast<char16_t*>(writeInplace((utf16Length + 1) * sizeof(char16_t)));
+    if (!out)
+        return;
+
+    for (size_t i = 0; i < length; ++i) {
+        uint32_t codePoint = static_cast<uint32_t>(value[i]);
+        if (codePoint < 0x10000) {
+            *out++ = static_cast<char16_t>(codePoint);
+        } else {
+            codePoint -= 0x10000;
+            *out++ = static_cast<char16_t>(0xD800 + (codePoint >> 10));
+            *out++ = static_cast<char16_t>(0xDC00 + (codePoint & 0x3FF));
+        }
+    }
+    *out = 0;
+}
+
+void Parcel::writeString16(const char16_t* value, size_t length)
+{
+    writeInt32(static_cast<int32_t>(length));
+    // Strings keep their terminator, so that they can be read in place as C strings.
+    char16_t* out = static_cast<char16_t*>(writeInplace((length + 1) * sizeof(char16_t)));
+    if (!out)
+        return;
+
+    memcpy(out, value, length * sizeof(char16_t));
+    out[length] = 0;
+}
+
+void Parcel::writeBlob(const void* data, size_t size)
+{
+    writeInt32(static_cast<int32_t>(size));
+    write(data, size);
+}
+
+void Parcel::writeFileDescriptor(int32_t fd)
+{
+    writeInt32(static_cast<int32_t>(m_fileDescriptors.size()));
+    m_fileDescriptors.push_back(fd);
+}
+
+bool Parcel::read(void* out, size_t size)
+{
+    const void* data = readInplace(size);
+    if (!data)
+        return false;
+
+    memcpy(out, data, size);
+    return true;
+}
+
+const void* Parcel::readInplace(size_t size)
+{
+    size_t paddedSize = padded(size);
+    if (paddedSize < size || paddedSize > dataAvail())
+        return nullptr;
+
+    const uint8_t* data = m_data + m_position;
+    m_position += paddedSize;
+    return data;
+}
+
+int32_t Parcel::readInt32()
+{
+    int32_t value = 0;
+    read(&value, sizeof(value));
+    return value;
+}
+
+int64_t Parcel::readInt64()
+{
+    int64_t value = 0;
+    read(&value, sizeof(value));
+    return value;
+}
+
+float Parcel::readFloat()
+{
+    float value = 0;
+    read(&value, sizeof(value));
+    return value;
+}
+
+double Parcel::readDouble()
+{
+    double value = 0;
+    read(&value, sizeof(value));
+    return value;
+}
+
+String Parcel::readString16()
+{
+    size_t length;
+    const char16_t* utf16 = readString16Inplace(&length);
+    if (!utf16)
+        return String();
+
+    if (sizeof(wchar_t) == sizeof(char16_t))
+        return String(reinterpret_cast<const wchar_t*>(utf16), length);
+
+    String value;
+    value.reserve(length);
+    for (size_t i = 0; i < length; ++i) {
+        uint32_t codePoint = utf16[i];
+        if (codePoint >= 0xD800 && codePoint < 0xDC00 && i + 1 < length && utf16[i + 1] >= 0xDC00 && utf16[i + 1] < 0xE000)
+            codePoint = 0x10000 + ((codePoint - 0xD800) << 10) + (utf16[++i] - 0xDC00);
+        value.push_back(static_cast<wchar_t>(codePoint));
+    }
+    return value;
+}
+
+const char16_t* Parcel::readString16Inplace(size_t* outLength)
+{
+    size_t position = m_position;
+    int32_t length;
+    if (read(&length, sizeof(length)) && length >= 0 && static_cast<size_t>(length) < dataAvail() / sizeof(char16_t)) {
+        const char16_t* value = static_cast<const char16_t*>(readInplace((length + 1) * sizeof(char16_t)));
+        if (value && !value[length]) {
+            *outLength = length;
+            return value;
+        }
+    }
+
+    m_position = position;
+    *outLength = 0;
+    return nullptr;
+}
+
+const void* Parcel::readBlob(size_t* outSize)
+{
+    size_t position = m_position;
+    int32_t size;
+    if (read(&size, sizeof(size)) && size >= 0) {
+        if (const void* data = readInplace(size)) {
+            *outSize = size;
+            return data;
+        }
+    }
+
+    m_position = position;
+    *outSize = 0;
+    return nullptr;
+}
+
+int32_t Parcel::readFileDescriptor()
+{
+    int32_t index = readInt32();
+    if (index < 0 || static_cast<size_t>(index) >= m_fileDescriptors.size())
+        return -1;
+
+    return m_fileDescriptors[index];
+}
+
+void Parcel::setFileDescriptors(std::vector<int32_t> fds)
+{
+    m_fileDescriptors = std::move(fds);
+}
+
+} // namespace os
+} // namespace android
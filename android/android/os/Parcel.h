@@ -32,7 +32,98 @@
 namespace android {
 namespace os {
 
-using Parcel = std::vector<char>;
+// Container for a message of flattened data and file descriptors, which can be sent between processes.
+// Values are written at 4 byte alignment, into a buffer of the parcel which doubles as it fills up, or
+// into a buffer supplied by the caller. Reads in place return pointers into the data instead of copying.
+class ANDROID_EXPORT Parcel final {
+public:
+    Parcel();
+    Parcel(Parcel&&);
+    ~Parcel();
+
+    Parcel& operator=(Parcel&&);
+
+    // Returns the raw bytes of the parcel.
+    const uint8_t* data() const { return m_data; }
+    // Returns the total amount of data contained in the parcel.
+    size_t dataSize() const { return m_size; }
+    // Returns the amount of data remaining to be read from the parcel.
+    size_t dataAvail() const { return m_size - m_position; }
+    // Returns the current position in the parcel data.
+    size_t dataPosition() const { return m_position; }
+    // Returns the total amount of space in the parcel.
+    size_t dataCapacity() const { return m_capacity; }
+
+    // Change the amount of data in the parcel.
+    void setDataSize(size_t size);
+    // Move the current read/write position in the parcel.
+    void setDataPosition(size_t position);
+    // Change the capacity (current available space) of the parcel.
+    void setDataCapacity(size_t capacity);
+
+    // Set the bytes in data to be the raw bytes of this Parcel.
+    void setData(const void* data, size_t size);
+    // Read size bytes of data in place, without copying them. data has to stay valid while the parcel reads it,
+    // and is copied before the first write.
+    void setDataReference(const void* data, size_t size);
+    // Write into the capacity bytes of buffer, and move into a buffer of the parcel once they are full.
+    void setDataBuffer(void* buffer, size_t capacity);
+    // Empties the parcel and releases its buffer.
+    void freeData();
+
+    void write(const void* data, size_t size);
+    // Returns size bytes at the current position, to be written in place.
+    void* writeInplace(size_t size);
+    void writeInt32(int32_t value);
+    void writeInt64(int64_t value);
+    void writeFloat(float value);
+    void writeDouble(double value);
+    void writeString16(const String& value);
+    void writeString16(const wchar_t* value, size_t length);
+    void writeString16(const char16_t* value, size_t length);
+    // Write a block of bytes prefixed with its size.
+    void writeBlob(const void* data, size_t size);
+    // Write a file descriptor, which is sent along with the data. The parcel does not take ownership of fd.
+    void writeFileDescriptor(int32_t fd);
+
+    // Returns false if there are less than size bytes left.
+    bool read(void* out, size_t size);
+    // Returns the next size bytes in place, or nullptr if there are less left.
+    const void* readInplace(size_t size);
+    int32_t readInt32();
+    int64_t readInt64();
+    float readFloat();
+    double readDouble();
+    String readString16();
+    // Returns the next string in place, or nullptr, and its length without the terminator in outLength.
+    const char16_t* readString16Inplace(size_t* outLength);
+    // Returns the next block of bytes in place, or nullptr, and its size in outSize.
+    const void* readBlob(size_t* outSize);
+    // Returns the next file descriptor, which still belongs to the parcel, or -1.
+    int32_t readFileDescriptor();
+
+    // The file descriptors the data refers to, which transports send along with it.
+    const std::vector<int32_t>& fileDescriptors() const { return m_fileDescriptors; }
+    void setFileDescriptors(std::vector<int32_t> fds);
+
+private:
+    Parcel(const Parcel&) = delete;
+    Parcel& operator=(const Parcel&) = delete;
+
+    static size_t padded(size_t size) { return (size + 3) & ~static_cast<size_t>(3); }
+
+    bool reserve(size_t capacity);
+
+    uint8_t* m_data;
+    size_t m_size;
+    size_t m_capacity;
+    size_t m_position;
+    // Whether m_data was allocated by the parcel, or belongs to the caller.
+    bool m_owned;
+    // Whether m_data was set with setDataReference(), and has to be copied before writing.
+    bool m_readOnly;
+    std::vector<int32_t> m_fileDescriptors;
+};
 
 } // namespace os
 } // namespace android
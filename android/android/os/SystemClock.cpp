@@ -0,0 +1,79 @@
+/*
+ * Copyright (C) 2016 Naver Corp. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "SystemClock.h"
+
+#include <atomic>
+
+namespace android {
+namespace os {
+
+static std::atomic<bool> virtualTimeEnabled(false);
+static std::atomic<int64_t> virtualTime(0);
+// The virtual elapsed realtime keeps the distance to the virtual uptime it had when virtual time was enabled.
+static std::atomic<int64_t> virtualSleepTime(0);
+
+std::chrono::nanoseconds SystemClock::uptimeNanos()
+{
+    if (UNLIKELY(virtualTimeEnabled.load(std::memory_order_relaxed)))
+        return std::chrono::nanoseconds(virtualTime.load(std::memory_order_relaxed));
+    return platformUptimeNanos();
+}
+
+std::chrono::nanoseconds SystemClock::elapsedRealtimeNanos()
+{
+    if (UNLIKELY(virtualTimeEnabled.load(std::memory_order_relaxed)))
+        return std::chrono::nanoseconds(virtualTime.load(std::memory_order_relaxed) + virtualSleepTime.load(std::memory_order_relaxed));
+    return platformElapsedRealtimeNanos();
+}
+
+// Replace the uptime and elapsed realtime clocks with a virtual clock, for deterministic tests.
+void SystemClock::setVirtualTimeEnabled(bool enabled)
+{
+    if (enabled == virtualTimeEnabled.load())
+        return;
+
+    if (enabled) {
+        std::chrono::nanoseconds uptime = platformUptimeNanos();
+        virtualTime.store(uptime.count());
+        virtualSleepTime.store((platformElapsedRealtimeNanos() - uptime).count());
+    }
+    virtualTimeEnabled.store(enabled);
+}
+
+bool SystemClock::isVirtualTimeEnabled()
+{
+    return virtualTimeEnabled.load();
+}
+
+// Moves the virtual clock forward by duration.
+void SystemClock::advanceVirtualTime(std::chrono::nanoseconds duration)
+{
+    if (duration > std::chrono::nanoseconds::zero())
+        virtualTime.fetch_add(duration.count());
+}
+
+} // namespace os
+} // namespace android
@@ -0,0 +1,78 @@
+/*
+ * Copyright (C) 2016 Naver Corp. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <java/lang.h>
+
+namespace android {
+namespace os {
+
+// Core timekeeping facilities. Unlike System::currentTimeMillis(), these clocks are
+// monotonic and are not affected by changes of the wall clock.
+class SystemClock {
+public:
+    // Returns milliseconds since boot, not counting time spent in deep sleep.
+    static std::chrono::milliseconds uptimeMillis()
+    {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(uptimeNanos());
+    }
+    // Returns nanoseconds since boot, not counting time spent in deep sleep.
+    ANDROID_EXPORT static std::chrono::nanoseconds uptimeNanos();
+
+    // Returns milliseconds since boot, including time spent in sleep.
+    static std::chrono::milliseconds elapsedRealtime()
+    {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(elapsedRealtimeNanos());
+    }
+    // Returns nanoseconds since boot, including time spent in sleep.
+    ANDROID_EXPORT static std::chrono::nanoseconds elapsedRealtimeNanos();
+
+    // Returns milliseconds running in the current thread.
+    static std::chrono::milliseconds currentThreadTimeMillis()
+    {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(currentThreadTimeNanos());
+    }
+    // Returns nanoseconds of CPU time consumed by the current thread.
+    ANDROID_EXPORT static std::chrono::nanoseconds currentThreadTimeNanos();
+
+    // Replace the uptime and elapsed realtime clocks with a virtual clock, for deterministic tests.
+    // It starts at the current uptime and only moves when advanced, usually by Looper::idleFor().
+    ANDROID_EXPORT static void setVirtualTimeEnabled(bool enabled);
+    ANDROID_EXPORT static bool isVirtualTimeEnabled();
+    // Moves the virtual clock forward by duration.
+    ANDROID_EXPORT static void advanceVirtualTime(std::chrono::nanoseconds duration);
+
+private:
+    SystemClock() = default;
+
+    static std::chrono::nanoseconds platformUptimeNanos();
+    static std::chrono::nanoseconds platformElapsedRealtimeNanos();
+};
+
+} // namespace os
+} // namespace android
+
+using SystemClock = android::os::SystemClock;
@@ -89,6 +89,30 @@ void MessageChannel::send(Message& message, int32_t waitFor)
     }
 }
 
+void MessageChannel::sendRequest(Message& message, std::function<void (const Message&)> onReply)
+{
+    // Register before sending, since the reply may arrive before send() returns.
+    int32_t requestId = m_pendingReplies.add(std::move(onReply));
+
+    // A request which cannot be sent would never be replied to. One sent before disconnect() is failed there.
+    if (!m_messageSender) {
+        m_pendingReplies.fail(requestId);
+        return;
+    }
+
+    message.setRequestId(requestId);
+    send(message);
+}
+
+Future<Message> MessageChannel::sendRequest(Message& message)
+{
+    Promise<Message> promise;
+    sendRequest(message, [promise] (const Message& reply) mutable {
+        promise.setValue(Message(reply));
+    });
+    return promise.getFuture();
+}
+
 void MessageChannel::post(std::function<void ()>&& runnable, int32_t waitFor)
 {
     assert(!m_threadLock);
@@ -140,8 +164,10 @@ void MessageChannel::connect(int32_t what)
 void MessageChannel::disconnect()
 {
     std::shared_ptr<Messenger> messageSender = m_messageSender;
-    if (!messageSender)
+    if (!messageSender) {
+        m_pendingReplies.failAll();
         return;
+    }
 
     m_messageSender.reset();
 
@@ -150,20 +176,32 @@ void MessageChannel::disconnect()
     post([=] {
         messageSender->send(MessageHostMessages::get().Disconnect(channelIdentifier));
     }, MessageChannelMessages::get().DISCONNECTED);
+
+    m_pendingReplies.failAll();
 }
 
 void MessageChannel::receiveMessage(MessageChannel& channel, Message& message)
 {
+    // Replies to requests go to whoever sent the request, everything else to receive().
+    MessageChannelReplies::Callback onReply;
+    if (message.getRequestId())
+        onReply = channel.m_pendingReplies.take(message.getRequestId());
+
     synchronized (channel) {
-        channel.receive(message);
-        if (channel.m_threadLock) {
-            if (channel.m_threadUnlocker &&
-                channel.m_threadUnlocker != message.what)
-                return;
+        if (!onReply)
+            channel.receive(message);
+
+        if (channel.m_threadLock && (!channel.m_threadUnlocker || channel.m_threadUnlocker == message.what)) {
             channel.m_threadLock = false;
             channel.notifyAll();
         }
     }
+
+    // Replies are delivered outside of the lock, since they may send again right away.
+    if (onReply)
+        onReply(message);
+    else if (message.what == MessageChannelMessages::get().DISCONNECTED)
+        channel.m_pendingReplies.failAll();
 }
 
 } // namespace appkit
@@ -25,13 +25,19 @@
 
 #pragma once
 
+#include <android/os/Coroutine.h>
+#include <android/os/Future.h>
+#include <android/os/appkit/MessageChannelReplies.h>
 #include <android/os/appkit/Messages.h>
 
 namespace android {
 namespace os {
 namespace appkit {
 
+class MessageChannelRequest;
+
 class MessageChannel : private Object {
+    friend class MessageChannelRequest;
 public:
     ANDROID_EXPORT virtual ~MessageChannel();
 
@@ -40,6 +46,16 @@ protected:
 
     ANDROID_EXPORT void send(Message&);
     ANDROID_EXPORT void send(Message&, int32_t waitFor);
+    // Sends the message as a request without blocking, and calls onReply with the reply the host sent with
+    // MessageHost::reply(), on the thread receiving the messages of the channel. Requests are told apart by
+    // their request id, so any number of them may be in flight at once, from any thread. If the request
+    // cannot be sent, or the channel disconnects before the reply arrives, onReply is called with an empty Message.
+    ANDROID_EXPORT void sendRequest(Message&, std::function<void (const Message&)> onReply);
+    // Like sendRequest(Message&, onReply), but returns a Future of the reply.
+    ANDROID_EXPORT Future<Message> sendRequest(Message&);
+    // Returns an awaitable which sends the message as a request, and resumes the awaiting coroutine with
+    // the reply on the Looper of the awaiting thread. Defined for clients built with C++20 coroutines.
+    MessageChannelRequest request(Message&);
     ANDROID_EXPORT void post(std::function<void ()>&&, int32_t waitFor);
     ANDROID_EXPORT virtual void receive(const Message&);
     ANDROID_EXPORT void wait();
@@ -58,8 +74,45 @@ private:
 
     bool m_threadLock;
     int32_t m_threadUnlocker;
+    MessageChannelReplies m_pendingReplies;
+};
+
+#if COMPILER_SUPPORTS(CXX_COROUTINES)
+
+class MessageChannelRequest {
+public:
+    MessageChannelRequest(MessageChannel& channel, Message& message)
+        : m_channel(channel)
+        , m_message(message)
+    {
+    }
+
+    bool await_ready() const { return false; }
+    void await_suspend(std::coroutine_handle<> coroutine)
+    {
+        // Threads without a Looper are resumed on the thread receiving the reply.
+        std::shared_ptr<Handler> handler = CoroutineFrame::currentHandler();
+        m_channel.sendRequest(m_message, [this, coroutine, handler] (const Message& reply) {
+            m_reply = Message(reply);
+            if (!handler || !handler->post([coroutine] { coroutine.resume(); }))
+                coroutine.resume();
+        });
+    }
+    Message await_resume() { return std::move(m_reply); }
+
+private:
+    MessageChannel& m_channel;
+    Message& m_message;
+    Message m_reply;
 };
 
+inline MessageChannelRequest MessageChannel::request(Message& message)
+{
+    return MessageChannelRequest(*this, message);
+}
+
+#endif
+
 } // namespace appkit
 } // namespace os
 } // namespace android
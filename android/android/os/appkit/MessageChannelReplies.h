@@ -0,0 +1,115 @@
+/*
+ * Copyright (C) 2016 Naver Corp. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <android/os/Message.h>
+
+#include <atomic>
+#include <functional>
+#include <unordered_map>
+
+namespace android {
+namespace os {
+namespace appkit {
+
+// The requests of a MessageChannel waiting for their reply, by request id. Requests are told apart
+// by their id only, so any number of them may be in flight, and their replies may come in any order.
+class MessageChannelReplies final : private Object {
+public:
+    typedef std::function<void (const Message&)> Callback;
+
+    MessageChannelReplies();
+
+    // Registers onReply, and returns the request id to send the request with, which is never 0.
+    int32_t add(Callback onReply);
+    // Returns the callback waiting for the reply with requestId and forgets it, or an empty one if there is none.
+    Callback take(int32_t requestId);
+    // Calls the callback of the request with an empty Message, if it still waits.
+    void fail(int32_t requestId);
+    // Calls the callbacks of all waiting requests with an empty Message.
+    void failAll();
+
+private:
+    std::atomic<int32_t> m_nextRequestId;
+    std::unordered_map<int32_t, Callback> m_callbacks;
+};
+
+inline MessageChannelReplies::MessageChannelReplies()
+    : m_nextRequestId(1)
+{
+}
+
+inline int32_t MessageChannelReplies::add(Callback onReply)
+{
+    int32_t requestId;
+    do {
+        requestId = m_nextRequestId.fetch_add(1, std::memory_order_relaxed);
+    } while (!requestId);
+
+    synchronized (this) {
+        m_callbacks[requestId] = std::move(onReply);
+    }
+    return requestId;
+}
+
+inline MessageChannelReplies::Callback MessageChannelReplies::take(int32_t requestId)
+{
+    Callback onReply;
+
+    synchronized (this) {
+        auto it = m_callbacks.find(requestId);
+        if (it == m_callbacks.end())
+            return nullptr;
+        onReply = std::move(it->second);
+        m_callbacks.erase(it);
+    }
+    return onReply;
+}
+
+inline void MessageChannelReplies::fail(int32_t requestId)
+{
+    // Callbacks are called outside of the lock, since they may send again right away.
+    if (Callback onReply = take(requestId))
+        onReply(Message());
+}
+
+inline void MessageChannelReplies::failAll()
+{
+    std::unordered_map<int32_t, Callback> callbacks;
+
+    synchronized (this) {
+        callbacks.swap(m_callbacks);
+    }
+
+    for (auto& callback : callbacks)
+        callback.second(Message());
+}
+
+} // namespace appkit
+} // namespace os
+} // namespace android
+
+using MessageChannelReplies = android::os::appkit::MessageChannelReplies;
@@ -111,6 +111,12 @@ void MessageHost::send(Message& message)
     });
 }
 
+void MessageHost::reply(const Message& request, Message& reply)
+{
+    reply.setRequestId(request.getRequestId());
+    send(reply);
+}
+
 void MessageHost::receive(Message& message)
 {
     if (message.what == MessageHostMessages::get().DISCONNECT) {
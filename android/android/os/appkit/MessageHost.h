@@ -42,6 +42,8 @@ protected:
     ANDROID_EXPORT void protect();
 
     ANDROID_EXPORT void send(Message&);
+    // Sends reply as the answer to a request sent with MessageChannel::sendRequest().
+    ANDROID_EXPORT void reply(const Message& request, Message& reply);
     ANDROID_EXPORT virtual void receive(Message&);
 
 private:
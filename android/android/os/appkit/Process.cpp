@@ -28,8 +28,10 @@
 #include "ProcessLauncher.h"
 #include "ProcessMessages.h"
 #include <android/os/Looper.h>
+#include <android/os/MessageRing.h>
 #include <android/os/Messenger.h>
 #include <java/lang/System.h>
+#include <platforms/LogHelper.h>
 
 #include <pthread.h>
 
@@ -86,6 +88,10 @@ Process::Process(int32_t connectionIdentifier, IBinder targetHandle)
 
 Process::~Process()
 {
+    if (m_inputRing)
+        m_inputRing->close();
+    if (m_outputRing)
+        m_outputRing->close();
     currentProcess = nullptr;
 }
 
@@ -94,7 +100,12 @@ int32_t Process::start()
     assert(currentProcess);
 
     std::unique_ptr<std::thread> thread = std::unique_ptr<std::thread>(new std::thread([=] {
+#if defined(WIN32)
         pthread_setname_np("Process Main Thread");
+#else
+        // Names of Linux threads are limited to 15 characters.
+        pthread_setname_np(pthread_self(), "Process Main");
+#endif
         platformStart();
         post([] { Looper::myLooper()->quitSafely(); });
     }));
@@ -108,15 +119,21 @@ class ProcessMessageHandler : public Handler {
 public:
     void handleMessage(Message&) override;
 
-    ProcessMessageHandler(Process& process) : m_process(process) { }
+    // Messages of the input ring are in order already, unlike those of the Messenger once the ring is read.
+    ProcessMessageHandler(Process& process, bool fromRing = false) : m_process(process), m_fromRing(fromRing) { }
 
 private:
     Process& m_process;
+    bool m_fromRing;
 };
 
 void Process::send(Message& message)
 {
-    m_messageSender->send(ProcessMessages::obtain(m_messageReceiver, message));
+    Message processMessage = ProcessMessages::obtain(m_messageReceiver, message);
+    if (m_outputRing)
+        m_outputRing->send(processMessage, m_messageSender);
+    else
+        m_messageSender->send(processMessage);
 }
 
 void Process::addMessageReceiver(std::function<bool (Messenger&, Message&)> receiver)
@@ -130,6 +147,18 @@ void Process::setMessageReceiver(std::function<bool (Messenger&, Message&)> rece
 }
 
 bool Process::receive(Message& message)
+{
+    // Once the launcher sends into the ring, the Messenger only carries what does not fit into it,
+    // which the ring delivers in its place.
+    if (m_inputRing && m_inputRing->isReceiving()) {
+        m_inputRing->receiveFallback(message);
+        return true;
+    }
+
+    return receiveMessage(message);
+}
+
+bool Process::receiveMessage(Message& message)
 {
     if (message.what == ProcessMessages::get().LOAD_LIBRARY) {
         CharSequence libraryName = message.getData().getCharSequence(ProcessMessages::libraryNameKey());
@@ -138,6 +167,18 @@ bool Process::receive(Message& message)
         return true;
     }
 
+    if (message.what == ProcessMessages::get().OPEN_MESSAGE_RINGS) {
+        openMessageRings(message);
+        return true;
+    }
+
+    if (message.what == ProcessMessages::get().MESSAGE_RINGS_OPENED) {
+        // Whatever the launcher sent through the Messenger before has arrived, so its ring can be read now.
+        if (m_inputRing && !m_inputRing->receive(std::make_shared<ProcessMessageHandler>(*this, true)))
+            LOGE("Error at Process::receive() - %s", "could not receive from the message ring");
+        return true;
+    }
+
     return m_messageFilter.receiveMessage(*m_messageSender, message);
 }
 
@@ -146,29 +187,29 @@ bool Process::receive(Messenger& replySender, Message& message)
     return m_messageFilter.receiveMessage(replySender, message);
 }
 
-bool Process::post(std::function<void ()> r)
+bool Process::post(Runnable r)
 {
     return m_mainThreadHandler->post(std::move(r));
 }
 
-bool Process::postAtFrontOfQueue(std::function<void ()> r)
+bool Process::postAtFrontOfQueue(Runnable r)
 {
     return m_mainThreadHandler->postAtFrontOfQueue(std::move(r));
 }
 
-bool Process::postAtTime(std::function<void ()> r, std::chrono::milliseconds uptimeMillis)
+bool Process::postAtTime(Runnable r, std::chrono::nanoseconds uptime)
 {
-    return m_mainThreadHandler->postAtTime(std::move(r), uptimeMillis);
+    return m_mainThreadHandler->postAtTime(std::move(r), uptime);
 }
 
-bool Process::postDelayed(std::function<void ()> r, std::chrono::milliseconds delayMillis)
+bool Process::postDelayed(Runnable r, std::chrono::nanoseconds delay)
 {
-    return m_mainThreadHandler->postDelayed(std::move(r), delayMillis);
+    return m_mainThreadHandler->postDelayed(std::move(r), delay);
 }
 
-void Process::removeCallbacks(std::function<void ()> r)
+void Process::removeCallbacks(const Runnable& r)
 {
-    m_mainThreadHandler->removeCallbacks(std::move(r));
+    m_mainThreadHandler->removeCallbacks(r);
 }
 
 int32_t Process::platformStart()
@@ -178,13 +219,39 @@ int32_t Process::platformStart()
 
 void Process::processLaunched()
 {
-    m_messageReceiver = std::make_shared<Messenger>(std::make_shared<ProcessMessageHandler>(*this));
+    m_messageHandler = std::make_shared<ProcessMessageHandler>(*this);
+    m_messageReceiver = std::make_shared<Messenger>(m_messageHandler);
     m_messageSender->send(ProcessMessages::get().ProcessLaunched(m_messageReceiver, m_connectionIdentifier));
 }
 
+void Process::openMessageRings(Message& message)
+{
+    if (m_outputRing || !m_messageHandler)
+        return;
+
+    std::shared_ptr<MessageRing> inputRing = MessageRing::open(message.getData(), ProcessMessages::inputRingKey());
+    std::shared_ptr<MessageRing> outputRing = MessageRing::open(message.getData(), ProcessMessages::outputRingKey());
+    if (!inputRing || !outputRing) {
+        // The launcher keeps sending through the Messenger.
+        LOGW("Could not open the message rings of connection %d", m_connectionIdentifier);
+        Message failed = ProcessMessages::get().MessageRingsOpened(false);
+        send(failed);
+        return;
+    }
+
+    // Confirmed through the Messenger, which goes ahead of everything sent into the ring from now on.
+    Message opened = ProcessMessages::get().MessageRingsOpened(true);
+    send(opened);
+    m_inputRing = inputRing;
+    m_outputRing = outputRing;
+}
+
 void ProcessMessageHandler::handleMessage(Message& message)
 {
-    m_process.receive(message);
+    if (m_fromRing)
+        m_process.receiveMessage(message);
+    else
+        m_process.receive(message);
 }
 
 } // namespace appkit
@@ -32,9 +32,13 @@
 
 namespace android {
 namespace os {
+
+class MessageRing;
+
 namespace appkit {
 
 class ANDROID_EXPORT Process {
+    friend class ProcessMessageHandler;
 public:
     static std::unique_ptr<Process> create(const String& modulePath, const String& moduleEntry, const String& arguments,
         const std::vector<int32_t>& fileDescriptors, int32_t connectionIdentifier, intptr_t targetHandle, const std::unordered_map<String, String>& platformMainParameters);
@@ -45,16 +49,17 @@ public:
     int32_t start();
 
     void send(Message&);
+    void send(Message&& message) { send(message); }
     void addMessageReceiver(std::function<bool (Messenger&, Message&)>);
     void setMessageReceiver(std::function<bool (Messenger&, Message&)>, Messages&);
     bool receive(Message&);
     bool receive(Messenger&, Message&);
 
-    bool post(std::function<void ()>);
-    bool postAtFrontOfQueue(std::function<void ()>);
-    bool postAtTime(std::function<void ()>, std::chrono::milliseconds uptimeMillis);
-    bool postDelayed(std::function<void ()>, std::chrono::milliseconds delayMillis);
-    void removeCallbacks(std::function<void ()>);
+    bool post(Runnable);
+    bool postAtFrontOfQueue(Runnable);
+    bool postAtTime(Runnable, std::chrono::nanoseconds uptime);
+    bool postDelayed(Runnable, std::chrono::nanoseconds delay);
+    void removeCallbacks(const Runnable&);
 
 protected:
     Process();
@@ -65,11 +70,16 @@ protected:
     virtual int32_t platformStart();
 
     void processLaunched();
+    void openMessageRings(Message&);
+    bool receiveMessage(Message&);
 
     int32_t m_connectionIdentifier;
     std::shared_ptr<Handler> m_mainThreadHandler;
     std::shared_ptr<Messenger> m_messageSender;
     std::shared_ptr<Messenger> m_messageReceiver;
+    std::shared_ptr<Handler> m_messageHandler;
+    std::shared_ptr<MessageRing> m_inputRing;
+    std::shared_ptr<MessageRing> m_outputRing;
     MessageFilter m_messageFilter;
 };
 
@@ -31,7 +31,9 @@
 #include "Process.h"
 #include "ProcessMessages.h"
 #include "Thread.h"
+#include <android/os/MessageRing.h>
 #include <java/lang/System.h>
+#include <platforms/LogHelper.h>
 
 #include <unordered_map>
 #include <unordered_set>
@@ -116,6 +118,10 @@ void ProcessLauncher::unbindProcess(int32_t connection)
     if (processConnection->m_messageSender)
         openProcesses.erase(processConnection->m_messageSender.get());
     processConnections.erase(connection);
+    if (processConnection->m_inputRing)
+        processConnection->m_inputRing->close();
+    if (processConnection->m_outputRing)
+        processConnection->m_outputRing->close();
     processConnection->unbind();
 }
 
@@ -139,6 +145,19 @@ void ProcessLauncher::handleMessage(Message& message)
     }
 
     int32_t connectionIdentifier = openProcesses[message.replyTo];
+    std::shared_ptr<ProcessLauncher::Connection> connection = ProcessLauncher::getConnection(connectionIdentifier);
+    // Once the process sends into the ring, its Messenger only carries what does not fit into it,
+    // which the ring delivers in its place.
+    if (connection && connection->m_inputRing && connection->m_inputRing->isReceiving()) {
+        connection->m_inputRing->receiveFallback(message);
+        return;
+    }
+
+    receiveMessage(connectionIdentifier, message);
+}
+
+void ProcessLauncher::receiveMessage(int32_t connectionIdentifier, Message& message)
+{
     std::shared_ptr<ProcessLauncher::Connection> connection = ProcessLauncher::getConnection(connectionIdentifier);
     if (!connection) {
         // ERROR: Message has no valid destination!
@@ -159,12 +178,16 @@ static int32_t uniqueConnectionIdentifier()
 
 ProcessLauncher::Connection::Connection()
     : m_connectionIdentifier(uniqueConnectionIdentifier())
+    , m_messageRingsOpened(false)
 {
 }
 
 void ProcessLauncher::Connection::send(Message& message)
 {
-    m_messageSender->send(message);
+    if (m_messageRingsOpened)
+        m_outputRing->send(message, m_messageSender);
+    else
+        m_messageSender->send(message);
 }
 
 void ProcessLauncher::Connection::addMessageReceiver(std::function<bool (Messenger&, Message&)> receiver)
@@ -179,9 +202,60 @@ void ProcessLauncher::Connection::setMessageReceiver(std::function<bool (Messeng
 
 bool ProcessLauncher::Connection::receive(Message& message)
 {
+    if (message.what == ProcessMessages::get().MESSAGE_RINGS_OPENED) {
+        messageRingsOpened(message.arg1);
+        return true;
+    }
+
     return m_messageFilter.receiveMessage(*m_messageSender, message);
 }
 
+bool ProcessLauncher::Connection::openMessageRings()
+{
+    assert(m_messageSender);
+    if (m_outputRing)
+        return true;
+
+    std::shared_ptr<MessageRing> inputRing = MessageRing::create();
+    std::shared_ptr<MessageRing> outputRing = MessageRing::create();
+    if (!inputRing || !outputRing)
+        return false;
+
+    // The process sends into the input ring of the connection, and receives from its output ring.
+    Message message = ProcessMessages::get().OpenMessageRings();
+    outputRing->writeToBundle(message.getData(), ProcessMessages::inputRingKey());
+    inputRing->writeToBundle(message.getData(), ProcessMessages::outputRingKey());
+    m_messageSender->send(message);
+
+    // Messages keep going through the Messenger until the process confirms it opened the rings.
+    m_inputRing = inputRing;
+    m_outputRing = outputRing;
+    return true;
+}
+
+void ProcessLauncher::Connection::messageRingsOpened(bool opened)
+{
+    if (!m_outputRing || m_messageRingsOpened)
+        return;
+
+    // Whatever the process sent through the Messenger before has arrived, so its ring can be read now.
+    int32_t connectionIdentifier = m_connectionIdentifier;
+    if (!opened || !m_inputRing->receive(std::make_shared<ProcessLauncherMessageHandler>([connectionIdentifier] (Message& message) { receiveMessage(connectionIdentifier, message); }))) {
+        if (opened)
+            LOGE("Error at ProcessLauncher::Connection::messageRingsOpened() - %s", "could not receive from the message ring");
+        m_inputRing->close();
+        m_outputRing->close();
+        m_inputRing = nullptr;
+        m_outputRing = nullptr;
+        return;
+    }
+
+    // Confirmed through the Messenger, which goes ahead of everything sent into the ring from now on.
+    Message confirmation = ProcessMessages::get().MessageRingsOpened(true);
+    m_messageSender->send(confirmation);
+    m_messageRingsOpened = true;
+}
+
 inline void ProcessLauncherMessageHandler::handleMessage(Message& message)
 {
     m_handler(message);
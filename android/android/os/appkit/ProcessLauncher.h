@@ -29,6 +29,9 @@
 
 namespace android {
 namespace os {
+
+class MessageRing;
+
 namespace appkit {
 
 class ProcessLauncher final {
@@ -45,12 +48,22 @@ public:
         ANDROID_EXPORT void addMessageReceiver(std::function<bool (Messenger&, Message&)>);
         ANDROID_EXPORT void setMessageReceiver(std::function<bool (Messenger&, Message&)>, Messages&);
         ANDROID_EXPORT bool receive(Message&);
+        // Moves the messages of this connection onto a ring in shared memory per direction, for high message rates.
+        // Returns false where the platform does not support it, and messages keep going through the Messenger,
+        // as they do until the process confirms it opened the rings.
+        ANDROID_EXPORT bool openMessageRings();
 
     protected:
         Connection();
 
+        void messageRingsOpened(bool opened);
+
         int32_t m_connectionIdentifier;
         std::shared_ptr<Messenger> m_messageSender;
+        std::shared_ptr<MessageRing> m_inputRing;
+        std::shared_ptr<MessageRing> m_outputRing;
+        // Whether the process confirmed it opened the rings, and messages are sent into m_outputRing.
+        bool m_messageRingsOpened;
         MessageFilter m_messageFilter;
     };
 
@@ -74,6 +87,7 @@ private:
     ~ProcessLauncher() = default;
 
     static void handleMessage(Message& message);
+    static void receiveMessage(int32_t connection, Message& message);
 
     static void platformInitialize();
     static Connection* platformCreateProcess(const String& moduleName, const String& moduleEntry,
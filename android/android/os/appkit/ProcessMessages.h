@@ -35,6 +35,8 @@ class ProcessMessages : public Messages {
 public:
     const int32_t PROCESS_LAUNCHED;
     const int32_t LOAD_LIBRARY;
+    const int32_t OPEN_MESSAGE_RINGS;
+    const int32_t MESSAGE_RINGS_OPENED;
 
     static ProcessMessages& get()
     {
@@ -48,6 +50,19 @@ public:
         return name;
     }
 
+    // The ring the launched process receives from, and the one it sends into.
+    static const String& inputRingKey()
+    {
+        static const String name(L"inputRing");
+        return name;
+    }
+
+    static const String& outputRingKey()
+    {
+        static const String name(L"outputRing");
+        return name;
+    }
+
     inline Message ProcessLaunched(std::shared_ptr<Messenger>& replyTo, int32_t connectionIdentifier)
     {
         return obtain(replyTo, PROCESS_LAUNCHED, connectionIdentifier);
@@ -60,10 +75,24 @@ public:
         return message;
     }
 
+    inline Message OpenMessageRings()
+    {
+        return Message::obtain(nullptr, OPEN_MESSAGE_RINGS);
+    }
+
+    // Sent through the Messenger by each end right before it starts sending into its ring, so that the
+    // other end only starts receiving from that ring once it has received everything sent before.
+    inline Message MessageRingsOpened(bool opened)
+    {
+        return Message::obtain(nullptr, MESSAGE_RINGS_OPENED, opened);
+    }
+
 private:
     ProcessMessages()
         : PROCESS_LAUNCHED(getUniqueMessageIdentifier(0))
         , LOAD_LIBRARY(getUniqueMessageIdentifier(1))
+        , OPEN_MESSAGE_RINGS(getUniqueMessageIdentifier(2))
+        , MESSAGE_RINGS_OPENED(getUniqueMessageIdentifier(3))
     {
     }
 };
@@ -27,26 +27,43 @@
 
 #include "Looper.h"
 #include "Process.h"
-
-#include <pthread.h>
+#include <platforms/LogHelper.h>
 
 namespace android {
 namespace os {
 namespace appkit {
 
-pthread_main_np_t mainThreadIdentifier = 0;
-
 bool Thread::isMainThread()
 {
     return Looper::myLooper() == Looper::getMainLooper();
 }
 
-void Thread::initializeWorkerThread()
+std::thread Thread::start(Runnable r, const Options& options)
+{
+    return std::thread([r = std::move(r), options] () mutable {
+        initializeWorkerThread();
+        if (!setOptions(options))
+            LOGW("Could not apply scheduling options to thread %d", myTid());
+        r();
+    });
+}
+
+bool Thread::setOptions(const Options& options)
 {
-    pthread_init_current_np(mainThreadIdentifier);
+    int32_t tid = myTid();
+    bool applied = true;
+
+    if (options.policy != SchedulingPolicy::Normal)
+        applied &= setThreadScheduler(tid, options.policy, options.realtimePriority);
+    if (options.priority != THREAD_PRIORITY_DEFAULT)
+        applied &= setThreadPriority(tid, options.priority);
+    if (options.affinity)
+        applied &= setThreadAffinity(tid, options.affinity);
+
+    return applied;
 }
 
-void Thread::runOnMainThread(std::function<void ()> r)
+void Thread::runOnMainThread(Runnable r)
 {
     if (isMainThread())
         r();
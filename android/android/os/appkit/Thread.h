@@ -27,6 +27,8 @@
 
 #include <java/lang.h>
 
+#include <chrono>
+#include <functional>
 #include <thread>
 
 namespace android {
@@ -35,13 +37,70 @@ namespace appkit {
 
 class Thread {
 public:
+    // Thread priorities, as nice levels with the values of android.os.Process.
+    static const int32_t THREAD_PRIORITY_URGENT_AUDIO = -19;
+    static const int32_t THREAD_PRIORITY_AUDIO = -16;
+    static const int32_t THREAD_PRIORITY_URGENT_DISPLAY = -8;
+    static const int32_t THREAD_PRIORITY_DISPLAY = -4;
+    static const int32_t THREAD_PRIORITY_FOREGROUND = -2;
+    static const int32_t THREAD_PRIORITY_DEFAULT = 0;
+    static const int32_t THREAD_PRIORITY_BACKGROUND = 10;
+    static const int32_t THREAD_PRIORITY_LOWEST = 19;
+
+    enum class SchedulingPolicy {
+        Normal,
+        Fifo,
+        RoundRobin,
+    };
+
+    // Scheduling options applied to a thread when it starts, before it runs any code.
+    struct Options {
+        int32_t priority = THREAD_PRIORITY_DEFAULT;
+        // Real-time policies take precedence over the nice level, and usually need elevated privileges.
+        SchedulingPolicy policy = SchedulingPolicy::Normal;
+        int32_t realtimePriority = 0;
+        // A mask of the CPUs the thread may run on; zero leaves the inherited affinity.
+        uint64_t affinity = 0;
+    };
+
+    // Returns the identifier of a thread, or 0 on Linux for a thread which neither was started by start(),
+    // nor called myTid() or initializeWorkerThread() yet.
     ANDROID_EXPORT static uint32_t getThreadId(std::thread::native_handle_type);
+    // Returns the identifier of the calling thread, as used by the scheduling functions below.
+    ANDROID_EXPORT static int32_t myTid();
+
+    // Set the priority of a thread, from THREAD_PRIORITY_URGENT_AUDIO to THREAD_PRIORITY_LOWEST.
+    // Returns false if the priority could not be set, such as raising it without permission.
+    ANDROID_EXPORT static bool setThreadPriority(int32_t tid, int32_t priority);
+    // Set the priority of the calling thread.
+    static bool setThreadPriority(int32_t priority) { return setThreadPriority(myTid(), priority); }
+    // Return the current priority of a thread.
+    ANDROID_EXPORT static int32_t getThreadPriority(int32_t tid);
+
+    // Set the scheduling policy of a thread. realtimePriority only applies to real-time policies,
+    // where it ranges from 1 to 99. Returns false where real-time scheduling is not permitted.
+    ANDROID_EXPORT static bool setThreadScheduler(int32_t tid, SchedulingPolicy policy, int32_t realtimePriority);
+    // Return the scheduling policy of a thread.
+    ANDROID_EXPORT static SchedulingPolicy getThreadScheduler(int32_t tid);
+
+    // Restrict a thread to the CPUs in mask, where bit n stands for CPU n.
+    ANDROID_EXPORT static bool setThreadAffinity(int32_t tid, uint64_t mask);
+    // Return the mask of the CPUs a thread may run on.
+    ANDROID_EXPORT static uint64_t getThreadAffinity(int32_t tid);
+
+    // Return the CPU time consumed by a thread so far.
+    ANDROID_EXPORT static std::chrono::nanoseconds getThreadCpuTime(std::thread::native_handle_type);
+
+    // Start a thread running r, with the given scheduling options.
+    ANDROID_EXPORT static std::thread start(Runnable r, const Options& options);
+    // Apply scheduling options to the calling thread. Returns false if any of them could not be applied.
+    ANDROID_EXPORT static bool setOptions(const Options& options);
 
     ANDROID_EXPORT static bool isMainThread();
 
     ANDROID_EXPORT static void initializeWorkerThread();
 
-    ANDROID_EXPORT static void runOnMainThread(std::function<void ()>);
+    ANDROID_EXPORT static void runOnMainThread(Runnable);
 
 private:
     Thread() = default;
@@ -29,5 +29,6 @@
 #include <java/lang/Object.h>
 
 #include <java/lang/CharSequence.h>
+#include <java/lang/Runnable.h>
 #include <java/lang/StringInlines.h>
 #include <java/lang/System.h>
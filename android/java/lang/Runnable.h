@@ -0,0 +1,228 @@
+/*
+ * Copyright (C) 2016 Naver Corp. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace java {
+namespace lang {
+
+// A move-only callable taking no arguments. Captures up to inlineCapacity bytes
+// are stored inline, so wrapping a typical lambda does not allocate.
+class Runnable final {
+public:
+    static const size_t inlineCapacity = 6 * sizeof(void*);
+
+    Runnable()
+        : m_operations(nullptr)
+    {
+    }
+    Runnable(std::nullptr_t)
+        : m_operations(nullptr)
+    {
+    }
+    template<typename Function, typename = typename std::enable_if<!std::is_same<typename std::decay<Function>::type, Runnable>::value>::type>
+    Runnable(Function&& function)
+        : m_operations(nullptr)
+    {
+        typedef typename std::decay<Function>::type Callable;
+        if (isNull(function))
+            return;
+
+        Storage<Callable>::construct(m_storage, std::forward<Function>(function));
+        m_operations = &Storage<Callable>::operations;
+    }
+    Runnable(Runnable&& other)
+        : m_operations(other.m_operations)
+    {
+        if (m_operations)
+            m_operations->move(other.m_storage, m_storage);
+        other.m_operations = nullptr;
+    }
+    Runnable(const Runnable&) = delete;
+    ~Runnable()
+    {
+        reset();
+    }
+
+    Runnable& operator=(Runnable&& other)
+    {
+        if (this == &other)
+            return *this;
+
+        reset();
+        m_operations = other.m_operations;
+        if (m_operations)
+            m_operations->move(other.m_storage, m_storage);
+        other.m_operations = nullptr;
+        return *this;
+    }
+    Runnable& operator=(const Runnable&) = delete;
+
+    void operator()()
+    {
+        m_operations->invoke(m_storage);
+    }
+
+    explicit operator bool() const
+    {
+        return m_operations != nullptr;
+    }
+
+    // Returns a pointer to the wrapped callable if it is of type Callable, or nullptr otherwise.
+    template<typename Callable>
+    const Callable* target() const
+    {
+        if (m_operations != &Storage<Callable>::operations)
+            return nullptr;
+        return Storage<Callable>::get(const_cast<unsigned char*>(m_storage));
+    }
+
+    // Returns an address identifying the code this Runnable runs, for diagnostics. That is the
+    // wrapped function itself for plain functions, and code specific to the callable type otherwise.
+    const void* code() const
+    {
+        if (!m_operations)
+            return nullptr;
+        if (auto* function = target<void (*)()>())
+            return reinterpret_cast<const void*>(*function);
+        return reinterpret_cast<const void*>(m_operations->invoke);
+    }
+
+private:
+    struct Operations {
+        void (*invoke)(void*);
+        void (*move)(void* from, void* to);
+        void (*destroy)(void*);
+    };
+
+    // Over-aligned callables do not fit the alignment of the inline storage, so they live on the heap too.
+    template<typename Callable, bool = (sizeof(Callable) <= inlineCapacity && alignof(Callable) <= alignof(std::max_align_t)
+        && std::is_nothrow_move_constructible<Callable>::value)>
+    struct Storage {
+        template<typename Function>
+        static void construct(void* storage, Function&& function)
+        {
+            new (storage) Callable(std::forward<Function>(function));
+        }
+        static Callable* get(void* storage)
+        {
+            return static_cast<Callable*>(storage);
+        }
+        static void invoke(void* storage)
+        {
+            (*get(storage))();
+        }
+        static void move(void* from, void* to)
+        {
+            new (to) Callable(std::move(*get(from)));
+            get(from)->~Callable();
+        }
+        static void destroy(void* storage)
+        {
+            get(storage)->~Callable();
+        }
+
+        static const Operations operations;
+    };
+
+    // Captures which do not fit inline live on the heap.
+    template<typename Callable>
+    struct Storage<Callable, false> {
+        template<typename Function>
+        static void construct(void* storage, Function&& function)
+        {
+            *static_cast<Callable**>(storage) = new Callable(std::forward<Function>(function));
+        }
+        static Callable* get(void* storage)
+        {
+            return *static_cast<Callable**>(storage);
+        }
+        static void invoke(void* storage)
+        {
+            (*get(storage))();
+        }
+        static void move(void* from, void* to)
+        {
+            *static_cast<Callable**>(to) = get(from);
+        }
+        static void destroy(void* storage)
+        {
+            delete get(storage);
+        }
+
+        static const Operations operations;
+    };
+
+    template<typename Function>
+    static bool isNull(const Function&)
+    {
+        return false;
+    }
+    template<typename Result, typename... Arguments>
+    static bool isNull(Result (*function)(Arguments...))
+    {
+        return !function;
+    }
+    template<typename Signature>
+    static bool isNull(const std::function<Signature>& function)
+    {
+        return !function;
+    }
+
+    void reset()
+    {
+        if (m_operations)
+            m_operations->destroy(m_storage);
+        m_operations = nullptr;
+    }
+
+    const Operations* m_operations;
+    alignas(std::max_align_t) unsigned char m_storage[inlineCapacity];
+};
+
+template<typename Callable, bool isInline>
+const Runnable::Operations Runnable::Storage<Callable, isInline>::operations = {
+    &Runnable::Storage<Callable, isInline>::invoke,
+    &Runnable::Storage<Callable, isInline>::move,
+    &Runnable::Storage<Callable, isInline>::destroy,
+};
+
+template<typename Callable>
+const Runnable::Operations Runnable::Storage<Callable, false>::operations = {
+    &Runnable::Storage<Callable, false>::invoke,
+    &Runnable::Storage<Callable, false>::move,
+    &Runnable::Storage<Callable, false>::destroy,
+};
+
+} // namespace lang
+} // namespace java
+
+using Runnable = java::lang::Runnable;
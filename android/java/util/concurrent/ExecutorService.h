@@ -0,0 +1,84 @@
+/*
+ * Copyright (C) 2016 Naver Corp. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <android/os/Future.h>
+#include <java/util/concurrent/Executor.h>
+
+namespace java {
+namespace util {
+namespace concurrent {
+
+// An Executor that provides methods to manage termination, and to track the results of tasks with a Future.
+// Results are delivered to any Handler with Future::then().
+class ExecutorService : public Executor {
+public:
+    // Tasks of higher priority are taken first by idle workers. Lower priority tasks are not
+    // preempted, and still run whenever no higher priority work is waiting.
+    enum class Priority {
+        High,
+        Normal,
+        Low,
+    };
+
+    static const size_t priorityCount = 3;
+
+    // Executes the given command at some time in the future, at normal priority.
+    void execute(Runnable command) override { execute(std::move(command), Priority::Normal); }
+    // Executes the given command at some time in the future, at the given priority.
+    virtual void execute(Runnable command, Priority priority) = 0;
+
+    // Submits a value-returning task for execution, and returns a Future of its result.
+    template<typename Function>
+    auto submit(Function&& task, Priority priority = Priority::Normal) -> android::os::Future<decltype(task())>;
+
+    // Initiates an orderly shutdown in which previously submitted tasks are executed, but no new tasks will be accepted.
+    virtual void shutdown() = 0;
+    // Returns true if this executor has been shut down.
+    virtual bool isShutdown() = 0;
+    // Blocks until all tasks have completed execution after a shutdown request.
+    virtual void awaitTermination() = 0;
+};
+
+template<typename Function>
+auto ExecutorService::submit(Function&& task, Priority priority) -> android::os::Future<decltype(task())>
+{
+    typedef decltype(task()) Result;
+    typedef typename std::decay<Function>::type Callable;
+
+    android::os::Promise<Result> promise;
+    android::os::Future<Result> future = promise.getFuture();
+    execute([promise, callable = Callable(std::forward<Function>(task))] () mutable {
+        android::os::FutureCall::fulfil(promise, callable);
+    }, priority);
+    return future;
+}
+
+} // namespace concurrent
+} // namespace util
+} // namespace java
+
+using ExecutorService = java::util::concurrent::ExecutorService;
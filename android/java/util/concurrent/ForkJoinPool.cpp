@@ -0,0 +1,398 @@
+/*
+ * Copyright (C) 2016 Naver Corp. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "ForkJoinPool.h"
+
+#include <android/os/MessagePool.h>
+#include <platforms/LogHelper.h>
+
+#include <new>
+
+#include <assert>
+
+namespace java {
+namespace util {
+namespace concurrent {
+
+// The Chase-Lev work-stealing deque, with the memory orderings of "Correct and Efficient
+// Work-Stealing for Weak Memory Models" (Lê et al., PPoPP 2013). The owning worker pushes
+// and pops at the bottom, any other worker steals from the top.
+class WorkStealingDeque {
+public:
+    typedef Runnable* Task;
+
+    WorkStealingDeque()
+        : m_top(0)
+        , m_bottom(0)
+        , m_array(new Array(initialCapacity))
+    {
+    }
+    ~WorkStealingDeque()
+    {
+        delete m_array.load(std::memory_order_relaxed);
+    }
+
+    bool isEmpty() const
+    {
+        return m_bottom.load(std::memory_order_relaxed) <= m_top.load(std::memory_order_relaxed);
+    }
+
+    // Owner only.
+    void push(Task task)
+    {
+        int64_t bottom = m_bottom.load(std::memory_order_relaxed);
+        int64_t top = m_top.load(std::memory_order_acquire);
+        Array* array = m_array.load(std::memory_order_relaxed);
+        if (bottom - top > static_cast<int64_t>(array->capacity()) - 1)
+            array = grow(array, top, bottom);
+
+        array->put(bottom, task);
+        std::atomic_thread_fence(std::memory_order_release);
+        m_bottom.store(bottom + 1, std::memory_order_relaxed);
+    }
+
+    // Owner only.
+    Task pop()
+    {
+        int64_t bottom = m_bottom.load(std::memory_order_relaxed) - 1;
+        Array* array = m_array.load(std::memory_order_relaxed);
+        m_bottom.store(bottom, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t top = m_top.load(std::memory_order_relaxed);
+
+        if (top > bottom) {
+            m_bottom.store(bottom + 1, std::memory_order_relaxed);
+            return nullptr;
+        }
+
+        Task task = array->get(bottom);
+        if (top == bottom) {
+            // The last task may be contended by a thief.
+            if (!m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+                task = nullptr;
+            m_bottom.store(bottom + 1, std::memory_order_relaxed);
+        }
+        return task;
+    }
+
+    Task steal()
+    {
+        int64_t top = m_top.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t bottom = m_bottom.load(std::memory_order_acquire);
+        if (top >= bottom)
+            return nullptr;
+
+        Task task = m_array.load(std::memory_order_acquire)->get(top);
+        if (!m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+            return nullptr;
+        return task;
+    }
+
+private:
+    static const size_t initialCapacity = 256;
+
+    class Array {
+    public:
+        explicit Array(size_t capacity)
+            : m_mask(capacity - 1)
+            , m_items(new std::atomic<Task>[capacity])
+        {
+        }
+
+        size_t capacity() const { return m_mask + 1; }
+
+        Task get(int64_t index) const
+        {
+            return m_items[static_cast<size_t>(index) & m_mask].load(std::memory_order_relaxed);
+        }
+        void put(int64_t index, Task task)
+        {
+            m_items[static_cast<size_t>(index) & m_mask].store(task, std::memory_order_relaxed);
+        }
+
+    private:
+        size_t m_mask;
+        std::unique_ptr<std::atomic<Task>[]> m_items;
+    };
+
+    Array* grow(Array* array, int64_t top, int64_t bottom)
+    {
+        Array* grownArray = new Array(array->capacity() * 2);
+        for (int64_t index = top; index < bottom; ++index)
+            grownArray->put(index, array->get(index));
+
+        // Thieves may still be reading the old array, so it is only freed with the deque.
+        m_retiredArrays.emplace_back(array);
+        m_array.store(grownArray, std::memory_order_release);
+        return grownArray;
+    }
+
+    // Thieves update top and the owner updates bottom, so they are kept on separate cache lines.
+    std::atomic<int64_t> m_top;
+    char m_padding[64 - sizeof(std::atomic<int64_t>)];
+    std::atomic<int64_t> m_bottom;
+    std::atomic<Array*> m_array;
+    std::vector<std::unique_ptr<Array>> m_retiredArrays;
+};
+
+class ForkJoinPool::Worker {
+public:
+    explicit Worker(size_t index)
+        : index(index)
+        , randomState(static_cast<uint32_t>(index) * 2654435761u + 1)
+    {
+    }
+
+    // A xorshift generator picking the first victim to steal from.
+    size_t nextVictim(size_t workerCount)
+    {
+        randomState ^= randomState << 13;
+        randomState ^= randomState >> 17;
+        randomState ^= randomState << 5;
+        return randomState % workerCount;
+    }
+
+    const size_t index;
+    std::array<WorkStealingDeque, priorityCount> deques;
+    std::thread thread;
+
+private:
+    uint32_t randomState;
+};
+
+static thread_local ForkJoinPool* currentPool;
+static thread_local size_t currentWorkerIndex;
+
+static_assert(sizeof(Runnable) <= android::os::MessagePool::nodeSize, "Runnable must fit in a pooled node");
+
+// Tasks live in pooled nodes, since a fork-join computation creates and runs them at a high rate.
+static Runnable* createTask(Runnable&& command)
+{
+    return new (android::os::MessagePool::obtain(sizeof(Runnable))) Runnable(std::move(command));
+}
+
+static void destroyTask(Runnable* task)
+{
+    task->~Runnable();
+    android::os::MessagePool::recycle(task);
+}
+
+ForkJoinPool::ForkJoinPool(int32_t parallelism)
+    : m_submissionCount(0)
+    , m_sleepingWorkers(0)
+    , m_pendingSignals(0)
+    , m_shutdown(false)
+    , m_stealCount(0)
+{
+    size_t workerCount = static_cast<size_t>(std::max(parallelism, 1));
+    for (size_t index = 0; index < workerCount; ++index)
+        m_workers.push_back(std::unique_ptr<Worker>(new Worker(index)));
+
+    // Workers only start once all of them exist, since they steal from each other.
+    for (auto& worker : m_workers) {
+        Worker* runningWorker = worker.get();
+        worker->thread = std::thread([this, runningWorker] { run(*runningWorker); });
+    }
+}
+
+ForkJoinPool::~ForkJoinPool()
+{
+    shutdown();
+    awaitTermination();
+}
+
+// Executes the given command at some time in the future, at the given priority.
+// Commands rejected by a pool which is shut down are destroyed without running, which cancels the Future of submit().
+void ForkJoinPool::execute(Runnable command, Priority priority)
+{
+    Task task = createTask(std::move(command));
+    size_t queue = static_cast<size_t>(priority);
+    bool rejected = false;
+
+    if (currentPool == this) {
+        // A worker drains its own deque before it terminates.
+        rejected = m_shutdown.load(std::memory_order_relaxed);
+        if (!rejected)
+            m_workers[currentWorkerIndex]->deques[queue].push(task);
+    } else {
+        // Checked under the lock shutdown() takes, so that a published task is always seen by a worker before it terminates.
+        std::lock_guard<std::mutex> lock(m_submissionMutex);
+        rejected = m_shutdown.load(std::memory_order_relaxed);
+        if (!rejected) {
+            m_submissions[queue].push_back(task);
+            m_submissionCount.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    if (rejected) {
+        LOGW("Task rejected by a pool which is shut down: %p", this);
+        destroyTask(task);
+        return;
+    }
+
+    signalWork();
+}
+
+// Initiates an orderly shutdown in which previously submitted tasks are executed, but no new tasks will be accepted.
+void ForkJoinPool::shutdown()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_submissionMutex);
+        m_shutdown.store(true);
+    }
+
+    std::lock_guard<std::mutex> lock(m_sleepMutex);
+    m_sleepCondition.notify_all();
+}
+
+// Returns true if this executor has been shut down.
+bool ForkJoinPool::isShutdown()
+{
+    return m_shutdown.load();
+}
+
+// Blocks until all tasks have completed execution after a shutdown request.
+void ForkJoinPool::awaitTermination()
+{
+    assert(m_shutdown.load());
+    assert(currentPool != this);
+
+    for (auto& worker : m_workers) {
+        if (worker->thread.joinable())
+            worker->thread.join();
+    }
+}
+
+void ForkJoinPool::run(Worker& worker)
+{
+    currentPool = this;
+    currentWorkerIndex = worker.index;
+
+    while (true) {
+        if (Task task = takeTask(worker)) {
+            (*task)();
+            destroyTask(task);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(m_sleepMutex);
+        m_sleepingWorkers.fetch_add(1);
+        // Pairs with the fence in signalWork(), so that either the submitter sees this worker
+        // going to sleep, or this worker sees the submitted task.
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        // Shutdown is read first, so that any task published before it is found by hasTasks().
+        bool shutdown = m_shutdown.load();
+        if (hasTasks()) {
+            m_sleepingWorkers.fetch_sub(1);
+            continue;
+        }
+        if (shutdown) {
+            m_sleepingWorkers.fetch_sub(1);
+            break;
+        }
+
+        while (!m_pendingSignals && !m_shutdown.load())
+            m_sleepCondition.wait(lock);
+        if (m_pendingSignals)
+            --m_pendingSignals;
+        m_sleepingWorkers.fetch_sub(1);
+    }
+
+    currentPool = nullptr;
+}
+
+// Takes the most urgent task: own tasks first, then submissions, then tasks stolen from other workers.
+ForkJoinPool::Task ForkJoinPool::takeTask(Worker& worker)
+{
+    size_t workerCount = m_workers.size();
+
+    for (size_t priority = 0; priority < priorityCount; ++priority) {
+        if (Task task = worker.deques[priority].pop())
+            return task;
+
+        if (Task task = pollSubmission(priority))
+            return task;
+
+        size_t victim = worker.nextVictim(workerCount);
+        for (size_t attempt = 0; attempt < workerCount; ++attempt, victim = (victim + 1) % workerCount) {
+            if (victim == worker.index)
+                continue;
+
+            if (Task task = m_workers[victim]->deques[priority].steal()) {
+                m_stealCount.fetch_add(1, std::memory_order_relaxed);
+                return task;
+            }
+        }
+    }
+
+    return nullptr;
+}
+
+ForkJoinPool::Task ForkJoinPool::pollSubmission(size_t priority)
+{
+    if (!m_submissionCount.load(std::memory_order_relaxed))
+        return nullptr;
+
+    std::lock_guard<std::mutex> lock(m_submissionMutex);
+    std::deque<Task>& submissions = m_submissions[priority];
+    if (submissions.empty())
+        return nullptr;
+
+    Task task = submissions.front();
+    submissions.pop_front();
+    m_submissionCount.fetch_sub(1, std::memory_order_relaxed);
+    return task;
+}
+
+bool ForkJoinPool::hasTasks()
+{
+    if (m_submissionCount.load(std::memory_order_relaxed))
+        return true;
+
+    for (auto& worker : m_workers) {
+        for (auto& deque : worker->deques) {
+            if (!deque.isEmpty())
+                return true;
+        }
+    }
+    return false;
+}
+
+void ForkJoinPool::signalWork()
+{
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (!m_sleepingWorkers.load(std::memory_order_relaxed))
+        return;
+
+    std::lock_guard<std::mutex> lock(m_sleepMutex);
+    if (m_pendingSignals < m_sleepingWorkers.load(std::memory_order_relaxed))
+        ++m_pendingSignals;
+    m_sleepCondition.notify_one();
+}
+
+} // namespace concurrent
+} // namespace util
+} // namespace java
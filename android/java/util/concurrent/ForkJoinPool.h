@@ -0,0 +1,94 @@
+/*
+ * Copyright (C) 2016 Naver Corp. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <java/util/concurrent/ExecutorService.h>
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace java {
+namespace util {
+namespace concurrent {
+
+// A work-stealing ExecutorService. Each worker thread keeps the tasks it submits itself in
+// Chase-Lev deques, one for each priority, which it pushes and pops at the bottom without
+// locking while idle workers steal from their top. Tasks submitted from other threads go
+// through a shared queue for each priority.
+class ANDROID_EXPORT ForkJoinPool final : public ExecutorService {
+public:
+    // Creates a pool with the given parallelism level, the number of available processors by default.
+    explicit ForkJoinPool(int32_t parallelism = static_cast<int32_t>(std::thread::hardware_concurrency()));
+    ~ForkJoinPool();
+
+    using ExecutorService::execute;
+    void execute(Runnable command, Priority priority) override;
+
+    void shutdown() override;
+    bool isShutdown() override;
+    void awaitTermination() override;
+
+    // Returns the targeted parallelism level of this pool.
+    int32_t getParallelism() const { return static_cast<int32_t>(m_workers.size()); }
+    // Returns the number of tasks taken from the deque of another worker.
+    uint64_t getStealCount() const { return m_stealCount.load(std::memory_order_relaxed); }
+
+private:
+    class Worker;
+    typedef Runnable* Task;
+
+    void run(Worker&);
+    Task takeTask(Worker&);
+    Task pollSubmission(size_t priority);
+    bool hasTasks();
+    void signalWork();
+
+    std::vector<std::unique_ptr<Worker>> m_workers;
+
+    std::mutex m_submissionMutex;
+    std::array<std::deque<Task>, priorityCount> m_submissions;
+    std::atomic<size_t> m_submissionCount;
+
+    // Idle workers sleep until signalled; a signal is only sent when some worker is asleep.
+    std::mutex m_sleepMutex;
+    std::condition_variable m_sleepCondition;
+    std::atomic<uint32_t> m_sleepingWorkers;
+    uint32_t m_pendingSignals;
+
+    std::atomic<bool> m_shutdown;
+    std::atomic<uint64_t> m_stealCount;
+};
+
+} // namespace concurrent
+} // namespace util
+} // namespace java
+
+using ForkJoinPool = java::util::concurrent::ForkJoinPool;
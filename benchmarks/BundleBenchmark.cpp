@@ -0,0 +1,206 @@
+/*
+ * Copyright (C) 2016 Naver Corp. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "BenchmarkHelper.h"
+
+#include <android/os/Bundle.h>
+#include <platforms/StringConversion.h>
+
+#include <json/json.h>
+
+#include <memory>
+#include <vector>
+
+static const size_t iterations = 1 << 16;
+
+// The JSON path Bundles took before the binary one: values live in a Json::Value under UTF-8 keys, and the
+// document is written into the parcel as text and parsed back.
+class JSONBundle {
+public:
+    void putBoolean(const String& key, bool value) { m_root[std::ws2s(key)] = value; }
+    bool getBoolean(const String& key) const { return find(key).asBool(); }
+    void putInt(const String& key, int32_t value) { m_root[std::ws2s(key)] = value; }
+    int32_t getInt(const String& key) const { return find(key).asInt(); }
+    void putLong(const String& key, int64_t value) { m_root[std::ws2s(key)] = static_cast<Json::Int64>(value); }
+    int64_t getLong(const String& key) const { return find(key).asInt64(); }
+    void putDouble(const String& key, double value) { m_root[std::ws2s(key)] = value; }
+    double getDouble(const String& key) const { return find(key).asDouble(); }
+    void putString(const String& key, const String& value) { m_root[std::ws2s(key)] = std::ws2s(value); }
+    String getString(const String& key) const { return std::s2ws(find(key).asString()); }
+
+    void putIntArray(const String& key, const std::vector<int32_t>& values)
+    {
+        Json::Value array(Json::arrayValue);
+        for (int32_t value : values)
+            array.append(value);
+        m_root[std::ws2s(key)] = std::move(array);
+    }
+    std::vector<int32_t> getIntArray(const String& key) const
+    {
+        const Json::Value& array = find(key);
+        std::vector<int32_t> values;
+        values.reserve(array.size());
+        for (const Json::Value& value : array)
+            values.push_back(value.asInt());
+        return values;
+    }
+
+    void putBundle(const String& key, const JSONBundle& value) { m_root[std::ws2s(key)] = value.m_root; }
+    JSONBundle getBundle(const String& key) const
+    {
+        JSONBundle bundle;
+        bundle.m_root = find(key);
+        return bundle;
+    }
+
+    void writeToParcel(Parcel& dest, int32_t)
+    {
+        Json::StreamWriterBuilder builder;
+        std::string document = Json::writeString(builder, m_root);
+        dest.writeBlob(document.data(), document.size());
+    }
+
+    void readFromParcel(Parcel& parcel)
+    {
+        size_t size;
+        const char* document = static_cast<const char*>(parcel.readBlob(&size));
+        if (!document)
+            return;
+
+        Json::CharReaderBuilder builder;
+        std::unique_ptr<Json::CharReader> reader(builder.newCharReader());
+        std::string errors;
+        reader->parse(document, document + size, &m_root, &errors);
+    }
+
+private:
+    const Json::Value& find(const String& key) const { return m_root[std::ws2s(key)]; }
+
+    Json::Value m_root;
+};
+
+// Strings only, as messages carried them when Bundles held nothing but CharSequences.
+struct StringsWorkload {
+    static const char* name() { return "strings"; }
+
+    template<typename BundleType>
+    static void put(BundleType& bundle)
+    {
+        static const String keys[] = { L"action", L"category", L"component", L"data", L"package", L"scheme", L"title", L"type" };
+        for (const String& key : keys)
+            bundle.putString(key, key + L"://0123456789abcdefghijklmnopqrstuvwxyz");
+    }
+
+    template<typename BundleType>
+    static size_t get(BundleType& bundle)
+    {
+        static const String keys[] = { L"action", L"category", L"component", L"data", L"package", L"scheme", L"title", L"type" };
+        size_t checksum = 0;
+        for (const String& key : keys)
+            checksum += bundle.getString(key).size();
+        return checksum;
+    }
+};
+
+// A typical message with typed values, an array and a nested Bundle.
+struct TypedWorkload {
+    static const char* name() { return "typed"; }
+
+    template<typename BundleType>
+    static void put(BundleType& bundle)
+    {
+        bundle.putBoolean(L"enabled", true);
+        bundle.putInt(L"width", 1920);
+        bundle.putInt(L"height", 1080);
+        bundle.putLong(L"timestamp", 1234567890123ll);
+        bundle.putDouble(L"scale", 1.5);
+        bundle.putString(L"title", L"surface");
+        bundle.putIntArray(L"rect", std::vector<int32_t>(32, 7));
+        BundleType nested;
+        nested.putInt(L"format", 4);
+        nested.putString(L"name", L"nested");
+        bundle.putBundle(L"config", nested);
+    }
+
+    template<typename BundleType>
+    static size_t get(BundleType& bundle)
+    {
+        size_t checksum = bundle.getBoolean(L"enabled");
+        checksum += bundle.getInt(L"width") + bundle.getInt(L"height");
+        checksum += static_cast<size_t>(bundle.getLong(L"timestamp"));
+        checksum += static_cast<size_t>(bundle.getDouble(L"scale"));
+        checksum += bundle.getString(L"title").size();
+        checksum += bundle.getIntArray(L"rect").size();
+        BundleType nested = bundle.getBundle(L"config");
+        checksum += nested.getInt(L"format") + nested.getString(L"name").size();
+        return checksum;
+    }
+};
+
+static size_t sink;
+
+// Putting the values into a new Bundle, getting them back out, and sending the Bundle through a parcel.
+template<typename BundleType, typename Workload>
+static void benchmarkBundle(const std::string& backend)
+{
+    std::string suffix = backend + ", " + Workload::name();
+
+    std::chrono::nanoseconds elapsed = measureBenchmark([&] {
+        for (size_t i = 0; i < iterations; ++i) {
+            BundleType bundle;
+            Workload::put(bundle);
+            sink += Workload::get(bundle);
+        }
+    });
+    reportBenchmark("put and get, " + suffix, iterations, elapsed);
+
+    BundleType bundle;
+    Workload::put(bundle);
+    Parcel parcel;
+    elapsed = measureBenchmark([&] {
+        for (size_t i = 0; i < iterations; ++i) {
+            parcel.setDataSize(0);
+            parcel.setDataPosition(0);
+            bundle.writeToParcel(parcel, 0);
+            parcel.setDataPosition(0);
+            BundleType result;
+            result.readFromParcel(parcel);
+            sink += Workload::get(result);
+        }
+    });
+    reportBenchmark("parcel round trip, " + suffix + ", " + std::to_string(parcel.dataSize()) + " bytes", iterations, elapsed);
+}
+
+int main()
+{
+    benchmarkBundle<JSONBundle, StringsWorkload>("json");
+    benchmarkBundle<Bundle, StringsWorkload>("binary");
+    benchmarkBundle<JSONBundle, TypedWorkload>("json");
+    benchmarkBundle<Bundle, TypedWorkload>("binary");
+
+    // Keeps the computation from being optimized away.
+    printf("checksum %zu\n", sink);
+    return 0;
+}
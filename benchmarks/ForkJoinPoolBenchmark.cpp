@@ -0,0 +1,166 @@
+/*
+ * Copyright (C) 2016 Naver Corp. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "BenchmarkHelper.h"
+
+#include <java/util/concurrent/ForkJoinPool.h>
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+static const size_t taskCount = 1 << 14;
+static const size_t iterationsPerTask = 1 << 14;
+
+// Stands for a CPU-heavy job, such as converting a tile of an image.
+static uint64_t compute(uint64_t seed, size_t iterations)
+{
+    uint64_t value = seed | 1;
+    for (size_t i = 0; i < iterations; ++i) {
+        value ^= value << 13;
+        value ^= value >> 7;
+        value ^= value << 17;
+    }
+    return value;
+}
+
+class Completion {
+public:
+    explicit Completion(size_t count)
+        : m_remaining(count)
+    {
+    }
+
+    void countDown()
+    {
+        if (--m_remaining)
+            return;
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_condition.notify_all();
+    }
+
+    void wait()
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_condition.wait(lock, [this] { return !m_remaining.load(); });
+    }
+
+private:
+    std::atomic<size_t> m_remaining;
+    std::mutex m_mutex;
+    std::condition_variable m_condition;
+};
+
+// Tasks submitted from outside the pool, which go through its shared submission queue.
+static std::chrono::nanoseconds benchmarkSubmissions(int32_t parallelism, std::atomic<uint64_t>& sink)
+{
+    ForkJoinPool pool(parallelism);
+    Completion completion(taskCount);
+
+    std::chrono::nanoseconds elapsed = measureBenchmark([&] {
+        for (size_t i = 0; i < taskCount; ++i) {
+            pool.execute([&sink, &completion, i] {
+                sink.fetch_add(compute(i, iterationsPerTask), std::memory_order_relaxed);
+                completion.countDown();
+            });
+        }
+        completion.wait();
+    });
+
+    pool.shutdown();
+    pool.awaitTermination();
+    return elapsed;
+}
+
+// Splits a range in halves from inside the pool, so that the workers feed their own deques and steal from each other.
+static void forkRange(ForkJoinPool& pool, size_t begin, size_t end, std::atomic<uint64_t>& sink, Completion& completion)
+{
+    while (end - begin > 1) {
+        size_t middle = begin + (end - begin) / 2;
+        pool.execute([&pool, middle, end, &sink, &completion] {
+            forkRange(pool, middle, end, sink, completion);
+        });
+        end = middle;
+    }
+    sink.fetch_add(compute(begin, iterationsPerTask), std::memory_order_relaxed);
+    completion.countDown();
+}
+
+static std::chrono::nanoseconds benchmarkForkJoin(int32_t parallelism, std::atomic<uint64_t>& sink)
+{
+    ForkJoinPool pool(parallelism);
+    Completion completion(taskCount);
+
+    std::chrono::nanoseconds elapsed = measureBenchmark([&] {
+        pool.execute([&] {
+            forkRange(pool, 0, taskCount, sink, completion);
+        });
+        completion.wait();
+    });
+
+    pool.shutdown();
+    pool.awaitTermination();
+    return elapsed;
+}
+
+static std::string speedup(std::chrono::nanoseconds serial, std::chrono::nanoseconds elapsed)
+{
+    char text[16];
+    snprintf(text, sizeof(text), "%.2f", static_cast<double>(serial.count()) / elapsed.count());
+    return text;
+}
+
+int main()
+{
+    std::atomic<uint64_t> sink(0);
+    int32_t processors = std::max<int32_t>(1, static_cast<int32_t>(std::thread::hardware_concurrency()));
+
+    std::vector<int32_t> parallelisms;
+    for (int32_t parallelism = 1; parallelism < processors; parallelism *= 2)
+        parallelisms.push_back(parallelism);
+    parallelisms.push_back(processors);
+
+    std::chrono::nanoseconds serial = measureBenchmark([&] {
+        for (size_t i = 0; i < taskCount; ++i)
+            sink.fetch_add(compute(i, iterationsPerTask), std::memory_order_relaxed);
+    });
+    reportBenchmark("serial", taskCount, serial);
+
+    for (int32_t parallelism : parallelisms) {
+        std::chrono::nanoseconds elapsed = benchmarkSubmissions(parallelism, sink);
+        reportBenchmark("submitted, parallelism=" + std::to_string(parallelism) + ", speedup=" + speedup(serial, elapsed), taskCount, elapsed);
+    }
+    for (int32_t parallelism : parallelisms) {
+        std::chrono::nanoseconds elapsed = benchmarkForkJoin(parallelism, sink);
+        reportBenchmark("forked, parallelism=" + std::to_string(parallelism) + ", speedup=" + speedup(serial, elapsed), taskCount, elapsed);
+    }
+
+    // Keeps the computation from being optimized away.
+    printf("checksum %llu\n", static_cast<unsigned long long>(sink.load()));
+    return 0;
+}
@@ -0,0 +1,105 @@
+/*
+ * Copyright (C) 2016 Naver Corp. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "BenchmarkHelper.h"
+
+#include <android/os/Handler.h>
+#include <android/os/Looper.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+static const size_t totalPosts = 1 << 19;
+
+// Producer threads post to one Looper as fast as they can, which is where the inbox of the queue is contended.
+static void benchmarkCrossThreadPosts(size_t producerCount)
+{
+    std::atomic<Handler*> consumer(nullptr);
+    std::shared_ptr<Handler> handler;
+    std::thread looperThread([&] {
+        Looper::prepare();
+        handler = Handler::create();
+        consumer.store(handler.get());
+        Looper::loop();
+    });
+    while (!consumer.load())
+        std::this_thread::yield();
+
+    size_t postsPerProducer = totalPosts / producerCount;
+    size_t posts = postsPerProducer * producerCount;
+    size_t received = 0;
+    std::atomic<bool> started(false);
+    std::vector<std::thread> producers;
+    for (size_t i = 0; i < producerCount; ++i) {
+        producers.emplace_back([&] {
+            while (!started.load())
+                std::this_thread::yield();
+            for (size_t j = 0; j < postsPerProducer; ++j) {
+                handler->post([&received, posts] {
+                    if (++received == posts)
+                        Looper::myLooper()->quit();
+                });
+            }
+        });
+    }
+
+    std::chrono::nanoseconds elapsed = measureBenchmark([&] {
+        started.store(true);
+        looperThread.join();
+    });
+    for (std::thread& producer : producers)
+        producer.join();
+
+    reportBenchmark("cross-thread post, producers=" + std::to_string(producerCount), posts, elapsed);
+}
+
+// The Looper thread posting to itself, which takes the queue lock instead of the inbox.
+static void benchmarkSameThreadPosts()
+{
+    Looper::prepare();
+    std::shared_ptr<Handler> handler = Handler::create();
+    size_t received = 0;
+
+    std::chrono::nanoseconds elapsed = measureBenchmark([&] {
+        for (size_t i = 0; i < totalPosts; ++i) {
+            handler->post([&received] {
+                if (++received == totalPosts)
+                    Looper::myLooper()->quit();
+            });
+        }
+        Looper::loop();
+    });
+
+    reportBenchmark("same-thread post", totalPosts, elapsed);
+}
+
+int main()
+{
+    std::thread(benchmarkSameThreadPosts).join();
+    for (size_t producerCount = 1; producerCount <= 32; producerCount *= 2)
+        benchmarkCrossThreadPosts(producerCount);
+    return 0;
+}
@@ -0,0 +1,280 @@
+/*
+ * Copyright (C) 2016 Naver Corp. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "BenchmarkHelper.h"
+
+#include <android/os/Handler.h>
+#include <android/os/Looper.h>
+#include <android/os/MessageRing.h>
+#include <android/os/Messenger.h>
+
+#include <functional>
+#include <sys/wait.h>
+#include <thread>
+#include <unistd.h>
+
+using android::os::MessageRing;
+
+static const size_t roundTrips = 1 << 14;
+static const size_t streamedMessages = 1 << 18;
+
+enum {
+    SETUP_RING,
+    PING,
+    STREAM,
+    STREAM_END,
+    QUIT,
+};
+
+class FunctionHandler : public Handler {
+public:
+    explicit FunctionHandler(std::function<void (Message&)> function)
+        : m_function(std::move(function))
+    {
+    }
+
+    void handleMessage(Message& message) override { m_function(message); }
+
+private:
+    std::function<void (Message&)> m_function;
+};
+
+// The child process echoes pings back the way they came, and counts streamed messages. Messages from
+// a ring of the parent are answered through a ring of its own.
+static void runEchoProcess(int32_t binderPipe)
+{
+    Looper::prepareMainLooper();
+
+    std::shared_ptr<MessageRing> input;
+    std::shared_ptr<MessageRing> output;
+    std::shared_ptr<Messenger> parent;
+    int32_t streamed = 0;
+
+    auto closeRings = [&] {
+        if (input)
+            input->close();
+        if (output)
+            output->close();
+    };
+    auto echo = [&] (Message& message, const std::function<void (Message&)>& send) {
+        if (message.what == STREAM) {
+            ++streamed;
+        } else if (message.what == PING || message.what == STREAM_END) {
+            Message reply = Message::obtain(nullptr, message.what, message.what == PING ? message.arg1 : streamed, 0);
+            streamed = 0;
+            send(reply);
+        }
+    };
+
+    std::shared_ptr<Handler> ringHandler = std::make_shared<FunctionHandler>([&] (Message& message) {
+        echo(message, [&] (Message& reply) { output->send(reply, parent); });
+    });
+    std::shared_ptr<Handler> handler = std::make_shared<FunctionHandler>([&] (Message& message) {
+        if (message.what == SETUP_RING) {
+            closeRings();
+            input = MessageRing::open(message.getData(), L"ring");
+            input->receive(ringHandler);
+            output = MessageRing::create();
+            parent = std::make_shared<Messenger>(message.replyTo->getBinder());
+            Message reply = Message::obtain(nullptr, SETUP_RING, 0, 0);
+            output->writeToBundle(reply.getData(), L"ring");
+            parent->send(reply);
+        } else if (message.what == QUIT) {
+            closeRings();
+            Looper::myLooper()->quit();
+        } else {
+            echo(message, [&] (Message& reply) { message.replyTo->send(reply); });
+        }
+    });
+
+    Messenger messenger(handler);
+    IBinder binder = messenger.getBinder();
+    if (::write(binderPipe, &binder, sizeof(binder)) != sizeof(binder))
+        _exit(1);
+    Looper::loop();
+    _exit(0);
+}
+
+// Talks to the child through either its Messenger or a pair of rings, on a Looper of its own, as the Looper
+// of a thread is gone once loop() returns.
+class EchoClient {
+public:
+    EchoClient(IBinder child, bool throughRing)
+        : m_child(std::make_shared<Messenger>(child))
+        , m_handler(std::make_shared<FunctionHandler>([this] (Message& message) { receive(message); }))
+        , m_replyTo(std::make_shared<Messenger>(m_handler))
+        , m_throughRing(throughRing)
+    {
+    }
+
+    // Sends the rings over first if needed, then calls start, and loops until finish() is called.
+    // Returns the time from start to finish.
+    std::chrono::nanoseconds run(std::function<void ()> start, std::function<void (Message&)> onReply)
+    {
+        m_start = std::move(start);
+        m_onReply = std::move(onReply);
+        if (m_throughRing) {
+            m_output = MessageRing::create();
+            Message setup = Message::obtain(nullptr, SETUP_RING, 0, 0);
+            setup.replyTo = m_replyTo.get();
+            m_output->writeToBundle(setup.getData(), L"ring");
+            m_child->send(setup);
+        } else {
+            begin();
+        }
+        Looper::loop();
+        return m_finished - m_started;
+    }
+
+    void send(Message& message)
+    {
+        message.replyTo = m_replyTo.get();
+        if (m_throughRing)
+            m_output->send(message, m_child);
+        else
+            m_child->send(message);
+    }
+
+    void finish()
+    {
+        m_finished = benchmarkClock();
+        if (m_input)
+            m_input->close();
+        if (m_output)
+            m_output->close();
+        Looper::myLooper()->quit();
+    }
+
+private:
+    void begin()
+    {
+        m_started = benchmarkClock();
+        m_start();
+    }
+
+    void receive(Message& message)
+    {
+        if (message.what == SETUP_RING) {
+            m_input = MessageRing::open(message.getData(), L"ring");
+            m_input->receive(m_handler);
+            begin();
+            return;
+        }
+        m_onReply(message);
+    }
+
+    std::shared_ptr<Messenger> m_child;
+    std::shared_ptr<Handler> m_handler;
+    std::shared_ptr<Messenger> m_replyTo;
+    bool m_throughRing;
+    std::shared_ptr<MessageRing> m_output;
+    std::shared_ptr<MessageRing> m_input;
+    std::function<void ()> m_start;
+    std::function<void (Message&)> m_onReply;
+    std::chrono::nanoseconds m_started;
+    std::chrono::nanoseconds m_finished;
+};
+
+static std::string channelName(bool throughRing)
+{
+    return throughRing ? "ring" : "socket";
+}
+
+// One message in flight at a time, which is bound by the latency of waking up the other process.
+static void benchmarkPingPong(IBinder child, bool throughRing)
+{
+    Looper::prepare();
+    EchoClient client(child, throughRing);
+    size_t received = 0;
+
+    std::chrono::nanoseconds elapsed = client.run([&] {
+        Message ping = Message::obtain(nullptr, PING, 0, 0);
+        client.send(ping);
+    }, [&] (Message&) {
+        if (++received == roundTrips) {
+            client.finish();
+            return;
+        }
+        Message ping = Message::obtain(nullptr, PING, static_cast<int32_t>(received), 0);
+        client.send(ping);
+    });
+
+    reportBenchmark("ping-pong, " + channelName(throughRing), roundTrips, elapsed);
+}
+
+// Messages sent as fast as possible, which the ring delivers without a system call or a copy per message.
+static void benchmarkStream(IBinder child, bool throughRing, size_t payloadSize)
+{
+    Looper::prepare();
+    EchoClient client(child, throughRing);
+    int32_t streamed = 0;
+
+    std::chrono::nanoseconds elapsed = client.run([&] {
+        for (size_t i = 0; i < streamedMessages; ++i) {
+            Message message = Message::obtain(nullptr, STREAM, static_cast<int32_t>(i), 0);
+            if (payloadSize)
+                message.getData().putString(L"payload", String(payloadSize, L'p'));
+            client.send(message);
+        }
+        Message end = Message::obtain(nullptr, STREAM_END, 0, 0);
+        client.send(end);
+    }, [&] (Message& reply) {
+        streamed = reply.arg1;
+        client.finish();
+    });
+
+    if (static_cast<size_t>(streamed) != streamedMessages)
+        printf("stream lost messages: %d of %zu arrived\n", streamed, streamedMessages);
+    reportBenchmark("stream, " + channelName(throughRing) + ", payload=" + std::to_string(payloadSize), streamedMessages, elapsed);
+}
+
+int main()
+{
+    int32_t binderPipe[2];
+    if (::pipe(binderPipe))
+        return 1;
+
+    pid_t child = fork();
+    if (!child)
+        runEchoProcess(binderPipe[1]);
+
+    Looper::prepareMainLooper();
+    IBinder binder;
+    if (::read(binderPipe[0], &binder, sizeof(binder)) != sizeof(binder))
+        return 1;
+
+    for (bool throughRing : { false, true })
+        std::thread(benchmarkPingPong, binder, throughRing).join();
+    for (size_t payloadSize : { 0, 256 }) {
+        for (bool throughRing : { false, true })
+            std::thread(benchmarkStream, binder, throughRing, payloadSize).join();
+    }
+
+    Message quit = Message::obtain(nullptr, QUIT, 0, 0);
+    Messenger(binder).send(quit);
+    int32_t status;
+    waitpid(child, &status, 0);
+    return 0;
+}
@@ -0,0 +1,89 @@
+/*
+ * Copyright (C) 2016 Naver Corp. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "BenchmarkHelper.h"
+
+#include <android/os/Handler.h>
+#include <android/os/Looper.h>
+#include <android/os/SystemClock.h>
+
+#include <random>
+#include <vector>
+
+// Connection timeouts: each timer is armed, re-armed once as if its connection saw traffic, and
+// nine out of ten are cancelled before they fire. Expiry runs under virtual time, so that it
+// measures dispatching rather than waiting.
+static void benchmarkTimeouts(bool timingWheel, size_t timerCount)
+{
+    Looper::myLooper()->setTimingWheelEnabled(timingWheel);
+    std::shared_ptr<Handler> handler = Handler::create();
+    std::vector<Handler::Token> tokens(timerCount);
+    std::vector<std::chrono::nanoseconds> delays(timerCount);
+    std::mt19937 random(1);
+    for (auto& delay : delays)
+        delay = std::chrono::milliseconds(1000 + random() % 59000);
+    size_t fired = 0;
+
+    std::string suffix = std::string(timingWheel ? "wheel" : "heap") + ", timers=" + std::to_string(timerCount);
+
+    std::chrono::nanoseconds elapsed = measureBenchmark([&] {
+        for (size_t i = 0; i < timerCount; ++i)
+            tokens[i] = handler->postDelayed([&fired] { ++fired; }, delays[i]);
+    });
+    reportBenchmark("arm, " + suffix, timerCount, elapsed);
+
+    elapsed = measureBenchmark([&] {
+        for (size_t i = 0; i < timerCount; ++i) {
+            handler->removeCallbacks(tokens[i]);
+            tokens[i] = handler->postDelayed([&fired] { ++fired; }, delays[timerCount - i - 1]);
+        }
+    });
+    reportBenchmark("re-arm, " + suffix, timerCount, elapsed);
+
+    elapsed = measureBenchmark([&] {
+        for (size_t i = 0; i < timerCount; ++i) {
+            if (i % 10)
+                handler->removeCallbacks(tokens[i]);
+        }
+    });
+    reportBenchmark("cancel, " + suffix, timerCount - timerCount / 10, elapsed);
+
+    elapsed = measureBenchmark([&] {
+        Looper::myLooper()->runToEndOfTasks();
+    });
+    reportBenchmark("expire, " + suffix, fired, elapsed);
+}
+
+int main()
+{
+    SystemClock::setVirtualTimeEnabled(true);
+    Looper::prepareMainLooper();
+
+    for (size_t timerCount = 1000; timerCount <= 100000; timerCount *= 10) {
+        benchmarkTimeouts(false, timerCount);
+        benchmarkTimeouts(true, timerCount);
+    }
+    return 0;
+}
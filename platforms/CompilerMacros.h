@@ -55,6 +55,12 @@
 #error "Please use a newer version of Visual Studio. WebKit requires VS2013 or newer to compile."
 #endif
 
+/* COMPILER_SUPPORTS_CXX_COROUTINES - C++20 coroutines */
+
+#if defined(__cpp_impl_coroutine) && __cpp_impl_coroutine >= 201902L
+#define COMPILER_SUPPORTS_CXX_COROUTINES 1
+#endif
+
 /* FALLTHROUGH */
 
 #if !defined(FALLTHROUGH) && COMPILER_SUPPORTS(FALLTHROUGH_WARNINGS) && COMPILER(CLANG)
@@ -74,7 +74,7 @@ public:
 
 template<typename C, typename F, typename... P> inline typename FunctionTraits<F>::ResultType propagate(std::vector<C>& items, F function, P&&... arguments)
 {
-    FunctionResult<FunctionTraits<F>::ResultType> result;
+    FunctionResult<typename FunctionTraits<F>::ResultType> result;
     for (auto& item : items)
         if (result.call(item, function, arguments...))
             break;
@@ -83,7 +83,7 @@ template<typename C, typename F, typename... P> inline typename FunctionTraits<F
 
 template<typename C, typename F, typename... P> inline typename FunctionTraits<F>::ResultType propagate(std::vector<std::shared_ptr<C>>& items, F function, P&&... arguments)
 {
-    FunctionResult<FunctionTraits<F>::ResultType> result;
+    FunctionResult<typename FunctionTraits<F>::ResultType> result;
     for (auto& item : items)
         if (result.call(item.get(), function, arguments...))
             break;
@@ -92,7 +92,7 @@ template<typename C, typename F, typename... P> inline typename FunctionTraits<F
 
 template<typename C, typename F, typename... P> inline typename FunctionTraits<F>::ResultType propagate(std::vector<std::unique_ptr<C>>& items, F function, P&&... arguments)
 {
-    FunctionResult<FunctionTraits<F>::ResultType> result;
+    FunctionResult<typename FunctionTraits<F>::ResultType> result;
     for (auto& item : items)
         if (result.call(item.get(), function, arguments...))
             break;
@@ -27,6 +27,7 @@
 
 #include <cassert>
 #include <codecvt>
+#include <locale>
 #include <sstream>
 #include <string>
 #include <vector>
@@ -0,0 +1,86 @@
+/*
+ * Copyright (C) 2016 Naver Corp. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "AsyncBufferPool.h"
+
+#include <android/os/AsyncFile.h>
+
+#include <assert>
+
+namespace android {
+namespace os {
+
+static const size_t pageSize = 4096;
+
+AsyncBufferPool& AsyncBufferPool::shared()
+{
+    static AsyncBufferPool pool;
+    return pool;
+}
+
+AsyncBufferPool::AsyncBufferPool()
+    : m_storage(new uint8_t[bufferCount * AsyncBuffer::poolBufferSize + pageSize])
+{
+    uintptr_t address = reinterpret_cast<uintptr_t>(m_storage.get());
+    m_buffers = m_storage.get() + ((pageSize - address % pageSize) % pageSize);
+
+    // Buffers are handed out lowest index first, which keeps the working set small.
+    m_freeBuffers.reserve(bufferCount);
+    for (size_t index = bufferCount; index > 0; --index)
+        m_freeBuffers.push_back(static_cast<int32_t>(index - 1));
+}
+
+// Returns the index of a free buffer, or -1 if all of them are in use.
+int32_t AsyncBufferPool::obtain()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_freeBuffers.empty())
+        return -1;
+
+    int32_t index = m_freeBuffers.back();
+    m_freeBuffers.pop_back();
+    return index;
+}
+
+void AsyncBufferPool::recycle(int32_t index)
+{
+    assert(index >= 0 && static_cast<size_t>(index) < bufferCount);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_freeBuffers.push_back(index);
+}
+
+uint8_t* AsyncBufferPool::data(int32_t index) const
+{
+    return m_buffers + static_cast<size_t>(index) * AsyncBuffer::poolBufferSize;
+}
+
+size_t AsyncBufferPool::bufferSize() const
+{
+    return AsyncBuffer::poolBufferSize;
+}
+
+} // namespace os
+} // namespace android
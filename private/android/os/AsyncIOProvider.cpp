@@ -0,0 +1,93 @@
+/*
+ * Copyright (C) 2016 Naver Corp. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "AsyncIOProvider.h"
+
+#include <java/util/concurrent/ForkJoinPool.h>
+
+#include <assert>
+
+namespace android {
+namespace os {
+
+AsyncFileDescriptor::~AsyncFileDescriptor()
+{
+    AsyncIOProvider::close(m_fd);
+}
+
+// The provider lives as long as the process, since requests may still be in flight at exit.
+AsyncIOProvider& AsyncIOProvider::shared()
+{
+    static AsyncIOProvider* provider = create().release();
+    return *provider;
+}
+
+void AsyncIOProvider::complete(std::unique_ptr<AsyncIORequest> request, int32_t result)
+{
+    request->result = result;
+    // The descriptor of an opened file is owned right away, so that it is closed if the completion is never run.
+    if (request->operation == AsyncIORequest::Operation::Open && result >= 0)
+        request->descriptor = std::make_shared<AsyncFileDescriptor>(result);
+
+    std::shared_ptr<Handler> handler = request->handler;
+    std::shared_ptr<AsyncIORequest> completedRequest(std::move(request));
+    handler->post([completedRequest] {
+        completedRequest->completion(*completedRequest);
+    });
+}
+
+// Blocking file I/O mostly waits, so the pool has more threads than a pool for computations would.
+class AsyncIOProviderThreadPool final : public AsyncIOProvider {
+public:
+    static const int32_t threadCount = 4;
+
+    AsyncIOProviderThreadPool()
+        : m_pool(threadCount)
+    {
+    }
+
+    void submit(std::unique_ptr<AsyncIORequest> request) override
+    {
+        assert(request->handler);
+
+        std::shared_ptr<AsyncIORequest> pendingRequest(std::move(request));
+        m_pool.execute([pendingRequest] {
+            std::unique_ptr<AsyncIORequest> request(new AsyncIORequest(std::move(*pendingRequest)));
+            int32_t result = perform(*request);
+            complete(std::move(request), result);
+        });
+    }
+
+private:
+    java::util::concurrent::ForkJoinPool m_pool;
+};
+
+std::unique_ptr<AsyncIOProvider> AsyncIOProvider::createThreadPool()
+{
+    return std::unique_ptr<AsyncIOProvider>(new AsyncIOProviderThreadPool);
+}
+
+} // namespace os
+} // namespace android
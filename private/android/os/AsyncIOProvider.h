@@ -0,0 +1,106 @@
+/*
+ * Copyright (C) 2016 Naver Corp. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <android/os/AsyncFile.h>
+
+#include <string>
+
+namespace android {
+namespace os {
+
+// Owns the file descriptor of an AsyncFile, which its pending requests share,
+// so that it is only closed once none of them can use it anymore.
+class AsyncFileDescriptor {
+public:
+    explicit AsyncFileDescriptor(int32_t fd)
+        : m_fd(fd)
+    {
+    }
+    ~AsyncFileDescriptor();
+
+    int32_t fd() const { return m_fd; }
+
+private:
+    int32_t m_fd;
+};
+
+struct AsyncIORequest {
+    enum class Operation {
+        Open,
+        Read,
+        Write,
+        Fsync,
+    };
+
+    AsyncIORequest(Operation operation, std::shared_ptr<Handler> handler)
+        : operation(operation)
+        , offset(0)
+        , length(0)
+        , mode(0)
+        , result(0)
+        , handler(std::move(handler))
+    {
+    }
+
+    Operation operation;
+    std::shared_ptr<AsyncFileDescriptor> descriptor;
+    int64_t offset;
+    size_t length;
+    AsyncBuffer buffer;
+    // UTF-8
+    std::string path;
+    int32_t mode;
+    int32_t result;
+    std::shared_ptr<Handler> handler;
+    // Runs on the thread of handler once the request completed.
+    std::function<void (AsyncIORequest&)> completion;
+};
+
+// Performs the requests of AsyncFile, and posts their completion to the handler of each request.
+class AsyncIOProvider {
+public:
+    static AsyncIOProvider& shared();
+    virtual ~AsyncIOProvider() = default;
+
+    virtual void submit(std::unique_ptr<AsyncIORequest>) = 0;
+
+    // Performs a request synchronously, returning its result.
+    static int32_t perform(AsyncIORequest&);
+    static void close(int32_t fd);
+
+protected:
+    AsyncIOProvider() = default;
+
+    static std::unique_ptr<AsyncIOProvider> create();
+    // Performs requests on a pool of threads, for platforms without an asynchronous file I/O API.
+    static std::unique_ptr<AsyncIOProvider> createThreadPool();
+
+    static void complete(std::unique_ptr<AsyncIORequest>, int32_t result);
+};
+
+} // namespace os
+} // namespace android
@@ -0,0 +1,553 @@
+/*
+ * Copyright (C) 2016 Naver Corp. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "BundlePrivate.h"
+
+#include <platforms/LogHelper.h>
+#include <platforms/StringConversion.h>
+
+#include <algorithm>
+#include <wchar.h>
+
+#include <assert>
+
+namespace android {
+namespace os {
+
+// Everything in the arena starts at this alignment, which suits every element type.
+static const size_t arenaAlignment = 8;
+// The arena is compacted once this much of it is garbage, if that is at least half of it.
+static const size_t compactionThreshold = 4096;
+// Parcels nesting Bundles deeper than this are malformed.
+static const uint32_t maximumNestingDepth = 64;
+
+static size_t aligned(size_t size)
+{
+    return (size + arenaAlignment - 1) & ~(arenaAlignment - 1);
+}
+
+static int32_t compareKeys(const wchar_t* a, size_t aLength, const wchar_t* b, size_t bLength)
+{
+    if (int32_t result = wmemcmp(a, b, std::min(aLength, bLength)))
+        return result;
+    return (aLength == bLength) ? 0 : (aLength < bLength) ? -1 : 1;
+}
+
+static uint32_t appendTo(std::vector<uint8_t>& arena, const void* data, size_t size)
+{
+    size_t offset = arena.size();
+    assert(offset + size <= UINT32_MAX);
+    arena.resize(offset + aligned(size));
+    if (size)
+        memcpy(arena.data() + offset, data, size);
+    return static_cast<uint32_t>(offset);
+}
+
+// Parcel::readString16() cannot tell an empty string from the end of the parcel.
+static bool readString16(Parcel& parcel, String& value)
+{
+    size_t position = parcel.dataPosition();
+    size_t length;
+    if (!parcel.readString16Inplace(&length))
+        return false;
+
+    parcel.setDataPosition(position);
+    value = parcel.readString16();
+    return true;
+}
+
+std::shared_ptr<BundlePrivate> BundlePrivate::create()
+{
+    return std::shared_ptr<BundlePrivate>(new BundlePrivate);
+}
+
+BundlePrivate::BundlePrivate()
+    : m_garbage(0)
+{
+}
+
+BundlePrivate::BundlePrivate(const BundlePrivate& o)
+    : m_entries(o.m_entries)
+    , m_data(o.m_data)
+    , m_garbage(o.m_garbage)
+{
+    m_bundles.reserve(o.m_bundles.size());
+    for (auto& bundle : o.m_bundles)
+        m_bundles.push_back(bundle ? std::shared_ptr<BundlePrivate>(new BundlePrivate(*bundle)) : nullptr);
+}
+
+bool BundlePrivate::containsKey(const String& key) const
+{
+    auto it = lowerBound(key);
+    return it != m_entries.end() && !compareKeys(keyOf(*it), it->keyLength, key.data(), key.size());
+}
+
+void BundlePrivate::remove(const String& key)
+{
+    auto it = lowerBound(key);
+    if (it == m_entries.end() || compareKeys(keyOf(*it), it->keyLength, key.data(), key.size()))
+        return;
+
+    release(*it);
+    m_garbage += aligned(it->keyLength * sizeof(wchar_t));
+    m_entries.erase(it);
+}
+
+void BundlePrivate::clear()
+{
+    m_entries.clear();
+    m_data.clear();
+    m_bundles.clear();
+    m_garbage = 0;
+}
+
+std::vector<String> BundlePrivate::keySet() const
+{
+    std::vector<String> keys;
+    keys.reserve(m_entries.size());
+    for (auto& entry : m_entries)
+        keys.emplace_back(keyOf(entry), entry.keyLength);
+    return keys;
+}
+
+bool BundlePrivate::getString(const String& key, String& value) const
+{
+    const Entry* entry = find(key, Type::String);
+    if (!entry)
+        return false;
+
+    value.assign(reinterpret_cast<const wchar_t*>(valueOf(*entry)), entry->count);
+    return true;
+}
+
+void BundlePrivate::putString(const String& key, const String& value)
+{
+    putArray(key, Type::String, value.data(), value.size());
+}
+
+// String arrays are kept as the length of each string followed by its characters, back to back.
+bool BundlePrivate::getStringArray(const String& key, std::vector<String>& values) const
+{
+    const Entry* entry = find(key, Type::StringArray);
+    if (!entry)
+        return false;
+
+    values.clear();
+    values.reserve(entry->count);
+    const uint8_t* data = valueOf(*entry);
+    size_t position = 0;
+    for (uint32_t i = 0; i < entry->count && position + sizeof(uint32_t) <= entry->size; ++i) {
+        uint32_t length;
+        memcpy(&length, data + position, sizeof(length));
+        position += sizeof(length);
+        assert(position + length * sizeof(wchar_t) <= entry->size);
+        values.emplace_back(reinterpret_cast<const wchar_t*>(data + position), length);
+        position += length * sizeof(wchar_t);
+    }
+    return true;
+}
+
+void BundlePrivate::putStringArray(const String& key, const std::vector<String>& values)
+{
+    std::vector<uint8_t> data;
+    for (auto& value : values) {
+        uint32_t length = static_cast<uint32_t>(value.size());
+        const uint8_t* characters = reinterpret_cast<const uint8_t*>(value.data());
+        data.insert(data.end(), reinterpret_cast<const uint8_t*>(&length), reinterpret_cast<const uint8_t*>(&length + 1));
+        data.insert(data.end(), characters, characters + length * sizeof(wchar_t));
+    }
+
+    Entry& entry = insert(key, Type::StringArray);
+    entry.offset = append(data.data(), data.size());
+    entry.size = static_cast<uint32_t>(data.size());
+    entry.count = static_cast<uint32_t>(values.size());
+}
+
+std::shared_ptr<BundlePrivate> BundlePrivate::getBundle(const String& key) const
+{
+    const Entry* entry = find(key, Type::Bundle);
+    return entry ? m_bundles[entry->offset] : nullptr;
+}
+
+void BundlePrivate::putBundle(const String& key, const BundlePrivate& value)
+{
+    // Copied first, as value may be this Bundle itself.
+    std::shared_ptr<BundlePrivate> bundle(new BundlePrivate(value));
+    Entry& entry = insert(key, Type::Bundle);
+    entry.offset = static_cast<uint32_t>(m_bundles.size());
+    m_bundles.push_back(std::move(bundle));
+}
+
+const char* BundlePrivate::typeName(Type type)
+{
+    static const char* const names[] = {
+        "Boolean", "Integer", "Long", "Float", "Double", "String", "Bundle", "FileDescriptor",
+        "byte[]", "boolean[]", "int[]", "long[]", "float[]", "double[]", "String[]",
+    };
+    return names[static_cast<int32_t>(type)];
+}
+
+std::vector<BundlePrivate::Entry>::const_iterator BundlePrivate::lowerBound(const String& key) const
+{
+    return std::lower_bound(m_entries.begin(), m_entries.end(), key, [this](const Entry& entry, const String& key) {
+        return compareKeys(keyOf(entry), entry.keyLength, key.data(), key.size()) < 0;
+    });
+}
+
+const BundlePrivate::Entry* BundlePrivate::find(const String& key, Type type) const
+{
+    auto it = lowerBound(key);
+    if (it == m_entries.end() || compareKeys(keyOf(*it), it->keyLength, key.data(), key.size()))
+        return nullptr;
+
+    if (it->type != type) {
+        LOGW("Key %s expected %s but value was a %s", std::ws2s(key).c_str(), typeName(type), typeName(it->type));
+        return nullptr;
+    }
+    return &*it;
+}
+
+// Returns the entry of key, emptied for a value of type. Appending the value to the arena afterwards
+// keeps the entry valid, as the entries live apart from the arena.
+BundlePrivate::Entry& BundlePrivate::insert(const String& key, Type type)
+{
+    if (m_garbage >= compactionThreshold && m_garbage * 2 >= m_data.size())
+        compact();
+
+    auto it = lowerBound(key);
+    if (it != m_entries.end() && !compareKeys(keyOf(*it), it->keyLength, key.data(), key.size())) {
+        release(*it);
+        Entry& entry = m_entries[it - m_entries.begin()];
+        entry.type = type;
+        entry.offset = 0;
+        entry.size = 0;
+        entry.count = 0;
+        entry.value = 0;
+        return entry;
+    }
+
+    Entry entry = {};
+    entry.keyOffset = append(key.data(), key.size() * sizeof(wchar_t));
+    entry.keyLength = static_cast<uint32_t>(key.size());
+    entry.type = type;
+    return *m_entries.insert(it, entry);
+}
+
+void BundlePrivate::release(const Entry& entry)
+{
+    if (entry.type == Type::Bundle)
+        m_bundles[entry.offset].reset();
+    else
+        m_garbage += aligned(entry.size);
+}
+
+uint32_t BundlePrivate::append(const void* data, size_t size)
+{
+    return appendTo(m_data, data, size);
+}
+
+// Moves everything entries refer to into a new arena, in the order of their keys.
+void BundlePrivate::compact()
+{
+    std::vector<uint8_t> data;
+    data.reserve(m_data.size() - m_garbage);
+    std::vector<std::shared_ptr<BundlePrivate>> bundles;
+    for (auto& entry : m_entries) {
+        entry.keyOffset = appendTo(data, keyOf(entry), entry.keyLength * sizeof(wchar_t));
+        if (entry.type == Type::Bundle) {
+            bundles.push_back(std::move(m_bundles[entry.offset]));
+            entry.offset = static_cast<uint32_t>(bundles.size() - 1);
+        } else {
+            entry.offset = appendTo(data, valueOf(entry), entry.size);
+        }
+    }
+
+    m_data.swap(data);
+    m_bundles.swap(bundles);
+    m_garbage = 0;
+}
+
+// Each entry is written as its key, its type and its value. Strings are written as UTF-16, and arrays
+// as their length followed by their elements, so that the parcel does not depend on the size of wchar_t.
+void BundlePrivate::writeToParcel(Parcel& dest, int32_t flags)
+{
+    dest.writeInt32(static_cast<int32_t>(m_entries.size()));
+    for (auto& entry : m_entries) {
+        dest.writeString16(keyOf(entry), entry.keyLength);
+        dest.writeInt32(static_cast<int32_t>(entry.type));
+        switch (entry.type) {
+        case Type::Boolean:
+            dest.writeInt32(scalarOf<bool>(entry));
+            break;
+        case Type::Int:
+            dest.writeInt32(scalarOf<int32_t>(entry));
+            break;
+        case Type::Long:
+            dest.writeInt64(scalarOf<int64_t>(entry));
+            break;
+        case Type::Float:
+            dest.writeFloat(scalarOf<float>(entry));
+            break;
+        case Type::Double:
+            dest.writeDouble(scalarOf<double>(entry));
+            break;
+        case Type::FileDescriptor:
+            dest.writeFileDescriptor(scalarOf<int32_t>(entry));
+            break;
+        case Type::String:
+            dest.writeString16(reinterpret_cast<const wchar_t*>(valueOf(entry)), entry.count);
+            break;
+        case Type::StringArray: {
+            dest.writeInt32(static_cast<int32_t>(entry.count));
+            const uint8_t* data = valueOf(entry);
+            for (uint32_t i = 0, position = 0; i < entry.count; ++i) {
+                uint32_t length;
+                memcpy(&length, data + position, sizeof(length));
+                position += sizeof(length);
+                dest.writeString16(reinterpret_cast<const wchar_t*>(data + position), length);
+                position += length * static_cast<uint32_t>(sizeof(wchar_t));
+            }
+            break;
+        }
+        case Type::Bundle:
+            m_bundles[entry.offset]->writeToParcel(dest, flags);
+            break;
+        default:
+            dest.writeInt32(static_cast<int32_t>(entry.count));
+            dest.write(valueOf(entry), entry.size);
+            break;
+        }
+    }
+}
+
+void BundlePrivate::readFromParcel(Parcel& parcel)
+{
+    clear();
+    if (!readEntries(parcel, 0)) {
+        LOGE("Error at BundlePrivate::readFromParcel() - %s", "malformed parcel");
+        clear();
+    }
+}
+
+void BundlePrivate::fileDescriptors(const Bundle& bundle, std::vector<int32_t>& fds)
+{
+    if (bundle.m_private)
+        bundle.m_private->appendFileDescriptors(fds);
+}
+
+void BundlePrivate::appendFileDescriptors(std::vector<int32_t>& fds) const
+{
+    for (auto& entry : m_entries) {
+        if (entry.type == Type::FileDescriptor)
+            fds.push_back(scalarOf<int32_t>(entry));
+        else if (entry.type == Type::Bundle)
+            m_bundles[entry.offset]->appendFileDescriptors(fds);
+    }
+}
+
+size_t BundlePrivate::parcelCapacity(const Bundle& bundle)
+{
+    return bundle.m_private ? bundle.m_private->parcelCapacity() : 0;
+}
+
+// Follows writeToParcel(). Strings are counted as if every character took a surrogate pair,
+// which is exact where wchar_t is UTF-16, and spares encoding them twice elsewhere.
+static size_t parcelCapacityOfString(size_t length)
+{
+    size_t utf16Length = (sizeof(wchar_t) == sizeof(char16_t)) ? length : length * 2;
+    return sizeof(int32_t) + (((utf16Length + 1) * sizeof(char16_t) + 3) & ~static_cast<size_t>(3));
+}
+
+size_t BundlePrivate::parcelCapacity() const
+{
+    size_t capacity = sizeof(int32_t);
+    for (auto& entry : m_entries) {
+        capacity += parcelCapacityOfString(entry.keyLength) + sizeof(int32_t);
+        switch (entry.type) {
+        case Type::Boolean:
+        case Type::Int:
+        case Type::Float:
+        case Type::FileDescriptor:
+            capacity += sizeof(int32_t);
+            break;
+        case Type::Long:
+        case Type::Double:
+            capacity += sizeof(int64_t);
+            break;
+        case Type::String:
+            capacity += parcelCapacityOfString(entry.count);
+            break;
+        case Type::StringArray: {
+            capacity += sizeof(int32_t);
+            const uint8_t* data = valueOf(entry);
+            for (uint32_t i = 0, position = 0; i < entry.count; ++i) {
+                uint32_t length;
+                memcpy(&length, data + position, sizeof(length));
+                position += sizeof(length) + length * static_cast<uint32_t>(sizeof(wchar_t));
+                capacity += parcelCapacityOfString(length);
+            }
+            break;
+        }
+        case Type::Bundle:
+            capacity += m_bundles[entry.offset]->parcelCapacity();
+            break;
+        default:
+            capacity += sizeof(int32_t) + ((entry.size + 3) & ~static_cast<size_t>(3));
+            break;
+        }
+    }
+    return capacity;
+}
+
+bool BundlePrivate::readEntries(Parcel& parcel, uint32_t depth)
+{
+    int32_t count;
+    if (!parcel.read(&count, sizeof(count)) || count < 0)
+        return false;
+
+    m_entries.reserve(std::min<size_t>(count, parcel.dataAvail() / sizeof(int32_t)));
+    for (int32_t i = 0; i < count; ++i) {
+        if (!readEntry(parcel, depth))
+            return false;
+    }
+    return true;
+}
+
+bool BundlePrivate::readEntry(Parcel& parcel, uint32_t depth)
+{
+    String key;
+    int32_t type;
+    if (!readString16(parcel, key) || !parcel.read(&type, sizeof(type)))
+        return false;
+
+    size_t elementSize = 0;
+    switch (static_cast<Type>(type)) {
+    case Type::Boolean: {
+        int32_t value;
+        if (!parcel.read(&value, sizeof(value)))
+            return false;
+        putValue<bool>(key, Type::Boolean, value != 0);
+        return true;
+    }
+    case Type::Int: {
+        int32_t value;
+        if (!parcel.read(&value, sizeof(value)))
+            return false;
+        putValue(key, Type::Int, value);
+        return true;
+    }
+    case Type::Long: {
+        int64_t value;
+        if (!parcel.read(&value, sizeof(value)))
+            return false;
+        putValue(key, Type::Long, value);
+        return true;
+    }
+    case Type::Float: {
+        float value;
+        if (!parcel.read(&value, sizeof(value)))
+            return false;
+        putValue(key, Type::Float, value);
+        return true;
+    }
+    case Type::Double: {
+        double value;
+        if (!parcel.read(&value, sizeof(value)))
+            return false;
+        putValue(key, Type::Double, value);
+        return true;
+    }
+    case Type::FileDescriptor: {
+        if (parcel.dataAvail() < sizeof(int32_t))
+            return false;
+        int32_t fd = parcel.readFileDescriptor();
+        if (fd < 0)
+            return false;
+        putValue(key, Type::FileDescriptor, fd);
+        return true;
+    }
+    case Type::String: {
+        String value;
+        if (!readString16(parcel, value))
+            return false;
+        putString(key, value);
+        return true;
+    }
+    case Type::StringArray: {
+        int32_t count;
+        if (!parcel.read(&count, sizeof(count)) || count < 0 || static_cast<size_t>(count) > parcel.dataAvail() / sizeof(int32_t))
+            return false;
+        std::vector<String> values(count);
+        for (auto& value : values) {
+            if (!readString16(parcel, value))
+                return false;
+        }
+        putStringArray(key, values);
+        return true;
+    }
+    case Type::Bundle: {
+        if (depth >= maximumNestingDepth)
+            return false;
+        std::shared_ptr<BundlePrivate> bundle = create();
+        if (!bundle->readEntries(parcel, depth + 1))
+            return false;
+        Entry& entry = insert(key, Type::Bundle);
+        entry.offset = static_cast<uint32_t>(m_bundles.size());
+        m_bundles.push_back(std::move(bundle));
+        return true;
+    }
+    case Type::ByteArray:
+    case Type::BooleanArray:
+        elementSize = sizeof(uint8_t);
+        break;
+    case Type::IntArray:
+    case Type::FloatArray:
+        elementSize = sizeof(int32_t);
+        break;
+    case Type::LongArray:
+    case Type::DoubleArray:
+        elementSize = sizeof(int64_t);
+        break;
+    default:
+        return false;
+    }
+
+    int32_t count;
+    if (!parcel.read(&count, sizeof(count)) || count < 0 || static_cast<size_t>(count) > parcel.dataAvail() / elementSize)
+        return false;
+    size_t size = count * elementSize;
+    const void* data = parcel.readInplace(size);
+    if (!data)
+        return false;
+
+    Entry& entry = insert(key, static_cast<Type>(type));
+    entry.offset = append(data, size);
+    entry.size = static_cast<uint32_t>(size);
+    entry.count = static_cast<uint32_t>(count);
+    return true;
+}
+
+} // namespace os
+} // namespace android
@@ -27,23 +27,165 @@
 
 #include <android/os/Bundle.h>
 
+#include <string.h>
+
+namespace Json {
+class Value;
+}
+
 namespace android {
 namespace os {
 
 class Bundle;
 
-class BundlePrivate {
+// The contents of a Bundle, in a compact binary form. Entries are kept sorted by key in a flat array
+// of plain slots, which hold scalars in place and refer to their key, strings and arrays in a single
+// arena, so that a lookup is a binary search and neither reads nor writes convert any strings.
+class BundlePrivate final {
     friend class Bundle;
 public:
+    enum class Type : int32_t {
+        Boolean,
+        Int,
+        Long,
+        Float,
+        Double,
+        String,
+        Bundle,
+        FileDescriptor,
+        ByteArray,
+        BooleanArray,
+        IntArray,
+        LongArray,
+        FloatArray,
+        DoubleArray,
+        StringArray,
+    };
+
     static std::shared_ptr<BundlePrivate> create();
-    virtual ~BundlePrivate() = default;
+    BundlePrivate();
+    // Copies nested Bundles as well.
+    BundlePrivate(const BundlePrivate&);
+    ~BundlePrivate() = default;
+
+    size_t size() const { return m_entries.size(); }
+    bool containsKey(const String& key) const;
+    void remove(const String& key);
+    void clear();
+    std::vector<String> keySet() const;
+
+    // Scalars, which are Boolean, Int, Long, Float, Double and FileDescriptor.
+    template<typename T> T getValue(const String& key, Type type, T defaultValue) const;
+    template<typename T> void putValue(const String& key, Type type, T value);
+
+    // Arrays of scalars, and the characters of a String.
+    template<typename T> bool getArray(const String& key, Type type, std::vector<T>& values) const;
+    template<typename T> void putArray(const String& key, Type type, const T* values, size_t count);
+
+    bool getString(const String& key, String& value) const;
+    void putString(const String& key, const String& value);
+    bool getStringArray(const String& key, std::vector<String>& values) const;
+    void putStringArray(const String& key, const std::vector<String>& values);
+    std::shared_ptr<BundlePrivate> getBundle(const String& key) const;
+    void putBundle(const String& key, const BundlePrivate& value);
+
+    void writeToParcel(Parcel& dest, int32_t flags);
+    void readFromParcel(Parcel& parcel);
+
+    // Appends the file descriptors of bundle, including those of the Bundles nested in it, to fds.
+    static void fileDescriptors(const Bundle& bundle, std::vector<int32_t>& fds);
+    // Returns an upper bound of the bytes writeToParcel() writes for bundle, so that transports can
+    // size a shared buffer before parceling into it.
+    static size_t parcelCapacity(const Bundle& bundle);
+
+    // Returns the contents as JSON, for debugging.
+    String toString() const;
 
-    virtual CharSequence getCharSequence(const String& key) = 0;
-    virtual void putCharSequence(const String& key, const CharSequence& value) = 0;
+private:
+    struct Entry {
+        // The key, as wchar_t in the arena.
+        uint32_t keyOffset;
+        uint32_t keyLength;
+        Type type;
+        // Strings and arrays in the arena, or the index of a nested Bundle.
+        uint32_t offset;
+        uint32_t size;
+        uint32_t count;
+        // The bits of a scalar.
+        uint64_t value;
+    };
 
-    virtual void writeToParcel(Parcel& dest, int32_t flags) = 0;
-    virtual void readFromParcel(const Parcel& parcel) = 0;
+    static const char* typeName(Type);
+    template<typename T> static T scalarOf(const Entry&);
+
+    const wchar_t* keyOf(const Entry& entry) const { return reinterpret_cast<const wchar_t*>(m_data.data() + entry.keyOffset); }
+    const uint8_t* valueOf(const Entry& entry) const { return m_data.data() + entry.offset; }
+
+    std::vector<Entry>::const_iterator lowerBound(const String& key) const;
+    const Entry* find(const String& key, Type type) const;
+    Entry& insert(const String& key, Type type);
+    void release(const Entry&);
+    uint32_t append(const void* data, size_t size);
+    void compact();
+
+    void appendFileDescriptors(std::vector<int32_t>&) const;
+    size_t parcelCapacity() const;
+    // depth counts the Bundles this one is nested in, to bound the recursion over a malformed parcel.
+    bool readEntries(Parcel&, uint32_t depth);
+    bool readEntry(Parcel&, uint32_t depth);
+    void toJSON(Json::Value&) const;
+
+    std::vector<Entry> m_entries;
+    std::vector<uint8_t> m_data;
+    std::vector<std::shared_ptr<BundlePrivate>> m_bundles;
+    // Bytes of the arena no entry refers to anymore.
+    size_t m_garbage;
 };
 
+template<typename T>
+inline T BundlePrivate::scalarOf(const Entry& entry)
+{
+    T value;
+    memcpy(&value, &entry.value, sizeof(value));
+    return value;
+}
+
+template<typename T>
+inline T BundlePrivate::getValue(const String& key, Type type, T defaultValue) const
+{
+    static_assert(sizeof(T) <= sizeof(uint64_t), "Scalars are kept in the slot of their entry");
+    const Entry* entry = find(key, type);
+    return entry ? scalarOf<T>(*entry) : defaultValue;
+}
+
+template<typename T>
+inline void BundlePrivate::putValue(const String& key, Type type, T value)
+{
+    static_assert(sizeof(T) <= sizeof(uint64_t), "Scalars are kept in the slot of their entry");
+    Entry& entry = insert(key, type);
+    memcpy(&entry.value, &value, sizeof(value));
+}
+
+template<typename T>
+inline bool BundlePrivate::getArray(const String& key, Type type, std::vector<T>& values) const
+{
+    const Entry* entry = find(key, type);
+    if (!entry)
+        return false;
+
+    const T* begin = reinterpret_cast<const T*>(valueOf(*entry));
+    values.assign(begin, begin + entry->count);
+    return true;
+}
+
+template<typename T>
+inline void BundlePrivate::putArray(const String& key, Type type, const T* values, size_t count)
+{
+    Entry& entry = insert(key, type);
+    entry.offset = append(values, count * sizeof(T));
+    entry.size = static_cast<uint32_t>(count * sizeof(T));
+    entry.count = static_cast<uint32_t>(count);
+}
+
 } // namespace os
 } // namespace android
@@ -25,69 +25,98 @@
 
 #include "BundlePrivate.h"
 
-#include <platforms/LogHelper.h>
 #include <platforms/StringConversion.h>
 
 #include <json/json.h>
 
-#include <streambuf>
-
 namespace android {
 namespace os {
 
-class BundlePrivateJSON final : public BundlePrivate {
-public:
-    BundlePrivateJSON() = default;
-    ~BundlePrivateJSON() = default;
-
-    CharSequence getCharSequence(const String& key) override;
-    void putCharSequence(const String& key, const CharSequence& value) override;
-
-    void writeToParcel(Parcel& dest, int32_t flags) override;
-    void readFromParcel(const Parcel& parcel) override;
-
-private:
-    Json::Value m_root;
-};
-
-std::shared_ptr<BundlePrivate> BundlePrivate::create()
-{
-    return std::shared_ptr<BundlePrivate>(new BundlePrivateJSON);
-}
+// Bundles are only turned into JSON for debugging. File descriptors are shown as an object holding
+// the descriptor, which a string value can never be mistaken for.
+static const char* const fileDescriptorMember = "fd";
 
-CharSequence BundlePrivateJSON::getCharSequence(const String& key)
+template<typename T>
+static Json::Value arrayValue(const uint8_t* data, uint32_t count)
 {
-    return std::s2ws(m_root[std::ws2s(key)].asString());
-}
-
-void BundlePrivateJSON::putCharSequence(const String& key, const CharSequence& value)
-{
-    m_root[std::ws2s(key)] = std::ws2s(value);
+    Json::Value array(Json::arrayValue);
+    for (uint32_t i = 0; i < count; ++i) {
+        T value;
+        memcpy(&value, data + i * sizeof(T), sizeof(T));
+        array.append(value);
+    }
+    return array;
 }
 
-void BundlePrivateJSON::writeToParcel(Parcel& dest, int32_t flags)
+String BundlePrivate::toString() const
 {
+    Json::Value root;
+    toJSON(root);
     Json::StreamWriterBuilder builder;
-    std::string document = Json::writeString(builder, m_root);
-    dest.insert(dest.end(), document.data(), document.data() + document.size());
+    return std::s2ws(Json::writeString(builder, root));
 }
 
-struct vectorstreambuf : public std::streambuf {
-    vectorstreambuf(const std::vector<char>& v)
-    {
-        setg(const_cast<char*>(v.data()), const_cast<char*>(v.data()), const_cast<char*>(v.data()) + v.size());
-    }
-};
-
-void BundlePrivateJSON::readFromParcel(const Parcel& parcel)
+void BundlePrivate::toJSON(Json::Value& root) const
 {
-    Json::CharReaderBuilder builder;
-    vectorstreambuf streamBuffer(parcel);
-    std::istream stream(&streamBuffer);
-    std::string errors;
-    bool ok = Json::parseFromStream(builder, stream, &m_root, &errors);
-    if (!ok) {
-        LOGE("Error at BundlePrivateJSON::readFromParcel() - %s", errors.c_str());
+    root = Json::Value(Json::objectValue);
+    for (auto& entry : m_entries) {
+        Json::Value& value = root[std::ws2s(String(keyOf(entry), entry.keyLength))];
+        switch (entry.type) {
+        case Type::Boolean:
+            value = scalarOf<bool>(entry);
+            break;
+        case Type::Int:
+            value = scalarOf<int32_t>(entry);
+            break;
+        case Type::Long:
+            value = static_cast<Json::Int64>(scalarOf<int64_t>(entry));
+            break;
+        case Type::Float:
+            value = scalarOf<float>(entry);
+            break;
+        case Type::Double:
+            value = scalarOf<double>(entry);
+            break;
+        case Type::FileDescriptor:
+            value[fileDescriptorMember] = scalarOf<int32_t>(entry);
+            break;
+        case Type::String:
+            value = std::ws2s(String(reinterpret_cast<const wchar_t*>(valueOf(entry)), entry.count));
+            break;
+        case Type::Bundle:
+            m_bundles[entry.offset]->toJSON(value);
+            break;
+        case Type::ByteArray:
+            value = arrayValue<int8_t>(valueOf(entry), entry.count);
+            break;
+        case Type::BooleanArray:
+            value = arrayValue<bool>(valueOf(entry), entry.count);
+            break;
+        case Type::IntArray:
+            value = arrayValue<int32_t>(valueOf(entry), entry.count);
+            break;
+        case Type::LongArray:
+            value = arrayValue<Json::Int64>(valueOf(entry), entry.count);
+            break;
+        case Type::FloatArray:
+            value = arrayValue<float>(valueOf(entry), entry.count);
+            break;
+        case Type::DoubleArray:
+            value = arrayValue<double>(valueOf(entry), entry.count);
+            break;
+        case Type::StringArray: {
+            value = Json::Value(Json::arrayValue);
+            const uint8_t* data = valueOf(entry);
+            for (uint32_t i = 0, position = 0; i < entry.count; ++i) {
+                uint32_t length;
+                memcpy(&length, data + position, sizeof(length));
+                position += sizeof(length);
+                value.append(std::ws2s(String(reinterpret_cast<const wchar_t*>(data + position), length)));
+                position += length * static_cast<uint32_t>(sizeof(wchar_t));
+            }
+            break;
+        }
+        }
     }
 }
 
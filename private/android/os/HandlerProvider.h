@@ -38,29 +38,25 @@ public:
     static std::unique_ptr<HandlerProvider> create(Handler&);
     virtual ~HandlerProvider() = default;
 
-    virtual bool start() = 0;
-    virtual bool startAtTime(std::chrono::milliseconds) = 0;
-    virtual void stop() = 0;
-
 protected:
     HandlerProvider(Handler& c)
         : m_client(c)
     { }
 
-    void performMessages();
     void receivedMessage(Message&);
+    std::shared_ptr<MessageQueue> messageQueue() const;
 
     Handler& m_client;
 };
 
-inline void HandlerProvider::performMessages()
+inline void HandlerProvider::receivedMessage(Message& message)
 {
-    m_client.performMessages();
+    m_client.receivedMessage(message);
 }
 
-inline void HandlerProvider::receivedMessage(Message& message)
+inline std::shared_ptr<MessageQueue> HandlerProvider::messageQueue() const
 {
-    m_client.receivedMessage(message);
+    return m_client.m_queue;
 }
 
 } // namespace os
@@ -0,0 +1,77 @@
+/*
+ * Copyright (C) 2016 Naver Corp. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <android/os/MessageQueue.h>
+
+namespace android {
+namespace os {
+
+class LooperProvider {
+public:
+    static std::unique_ptr<LooperProvider> create(MessageQueue&);
+    virtual ~LooperProvider() = default;
+
+    virtual bool start() = 0;
+    virtual bool startAtTime(std::chrono::nanoseconds) = 0;
+    virtual void stop() = 0;
+
+    // Watches fd for the MessageQueue::OnFileDescriptorEventListener events, or changes the watched events of fd.
+    // A one shot file descriptor is not reported again until it is watched again. Returns false where the
+    // platform cannot watch file descriptors.
+    virtual bool watchFileDescriptor(int32_t fd, int32_t events, bool edgeTriggered, bool oneShot) { return false; }
+    virtual void unwatchFileDescriptor(int32_t fd) { }
+
+    static LooperProvider& from(MessageQueue&);
+
+protected:
+    LooperProvider(MessageQueue& c)
+        : m_client(c)
+    { }
+
+    void performMessages();
+    void performFileDescriptorEvents(int32_t fd, int32_t events);
+
+    MessageQueue& m_client;
+};
+
+inline LooperProvider& LooperProvider::from(MessageQueue& queue)
+{
+    return *queue.m_provider;
+}
+
+inline void LooperProvider::performMessages()
+{
+    m_client.performWorkItems();
+}
+
+inline void LooperProvider::performFileDescriptorEvents(int32_t fd, int32_t events)
+{
+    m_client.performFileDescriptorEvents(fd, events);
+}
+
+} // namespace os
+} // namespace android
@@ -0,0 +1,141 @@
+/*
+ * Copyright (C) 2016 Naver Corp. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "MessagePool.h"
+
+#include <atomic>
+#include <mutex>
+#include <new>
+
+#include <assert>
+
+namespace android {
+namespace os {
+
+struct PoolNode {
+    PoolNode* next;
+};
+
+static std::mutex poolSync;
+static PoolNode* pool;
+static size_t poolSize;
+static std::atomic<uint64_t> poolHits;
+static std::atomic<uint64_t> poolMisses;
+
+class ThreadCache {
+public:
+    ~ThreadCache()
+    {
+        // Nodes recycled after this point, e.g. from other thread_local destructors, bypass the cache.
+        m_destroyed = true;
+        while (m_nodes)
+            MessagePool::recycle(pop());
+    }
+
+    bool isEmpty() const { return !m_nodes; }
+    bool isFull() const { return m_destroyed || m_size == MessagePool::maxThreadCacheSize; }
+
+    void push(PoolNode* node)
+    {
+        node->next = m_nodes;
+        m_nodes = node;
+        ++m_size;
+    }
+    PoolNode* pop()
+    {
+        PoolNode* node = m_nodes;
+        m_nodes = node->next;
+        --m_size;
+        return node;
+    }
+
+private:
+    PoolNode* m_nodes { nullptr };
+    size_t m_size { 0 };
+    bool m_destroyed { false };
+};
+
+static thread_local ThreadCache threadCache;
+
+void* MessagePool::obtain(size_t size)
+{
+    assert(size <= nodeSize);
+
+    if (!threadCache.isEmpty()) {
+        poolHits.fetch_add(1, std::memory_order_relaxed);
+        return threadCache.pop();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(poolSync);
+        if (pool) {
+            PoolNode* node = pool;
+            pool = node->next;
+            --poolSize;
+            poolHits.fetch_add(1, std::memory_order_relaxed);
+            return node;
+        }
+    }
+
+    poolMisses.fetch_add(1, std::memory_order_relaxed);
+    return ::operator new(nodeSize);
+}
+
+void MessagePool::recycle(void* node)
+{
+    if (!node)
+        return;
+
+    PoolNode* poolNode = static_cast<PoolNode*>(node);
+    if (!threadCache.isFull()) {
+        threadCache.push(poolNode);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(poolSync);
+        if (poolSize < maxPoolSize) {
+            poolNode->next = pool;
+            pool = poolNode;
+            ++poolSize;
+            return;
+        }
+    }
+
+    ::operator delete(node);
+}
+
+uint64_t MessagePool::hitCount()
+{
+    return poolHits.load(std::memory_order_relaxed);
+}
+
+uint64_t MessagePool::missCount()
+{
+    return poolMisses.load(std::memory_order_relaxed);
+}
+
+} // namespace os
+} // namespace android
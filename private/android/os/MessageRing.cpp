@@ -0,0 +1,456 @@
+/*
+ * Copyright (C) 2016 Naver Corp. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "MessageRing.h"
+
+#include <android/os/Handler.h>
+#include <android/os/Looper.h>
+#include <android/os/MessageTarget.h>
+#include <android/os/Messenger.h>
+#include <platforms/LogHelper.h>
+
+#include <algorithm>
+#include <atomic>
+#include <new>
+#include <string.h>
+
+#include <assert>
+
+namespace android {
+namespace os {
+
+static_assert(ATOMIC_LLONG_LOCK_FREE == 2 && ATOMIC_INT_LOCK_FREE == 2, "Atomics in shared memory have to be lock-free");
+
+static const size_t cacheLineSize = 64;
+static const uint32_t frameAlignment = 8;
+// Fills the end of the ring when the next frame does not fit there, so that every frame is contiguous.
+static const uint32_t paddingFrame = 0xFFFFFFFF;
+// Takes the place of a message sent through the fallback Messenger.
+static const uint32_t fallbackFrame = 0xFFFFFFFE;
+
+// Positions only ever grow, and are masked with the capacity to find their offset in the ring.
+struct MessageRing::Control {
+    // Written by the consumer only.
+    std::atomic<uint64_t> head;
+    char headPadding[cacheLineSize - sizeof(std::atomic<uint64_t>)];
+    // Written by the producer only.
+    std::atomic<uint64_t> tail;
+    char tailPadding[cacheLineSize - sizeof(std::atomic<uint64_t>)];
+    std::atomic<uint32_t> consumerParked;
+    std::atomic<uint32_t> producerParked;
+    uint64_t capacity;
+};
+
+struct MessageRing::Frame {
+    uint32_t size;
+    uint32_t bundleSize;
+    int32_t what;
+    int32_t arg1;
+    int32_t arg2;
+    int32_t requestId;
+    int64_t obj;
+    uint64_t replyTo;
+};
+
+size_t MessageRing::dataOffset()
+{
+    return (sizeof(Control) + cacheLineSize - 1) & ~(cacheLineSize - 1);
+}
+
+uint32_t MessageRing::frameSize(size_t bundleSize)
+{
+    return static_cast<uint32_t>((sizeof(Frame) + bundleSize + frameAlignment - 1) & ~static_cast<size_t>(frameAlignment - 1));
+}
+
+std::shared_ptr<MessageRing> MessageRing::create(size_t capacity)
+{
+    size_t size = 4096;
+    while (size < capacity)
+        size <<= 1;
+
+    Memory memory;
+    if (!platformCreateMemory(dataOffset() + size, memory))
+        return nullptr;
+
+    int32_t consumerEvent = platformCreateEvent();
+    int32_t producerEvent = platformCreateEvent();
+    if (consumerEvent < 0 || producerEvent < 0) {
+        platformCloseEvent(consumerEvent);
+        platformCloseEvent(producerEvent);
+        platformUnmapMemory(memory);
+        return nullptr;
+    }
+
+    Control* control = new (memory.address) Control;
+    control->head.store(0, std::memory_order_relaxed);
+    control->tail.store(0, std::memory_order_relaxed);
+    // The consumer counts as parked until it starts receiving, so that it is woken for what was sent before.
+    control->consumerParked.store(1, std::memory_order_relaxed);
+    control->producerParked.store(0, std::memory_order_relaxed);
+    control->capacity = size;
+
+    return std::shared_ptr<MessageRing>(new MessageRing(memory, consumerEvent, producerEvent));
+}
+
+std::shared_ptr<MessageRing> MessageRing::open(Bundle& bundle, const String& key)
+{
+    int32_t memoryFd = bundle.getFileDescriptor(key + L".memory");
+    int32_t consumerEvent = bundle.getFileDescriptor(key + L".consumer");
+    int32_t producerEvent = bundle.getFileDescriptor(key + L".producer");
+
+    Memory memory = { memoryFd, nullptr, 0 };
+    if (memoryFd >= 0 && consumerEvent >= 0 && producerEvent >= 0 && platformMapMemory(memoryFd, memory)) {
+        const Control& control = *static_cast<const Control*>(memory.address);
+        size_t capacity = memory.size - dataOffset();
+        if (memory.size > dataOffset() && control.capacity == capacity && !(capacity & (capacity - 1)))
+            return std::shared_ptr<MessageRing>(new MessageRing(memory, consumerEvent, producerEvent));
+    }
+
+    platformUnmapMemory(memory);
+    platformCloseEvent(consumerEvent);
+    platformCloseEvent(producerEvent);
+    return nullptr;
+}
+
+MessageRing::MessageRing(const Memory& memory, int32_t consumerEvent, int32_t producerEvent)
+    : m_memory(memory)
+    , m_control(*static_cast<Control*>(memory.address))
+    , m_data(static_cast<char*>(memory.address) + dataOffset())
+    , m_capacity(memory.size - dataOffset())
+    , m_consumerEvent(consumerEvent)
+    , m_producerEvent(producerEvent)
+    , m_waiting(false)
+    , m_waitingForFallback(false)
+{
+}
+
+MessageRing::~MessageRing()
+{
+    platformCloseEvent(m_consumerEvent);
+    platformCloseEvent(m_producerEvent);
+    platformUnmapMemory(m_memory);
+}
+
+void MessageRing::writeToBundle(Bundle& bundle, const String& key)
+{
+    bundle.putFileDescriptor(key + L".memory", m_memory.fd);
+    bundle.putFileDescriptor(key + L".consumer", m_consumerEvent);
+    bundle.putFileDescriptor(key + L".producer", m_producerEvent);
+}
+
+void MessageRing::send(Message& message, const std::shared_ptr<Messenger>& fallback)
+{
+    std::lock_guard<std::mutex> lock(m_producerLock);
+    parcel(message);
+    bool fits = m_parcel.fileDescriptors().empty() && frameSize(m_parcel.dataSize()) <= m_capacity / 2;
+
+    // Messages still in the backlog go first, which keeps them in order.
+    if (m_backlog.empty() && write(message, !fits)) {
+        if (!fits)
+            fallback->send(message);
+        return;
+    }
+
+    PendingMessage pending;
+    pending.message = Message::obtain(message);
+    if (!fits) {
+        pending.fallback = fallback;
+        if (!m_parcel.fileDescriptors().empty()) {
+            // The Bundle is read back from its parcel, with descriptors of its own.
+            for (int32_t fd : m_parcel.fileDescriptors())
+                pending.fileDescriptors.push_back(platformDuplicateDescriptor(fd));
+            m_parcel.setFileDescriptors(pending.fileDescriptors);
+            m_parcel.setDataPosition(0);
+            Bundle bundle;
+            bundle.readFromParcel(m_parcel);
+            pending.message.setData(std::move(bundle));
+        }
+    }
+    m_backlog.push_back(std::move(pending));
+    waitForSpace();
+}
+
+// Parcels the Bundle of message right into the free space at the tail of the ring, where its frame goes,
+// and into a buffer of the parcel only if it does not fit there.
+void MessageRing::parcel(Message& message)
+{
+    m_parcel.freeData();
+    uint64_t tail = m_control.tail.load(std::memory_order_relaxed);
+    size_t offset = tail & (m_capacity - 1);
+    size_t room = std::min(m_capacity - offset, m_capacity - static_cast<size_t>(tail - m_control.head.load(std::memory_order_acquire)));
+    if (room > sizeof(Frame))
+        m_parcel.setDataBuffer(m_data + offset + sizeof(Frame), room - sizeof(Frame));
+
+    if (Bundle* bundle = message.peekData())
+        bundle->writeToParcel(m_parcel, 0);
+}
+
+bool MessageRing::write(Message& message, bool fallback)
+{
+    size_t bundleSize = fallback ? 0 : m_parcel.dataSize();
+    uint32_t size = frameSize(bundleSize);
+    uint64_t tail = m_control.tail.load(std::memory_order_relaxed);
+    size_t offset = tail & (m_capacity - 1);
+    size_t contiguous = m_capacity - offset;
+    size_t needed = (contiguous < size) ? contiguous + size : size;
+    // Sequentially consistent, as a parked producer has to see the room made before it parked.
+    if (m_capacity - (tail - m_control.head.load()) < needed)
+        return false;
+
+    if (contiguous < size) {
+        Frame& padding = *reinterpret_cast<Frame*>(m_data + offset);
+        padding.size = static_cast<uint32_t>(contiguous);
+        padding.bundleSize = paddingFrame;
+        tail += contiguous;
+        offset = 0;
+    }
+
+    Frame& frame = *reinterpret_cast<Frame*>(m_data + offset);
+    frame.size = size;
+    frame.bundleSize = fallback ? fallbackFrame : static_cast<uint32_t>(bundleSize);
+    frame.what = message.what;
+    frame.arg1 = message.arg1;
+    frame.arg2 = message.arg2;
+    frame.requestId = message.getRequestId();
+    frame.obj = message.obj;
+    frame.replyTo = message.replyTo ? reinterpret_cast<uint64_t>(message.replyTo->getBinder()) : 0;
+    if (bundleSize && m_parcel.data() != reinterpret_cast<uint8_t*>(&frame + 1))
+        memcpy(&frame + 1, m_parcel.data(), bundleSize);
+
+    // Publishing and checking for a parked consumer pairs with the consumer parking and checking for frames.
+    m_control.tail.store(tail + size);
+    if (m_control.consumerParked.load() && m_control.consumerParked.exchange(0))
+        platformSignalEvent(m_consumerEvent);
+    return true;
+}
+
+// Sequentially consistent, as a parked producer has to see the consumer take the last frame.
+void MessageRing::sendAround(PendingMessage& pending)
+{
+    pending.fallback->send(pending.message);
+    for (int32_t fd : pending.fileDescriptors)
+        platformCloseDescriptor(fd);
+    pending.fileDescriptors.clear();
+}
+
+// A message going around the ring waits until the consumer received every frame before it, as the consumer
+// hands frames to its Handler before taking them out of the ring.
+bool MessageRing::flush()
+{
+    while (!m_backlog.empty()) {
+        PendingMessage& pending = m_backlog.front();
+        if (!pending.fallback)
+            parcel(pending.message);
+        if (!write(pending.message, !!pending.fallback))
+            return false;
+        if (pending.fallback)
+            sendAround(pending);
+        m_backlog.pop_front();
+    }
+    return true;
+}
+
+void MessageRing::waitForSpace()
+{
+    m_control.producerParked.store(1);
+    // The consumer may have made room before it could see the producer parked.
+    if (flush()) {
+        m_control.producerParked.store(0);
+        return;
+    }
+
+    if (m_waiting)
+        return;
+
+    if (!m_producerHandler)
+        m_producerHandler = MessageTarget::outputHandler();
+    m_waiting = m_producerHandler->getLooper()->getQueue().addOnFileDescriptorEventListener(m_producerEvent,
+        MessageQueue::OnFileDescriptorEventListener::EVENT_INPUT, shared_from_this());
+}
+
+bool MessageRing::receive(std::shared_ptr<Handler> handler)
+{
+    assert(!m_consumerHandler);
+    m_consumerHandler = std::move(handler);
+    return m_consumerHandler->getLooper()->getQueue().addOnFileDescriptorEventListener(m_consumerEvent,
+        MessageQueue::OnFileDescriptorEventListener::EVENT_INPUT, shared_from_this());
+}
+
+void MessageRing::receiveFallback(Message& message)
+{
+    m_fallbackMessages.push_back(Message::obtain(message));
+    if (!m_waitingForFallback)
+        return;
+
+    m_waitingForFallback = false;
+    std::shared_ptr<Handler> handler = m_consumerHandler;
+    if (!drain())
+        handler->getLooper()->getQueue().removeOnFileDescriptorEventListener(m_consumerEvent);
+}
+
+void MessageRing::close()
+{
+    if (m_consumerHandler) {
+        m_consumerHandler->getLooper()->getQueue().removeOnFileDescriptorEventListener(m_consumerEvent);
+        m_consumerHandler = nullptr;
+    }
+    m_fallbackMessages.clear();
+    m_waitingForFallback = false;
+
+    std::lock_guard<std::mutex> lock(m_producerLock);
+    for (PendingMessage& pending : m_backlog) {
+        for (int32_t fd : pending.fileDescriptors)
+            platformCloseDescriptor(fd);
+    }
+    m_backlog.clear();
+    if (m_waiting) {
+        m_producerHandler->getLooper()->getQueue().removeOnFileDescriptorEventListener(m_producerEvent);
+        m_waiting = false;
+    }
+}
+
+int32_t MessageRing::onFileDescriptorEvents(int32_t fd, int32_t events)
+{
+    if (fd == m_consumerEvent) {
+        platformClearEvent(m_consumerEvent);
+        return drain();
+    }
+
+    std::lock_guard<std::mutex> lock(m_producerLock);
+    platformClearEvent(m_producerEvent);
+    if (!m_waiting)
+        return 0;
+
+    m_control.producerParked.store(1);
+    if (!flush())
+        return MessageQueue::OnFileDescriptorEventListener::EVENT_INPUT;
+
+    m_control.producerParked.store(0);
+    m_waiting = false;
+    return 0;
+}
+
+int32_t MessageRing::drain()
+{
+    uint64_t head = m_control.head.load(std::memory_order_relaxed);
+    while (true) {
+        uint64_t tail = m_control.tail.load(std::memory_order_acquire);
+        if (head != tail) {
+            while (head != tail) {
+                // The frame is checked from a copy of its header, since the peer may still change the ring.
+                Frame frame;
+                if (!readFrame(head, tail, frame)) {
+                    LOGE("Error at MessageRing::drain() - %s", "malformed frame, closing the ring");
+                    m_consumerHandler = nullptr;
+                    return 0;
+                }
+                if (frame.bundleSize == fallbackFrame) {
+                    // Wait here for the message itself, so that the frames after it are not delivered first.
+                    if (m_fallbackMessages.empty()) {
+                        m_waitingForFallback = true;
+                        break;
+                    }
+                    m_consumerHandler->sendMessage(m_fallbackMessages.front());
+                    m_fallbackMessages.pop_front();
+                } else if (frame.bundleSize != paddingFrame) {
+                    deliver(frame, m_data + (head & (m_capacity - 1)) + sizeof(Frame));
+                }
+                head += frame.size;
+                m_control.head.store(head, std::memory_order_release);
+            }
+
+            // Making room and checking for a parked producer pairs with the producer parking and checking for room.
+            m_control.head.store(head);
+            if (m_control.producerParked.load() && m_control.producerParked.exchange(0))
+                platformSignalEvent(m_producerEvent);
+        }
+
+        // Frames published meanwhile are drained once receiveFallback() got the message to wait for.
+        if (m_waitingForFallback)
+            return MessageQueue::OnFileDescriptorEventListener::EVENT_INPUT;
+
+        // Park, then look once more, so that a frame published meanwhile is not left without a wakeup.
+        m_control.consumerParked.store(1);
+        if (m_control.tail.load() == head)
+            return MessageQueue::OnFileDescriptorEventListener::EVENT_INPUT;
+        m_control.consumerParked.store(0, std::memory_order_relaxed);
+    }
+}
+
+// Copies the header of the frame at head, and returns false unless it lies within the published part of
+// the ring. A padding frame only has its size and bundleSize, and always fills the end of the ring.
+bool MessageRing::readFrame(uint64_t head, uint64_t tail, Frame& frame)
+{
+    uint64_t published = tail - head;
+    size_t offset = head & (m_capacity - 1);
+    size_t contiguous = m_capacity - offset;
+    if (published > m_capacity || offset % frameAlignment)
+        return false;
+
+    uint32_t sizes[2];
+    memcpy(sizes, m_data + offset, sizeof(sizes));
+    uint32_t size = sizes[0];
+    uint32_t bundleSize = sizes[1];
+    if (!size || size % frameAlignment || size > published || size > contiguous)
+        return false;
+
+    if (bundleSize == paddingFrame) {
+        frame.size = size;
+        frame.bundleSize = bundleSize;
+        return size == contiguous;
+    }
+
+    if (size < sizeof(Frame) || (bundleSize != fallbackFrame && bundleSize > size - sizeof(Frame)))
+        return false;
+    memcpy(&frame, m_data + offset, sizeof(Frame));
+    frame.size = size;
+    frame.bundleSize = bundleSize;
+    return true;
+}
+
+void MessageRing::deliver(const Frame& frame, const void* bundleData)
+{
+    Message message = Message::obtain(nullptr, frame.what, frame.arg1, frame.arg2, static_cast<intptr_t>(frame.obj));
+    message.setRequestId(frame.requestId);
+
+    if (frame.replyTo) {
+        std::unique_ptr<Messenger>& replyTo = m_replyTo[frame.replyTo];
+        if (!replyTo)
+            replyTo.reset(new Messenger(reinterpret_cast<IBinder>(frame.replyTo)));
+        message.replyTo = replyTo.get();
+    }
+
+    if (frame.bundleSize > 0) {
+        // Read in place, as the frame stays in the ring until the message is delivered.
+        Parcel parcel;
+        parcel.setDataReference(bundleData, frame.bundleSize);
+        message.getData().readFromParcel(parcel);
+    }
+
+    m_consumerHandler->sendMessage(message);
+}
+
+} // namespace os
+} // namespace android
@@ -0,0 +1,141 @@
+/*
+ * Copyright (C) 2016 Naver Corp. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <android/os/Message.h>
+#include <android/os/MessageQueue.h>
+
+#include <deque>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace android {
+namespace os {
+
+class Messenger;
+
+// A single producer, single consumer ring of messages in memory shared by two processes.
+// The producer writes each message in place and only wakes the consumer when it is parked,
+// so that a stream of messages costs neither a system call nor a copy per message.
+// Messages which do not fit into the ring right away wait in a backlog, which the output
+// thread of MessageTarget flushes once the consumer has made room.
+class MessageRing final : public MessageQueue::OnFileDescriptorEventListener, public std::enable_shared_from_this<MessageRing> {
+public:
+    static const size_t defaultCapacity = 1024 * 1024;
+
+    // Creates a ring in new shared memory. Returns nullptr where the platform does not support it.
+    static std::shared_ptr<MessageRing> create(size_t capacity = defaultCapacity);
+    // Maps the ring another process put into bundle with writeToBundle().
+    static std::shared_ptr<MessageRing> open(Bundle& bundle, const String& key);
+    ~MessageRing();
+
+    // Puts the descriptors of the ring into bundle, to be sent to the process on the other end.
+    void writeToBundle(Bundle& bundle, const String& key);
+
+    // Writes message into the ring without blocking. Messages which cannot go through the ring at all, which
+    // are larger than half of it or carry file descriptors, go through fallback instead, leaving a frame in
+    // their place so that the consumer still receives them in the order they were sent.
+    void send(Message& message, const std::shared_ptr<Messenger>& fallback);
+    // Delivers the messages of the ring to handler, on the thread of its Looper. The replyTo Messengers
+    // of received messages belong to the ring.
+    bool receive(std::shared_ptr<Handler> handler);
+    bool isReceiving() const { return !!m_consumerHandler; }
+    // Delivers a message which the producer sent through the fallback Messenger in its place among the
+    // messages of the ring. Called on the thread of the Looper receiving the ring.
+    void receiveFallback(Message& message);
+    // Stops sending and receiving, dropping the backlog.
+    void close();
+
+    int32_t onFileDescriptorEvents(int32_t fd, int32_t events) override;
+
+private:
+    struct Control;
+    struct Frame;
+
+    struct Memory {
+        int32_t fd;
+        void* address;
+        size_t size;
+    };
+
+    struct PendingMessage {
+        Message message;
+        // Set for a message which goes through the Messenger once its place is written into the ring.
+        std::shared_ptr<Messenger> fallback;
+        // Duplicates of the descriptors of message, as the caller may close its own once send() returned.
+        std::vector<int32_t> fileDescriptors;
+    };
+
+    MessageRing(const Memory&, int32_t consumerEvent, int32_t producerEvent);
+
+    static size_t dataOffset();
+    static uint32_t frameSize(size_t bundleSize);
+
+    void parcel(Message&);
+    bool write(Message&, bool fallback);
+    void sendAround(PendingMessage&);
+    bool flush();
+    void waitForSpace();
+    int32_t drain();
+    bool readFrame(uint64_t head, uint64_t tail, Frame&);
+    void deliver(const Frame&, const void* bundleData);
+
+    static bool platformCreateMemory(size_t size, Memory&);
+    static bool platformMapMemory(int32_t fd, Memory&);
+    static void platformUnmapMemory(Memory&);
+    static int32_t platformCreateEvent();
+    static void platformSignalEvent(int32_t event);
+    static void platformClearEvent(int32_t event);
+    static void platformCloseEvent(int32_t event);
+    static int32_t platformDuplicateDescriptor(int32_t fd);
+    static void platformCloseDescriptor(int32_t fd);
+
+    Memory m_memory;
+    Control& m_control;
+    char* m_data;
+    size_t m_capacity;
+    // Signalled by the producer when the consumer is parked.
+    int32_t m_consumerEvent;
+    // Signalled by the consumer when it made room for a parked producer.
+    int32_t m_producerEvent;
+
+    std::mutex m_producerLock;
+    // The Bundle of the message being written, in place if possible.
+    Parcel m_parcel;
+    std::deque<PendingMessage> m_backlog;
+    std::shared_ptr<Handler> m_producerHandler;
+    bool m_waiting;
+
+    std::shared_ptr<Handler> m_consumerHandler;
+    std::unordered_map<uint64_t, std::unique_ptr<Messenger>> m_replyTo;
+    // Messages sent through the fallback Messenger whose place in the ring has not been reached yet.
+    std::deque<Message> m_fallbackMessages;
+    bool m_waitingForFallback;
+};
+
+} // namespace os
+} // namespace android
@@ -26,6 +26,11 @@
 #include "MessageTarget.h"
 
 #include <android/os/Handler.h>
+#include <android/os/Looper.h>
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
 
 #include <assert>
 
@@ -69,5 +74,34 @@ std::unique_ptr<MessageTarget> MessageTarget::create(std::shared_ptr<Handler> ta
     return std::unique_ptr<MessageTarget>(new HandlerMessageTarget(target));
 }
 
+static std::shared_ptr<Handler>* startOutputThread()
+{
+    std::shared_ptr<Handler>* handler = new std::shared_ptr<Handler>;
+    std::mutex lock;
+    std::condition_variable started;
+
+    std::thread([handler, &lock, &started] {
+        Looper::prepare();
+        {
+            // Notified under the lock, since the caller returns as soon as it sees the Handler.
+            std::lock_guard<std::mutex> guard(lock);
+            *handler = Handler::create();
+            started.notify_one();
+        }
+        Looper::loop();
+    }).detach();
+
+    std::unique_lock<std::mutex> guard(lock);
+    while (!*handler)
+        started.wait(guard);
+    return handler;
+}
+
+std::shared_ptr<Handler> MessageTarget::outputHandler()
+{
+    static std::shared_ptr<Handler>* handler = startOutputThread();
+    return *handler;
+}
+
 } // namespace os
 } // namespace android
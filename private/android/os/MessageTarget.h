@@ -43,6 +43,10 @@ public:
 
     virtual IBinder handle() const = 0;
 
+    // Returns the Handler of a thread the transports own, which flushes messages that could not be sent
+    // right away. Unlike the thread of a sender, it always runs a Looper.
+    static std::shared_ptr<Handler> outputHandler();
+
 protected:
     MessageTarget() = default;
 
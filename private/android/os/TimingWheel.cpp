@@ -0,0 +1,206 @@
+/*
+ * Copyright (C) 2016 Naver Corp. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "TimingWheel.h"
+
+#include <algorithm>
+#include <limits>
+
+#if COMPILER(MSVC)
+#include <intrin.h>
+#endif
+
+#include <assert>
+
+namespace android {
+namespace os {
+
+// Ticks are 2^20ns, about a millisecond, so that converting fire times is a shift.
+static const size_t tickShift = 20;
+// Each level counts eight slots of the level below as one of its own.
+static const size_t levelShift = 3;
+
+static size_t countTrailingZeros(uint64_t value)
+{
+#if COMPILER(MSVC)
+    unsigned long index;
+    _BitScanForward64(&index, value);
+    return index;
+#else
+    return __builtin_ctzll(value);
+#endif
+}
+
+TimingWheel::TimingWheel(std::chrono::nanoseconds currentTime)
+    : m_currentTick(tickOf(currentTime))
+    , m_size(0)
+{
+    for (auto& level : m_levels)
+        level.pendingSlots = 0;
+}
+
+TimingWheel::~TimingWheel()
+{
+    for (auto& level : m_levels) {
+        for (auto& slot : level.slots) {
+            for (WorkItem* item : slot)
+                delete item;
+        }
+    }
+}
+
+int64_t TimingWheel::tickOf(std::chrono::nanoseconds time)
+{
+    return time.count() >> tickShift;
+}
+
+std::chrono::nanoseconds TimingWheel::timeOf(int64_t tick)
+{
+    return std::chrono::nanoseconds(tick << tickShift);
+}
+
+size_t TimingWheel::shiftOf(size_t level)
+{
+    return levelShift * (level + 1);
+}
+
+bool TimingWheel::insert(std::unique_ptr<WorkItem>& item)
+{
+    // Work due within the first slotCount ticks goes straight to the precise queue.
+    int64_t delta = tickOf(item->fireTime()) - m_currentTick;
+    if (delta < static_cast<int64_t>(slotCount))
+        return false;
+
+    // Pick the lowest level whose slots do not wrap around before the item is due. The slot
+    // of the current tick has expired already, so the item lands at least one slot ahead.
+    size_t level = 0;
+    while (level < levelCount - 1 && delta >= static_cast<int64_t>((slotCount - 1) << shiftOf(level)))
+        ++level;
+
+    // Items beyond the range of the top level wait in its farthest slot, and are placed again from there.
+    size_t shift = shiftOf(level);
+    delta = std::min<int64_t>(delta, static_cast<int64_t>((slotCount - 1) << shift));
+    size_t slot = static_cast<size_t>(((m_currentTick + delta) >> shift) & (slotCount - 1));
+
+    Slot& items = m_levels[level].slots[slot];
+    item->m_wheelLevel = static_cast<uint8_t>(level + 1);
+    item->m_wheelSlot = static_cast<uint8_t>(slot);
+    item->m_heapIndex = static_cast<uint32_t>(items.size());
+    items.push_back(item.release());
+    m_levels[level].pendingSlots |= 1ull << slot;
+    ++m_size;
+    return true;
+}
+
+std::unique_ptr<WorkItem> TimingWheel::remove(WorkItem& item)
+{
+    assert(item.m_wheelLevel);
+
+    Level& level = m_levels[item.m_wheelLevel - 1];
+    Slot& items = level.slots[item.m_wheelSlot];
+
+    // Slots are unordered, so the last item fills the hole.
+    WorkItem* last = items.back();
+    items[item.m_heapIndex] = last;
+    last->m_heapIndex = item.m_heapIndex;
+    items.pop_back();
+    if (items.empty())
+        level.pendingSlots &= ~(1ull << item.m_wheelSlot);
+
+    item.m_wheelLevel = 0;
+    item.m_heapIndex = 0;
+    --m_size;
+    return std::unique_ptr<WorkItem>(&item);
+}
+
+void TimingWheel::advance(std::chrono::nanoseconds currentTime, std::vector<std::unique_ptr<WorkItem>>& expiredItems)
+{
+    int64_t currentTick = tickOf(currentTime);
+    if (currentTick <= m_currentTick)
+        return;
+
+    for (size_t level = 0; level < levelCount; ++level) {
+        if (!m_levels[level].pendingSlots)
+            continue;
+
+        size_t shift = shiftOf(level);
+        int64_t first = (m_currentTick >> shift) + 1;
+        int64_t last = std::min<int64_t>(currentTick >> shift, first + slotCount - 1);
+        for (int64_t position = first; position <= last; ++position) {
+            size_t slot = static_cast<size_t>(position & (slotCount - 1));
+            if (m_levels[level].pendingSlots & (1ull << slot))
+                expireSlot(level, slot, expiredItems);
+        }
+    }
+
+    m_currentTick = currentTick;
+}
+
+std::chrono::nanoseconds TimingWheel::nextExpiryTime() const
+{
+    int64_t nextTick = std::numeric_limits<int64_t>::max();
+
+    for (size_t level = 0; level < levelCount; ++level) {
+        uint64_t pendingSlots = m_levels[level].pendingSlots;
+        if (!pendingSlots)
+            continue;
+
+        // Rotate the bitmap so that bit 0 stands for the slot after the current one.
+        size_t shift = shiftOf(level);
+        int64_t position = m_currentTick >> shift;
+        size_t rotation = static_cast<size_t>((position + 1) & (slotCount - 1));
+        uint64_t rotated = rotation ? (pendingSlots >> rotation) | (pendingSlots << (slotCount - rotation)) : pendingSlots;
+        int64_t expiryPosition = position + 1 + countTrailingZeros(rotated);
+        nextTick = std::min(nextTick, expiryPosition << shift);
+    }
+
+    return nextTick == std::numeric_limits<int64_t>::max() ? std::chrono::nanoseconds::max() : timeOf(nextTick);
+}
+
+void TimingWheel::collectItems(std::vector<WorkItem*>& items) const
+{
+    for (auto& level : m_levels) {
+        for (auto& slot : level.slots)
+            items.insert(items.end(), slot.begin(), slot.end());
+    }
+}
+
+void TimingWheel::expireSlot(size_t level, size_t slot, std::vector<std::unique_ptr<WorkItem>>& expiredItems)
+{
+    Slot& items = m_levels[level].slots[slot];
+    for (WorkItem* item : items) {
+        item->m_wheelLevel = 0;
+        item->m_heapIndex = 0;
+        expiredItems.push_back(std::unique_ptr<WorkItem>(item));
+    }
+
+    // Keep the capacity of the slot, so that the next items landing in it do not allocate.
+    m_size -= items.size();
+    items.clear();
+    m_levels[level].pendingSlots &= ~(1ull << slot);
+}
+
+} // namespace os
+} // namespace android
@@ -0,0 +1,85 @@
+/*
+ * Copyright (C) 2016 Naver Corp. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <android/os/WorkItem.h>
+
+#include <array>
+#include <vector>
+
+namespace android {
+namespace os {
+
+// A hierarchical timing wheel holding delayed work until it comes close to its fire time,
+// so that arming and cancelling the timeouts of many pending posts costs O(1).
+// Each level has slotCount slots, each spanning eight times as many ticks as the slots of
+// the level below. Slots round fire times down, so that items leave the wheel before they
+// are due and are then dispatched precisely by the heaps of the MessageQueue. Work due
+// within the horizon of the lowest level is not taken by the wheel at all.
+class TimingWheel {
+public:
+    static const size_t levelCount = 8;
+    static const size_t slotCount = 64;
+
+    explicit TimingWheel(std::chrono::nanoseconds currentTime);
+    ~TimingWheel();
+
+    bool isEmpty() const { return !m_size; }
+
+    // Takes the item unless it is due too soon to be worth holding in the wheel.
+    bool insert(std::unique_ptr<WorkItem>& item);
+    std::unique_ptr<WorkItem> remove(WorkItem&);
+
+    // Moves the items of all slots which expired until currentTime to expiredItems.
+    void advance(std::chrono::nanoseconds currentTime, std::vector<std::unique_ptr<WorkItem>>& expiredItems);
+    // Returns the time at which the next non-empty slot expires, or nanoseconds::max().
+    std::chrono::nanoseconds nextExpiryTime() const;
+
+    // Appends all items held by the wheel to items.
+    void collectItems(std::vector<WorkItem*>& items) const;
+
+private:
+    typedef std::vector<WorkItem*> Slot;
+
+    struct Level {
+        std::array<Slot, slotCount> slots;
+        // One bit for each non-empty slot.
+        uint64_t pendingSlots;
+    };
+
+    static int64_t tickOf(std::chrono::nanoseconds);
+    static std::chrono::nanoseconds timeOf(int64_t tick);
+    static size_t shiftOf(size_t level);
+
+    void expireSlot(size_t level, size_t slot, std::vector<std::unique_ptr<WorkItem>>& expiredItems);
+
+    std::array<Level, levelCount> m_levels;
+    int64_t m_currentTick;
+    size_t m_size;
+};
+
+} // namespace os
+} // namespace android
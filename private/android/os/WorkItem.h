@@ -0,0 +1,117 @@
+/*
+ * Copyright (C) 2016 Naver Corp. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <android/os/Handler.h>
+
+namespace android {
+namespace os {
+
+class WorkItem {
+    friend class MessageQueue;
+    friend class TimingWheel;
+public:
+    // Work items are indexed by owner, type and key, so that lookups by the what of a
+    // Message or by a plain function Runnable do not have to scan the queue.
+    enum Type : uint8_t {
+        MessageType,
+        RunnableType,
+        UnindexedType,
+    };
+
+    WorkItem(Handler& h, std::chrono::nanoseconds fireTime, Type type, intptr_t key, bool asynchronous)
+        : m_owner(h)
+        , m_fireTime(fireTime)
+        , m_sequence(0)
+        , m_heapIndex(0)
+        , m_wheelLevel(0)
+        , m_wheelSlot(0)
+        , m_priority(static_cast<uint8_t>(Handler::Priority::Normal))
+        , m_type(type)
+        , m_asynchronous(asynchronous)
+        , m_key(key)
+        , m_previousInIndex(nullptr)
+        , m_nextInIndex(nullptr)
+        , m_nextInInbox(nullptr)
+        , m_enqueueTime(std::chrono::nanoseconds::zero())
+    {
+    }
+    virtual ~WorkItem()
+    {
+    }
+
+    virtual void performWork() = 0;
+
+    // Identifies the posted code of runnables in dispatch records, nullptr for messages.
+    virtual const void* callback() const
+    {
+        return nullptr;
+    }
+
+    Handler& owner()
+    {
+        return m_owner;
+    }
+
+    std::chrono::nanoseconds fireTime() const
+    {
+        return m_fireTime;
+    }
+
+    // Work items are ordered by fire time, then by the order they were enqueued in.
+    bool isLaterThan(const WorkItem& other) const
+    {
+        if (m_fireTime != other.m_fireTime)
+            return m_fireTime > other.m_fireTime;
+        return m_sequence > other.m_sequence;
+    }
+
+protected:
+    Handler& m_owner;
+    std::chrono::nanoseconds m_fireTime;
+    uint64_t m_sequence;
+
+private:
+    // MessageQueue
+    // The position of the item in its heap, or in its timing wheel slot if it has a wheel level.
+    uint32_t m_heapIndex;
+    uint8_t m_wheelLevel;
+    uint8_t m_wheelSlot;
+    // The lane of the item, taken from its owner when it enters the queue.
+    uint8_t m_priority;
+    Type m_type;
+    // Asynchronous work is not held back by sync barriers.
+    bool m_asynchronous;
+    intptr_t m_key;
+    WorkItem* m_previousInIndex;
+    WorkItem* m_nextInIndex;
+    WorkItem* m_nextInInbox;
+    // Only recorded while the queue is instrumented.
+    std::chrono::nanoseconds m_enqueueTime;
+};
+
+} // namespace os
+} // namespace android
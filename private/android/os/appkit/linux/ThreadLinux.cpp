@@ -0,0 +1,193 @@
+/*
+ * Copyright (C) 2016 Naver Corp. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <android/os/appkit/Thread.h>
+
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <mutex>
+#include <unordered_map>
+
+namespace android {
+namespace os {
+namespace appkit {
+
+// Linux has no way to query the kernel thread id of another pthread, so threads record their own
+// the first time they ask for it, which threads started by Thread::start() do right away.
+class ThreadIdRecord {
+public:
+    ThreadIdRecord()
+        : m_handle(::pthread_self())
+        , m_tid(static_cast<int32_t>(::syscall(SYS_gettid)))
+    {
+        std::lock_guard<std::mutex> lock(recordsLock());
+        records()[m_handle] = m_tid;
+    }
+    ~ThreadIdRecord()
+    {
+        std::lock_guard<std::mutex> lock(recordsLock());
+        records().erase(m_handle);
+    }
+
+    int32_t tid() const { return m_tid; }
+
+    static uint32_t find(pthread_t handle)
+    {
+        std::lock_guard<std::mutex> lock(recordsLock());
+        auto it = records().find(handle);
+        return (it != records().end()) ? static_cast<uint32_t>(it->second) : 0;
+    }
+
+private:
+    static std::mutex& recordsLock()
+    {
+        static std::mutex* lock = new std::mutex;
+        return *lock;
+    }
+    static std::unordered_map<pthread_t, int32_t>& records()
+    {
+        static std::unordered_map<pthread_t, int32_t>* records = new std::unordered_map<pthread_t, int32_t>;
+        return *records;
+    }
+
+    pthread_t m_handle;
+    int32_t m_tid;
+};
+
+static const ThreadIdRecord& currentThreadIdRecord()
+{
+    static thread_local ThreadIdRecord record;
+    return record;
+}
+
+uint32_t Thread::getThreadId(std::thread::native_handle_type handle)
+{
+    if (::pthread_equal(handle, ::pthread_self()))
+        return static_cast<uint32_t>(currentThreadIdRecord().tid());
+
+    return ThreadIdRecord::find(handle);
+}
+
+int32_t Thread::myTid()
+{
+    return currentThreadIdRecord().tid();
+}
+
+// Linux threads have a nice level of their own, unlike what POSIX specifies for setpriority().
+bool Thread::setThreadPriority(int32_t tid, int32_t priority)
+{
+    return ::setpriority(PRIO_PROCESS, tid, priority) == 0;
+}
+
+int32_t Thread::getThreadPriority(int32_t tid)
+{
+    errno = 0;
+    int priority = ::getpriority(PRIO_PROCESS, tid);
+    return errno ? THREAD_PRIORITY_DEFAULT : priority;
+}
+
+// Children forked from a real-time thread fall back to normal scheduling.
+bool Thread::setThreadScheduler(int32_t tid, SchedulingPolicy policy, int32_t realtimePriority)
+{
+    struct sched_param param = {};
+    int nativePolicy = SCHED_OTHER;
+    switch (policy) {
+    case SchedulingPolicy::Normal:
+        break;
+    case SchedulingPolicy::Fifo:
+        nativePolicy = SCHED_FIFO | SCHED_RESET_ON_FORK;
+        param.sched_priority = realtimePriority;
+        break;
+    case SchedulingPolicy::RoundRobin:
+        nativePolicy = SCHED_RR | SCHED_RESET_ON_FORK;
+        param.sched_priority = realtimePriority;
+        break;
+    }
+
+    return ::sched_setscheduler(tid, nativePolicy, &param) == 0;
+}
+
+Thread::SchedulingPolicy Thread::getThreadScheduler(int32_t tid)
+{
+    switch (::sched_getscheduler(tid) & ~SCHED_RESET_ON_FORK) {
+    case SCHED_FIFO:
+        return SchedulingPolicy::Fifo;
+    case SCHED_RR:
+        return SchedulingPolicy::RoundRobin;
+    default:
+        return SchedulingPolicy::Normal;
+    }
+}
+
+bool Thread::setThreadAffinity(int32_t tid, uint64_t mask)
+{
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    for (int cpu = 0; cpu < 64; ++cpu) {
+        if (mask & (uint64_t(1) << cpu))
+            CPU_SET(cpu, &cpus);
+    }
+
+    return ::sched_setaffinity(tid, sizeof(cpus), &cpus) == 0;
+}
+
+uint64_t Thread::getThreadAffinity(int32_t tid)
+{
+    cpu_set_t cpus;
+    if (::sched_getaffinity(tid, sizeof(cpus), &cpus))
+        return 0;
+
+    uint64_t mask = 0;
+    for (int cpu = 0; cpu < 64; ++cpu) {
+        if (CPU_ISSET(cpu, &cpus))
+            mask |= uint64_t(1) << cpu;
+    }
+    return mask;
+}
+
+std::chrono::nanoseconds Thread::getThreadCpuTime(std::thread::native_handle_type handle)
+{
+    clockid_t clock;
+    struct timespec time;
+    if (::pthread_getcpuclockid(handle, &clock) || ::clock_gettime(clock, &time))
+        return std::chrono::nanoseconds::zero();
+
+    return std::chrono::seconds(time.tv_sec) + std::chrono::nanoseconds(time.tv_nsec);
+}
+
+void Thread::initializeWorkerThread()
+{
+    currentThreadIdRecord();
+}
+
+} // namespace appkit
+} // namespace os
+} // namespace android
@@ -25,17 +25,130 @@
 
 #include <android/os/appkit/Thread.h>
 
+#include <pthread.h>
 #include <windows.h>
 
 namespace android {
 namespace os {
 namespace appkit {
 
+pthread_main_np_t mainThreadIdentifier = 0;
+
 uint32_t Thread::getThreadId(std::thread::native_handle_type handle)
 {
     return ::GetThreadId(handle);
 }
 
+int32_t Thread::myTid()
+{
+    return static_cast<int32_t>(::GetCurrentThreadId());
+}
+
+// Windows has a handful of priority levels instead of nice levels, so priorities map onto the closest one.
+static int toWindowsPriority(int32_t priority)
+{
+    if (priority <= Thread::THREAD_PRIORITY_AUDIO)
+        return THREAD_PRIORITY_HIGHEST;
+    if (priority <= Thread::THREAD_PRIORITY_DISPLAY)
+        return THREAD_PRIORITY_ABOVE_NORMAL;
+    if (priority < Thread::THREAD_PRIORITY_BACKGROUND)
+        return THREAD_PRIORITY_NORMAL;
+    if (priority < Thread::THREAD_PRIORITY_LOWEST)
+        return THREAD_PRIORITY_BELOW_NORMAL;
+    return THREAD_PRIORITY_LOWEST;
+}
+
+static int32_t fromWindowsPriority(int priority)
+{
+    if (priority >= THREAD_PRIORITY_HIGHEST)
+        return Thread::THREAD_PRIORITY_AUDIO;
+    if (priority == THREAD_PRIORITY_ABOVE_NORMAL)
+        return Thread::THREAD_PRIORITY_DISPLAY;
+    if (priority == THREAD_PRIORITY_NORMAL)
+        return Thread::THREAD_PRIORITY_DEFAULT;
+    if (priority == THREAD_PRIORITY_BELOW_NORMAL)
+        return Thread::THREAD_PRIORITY_BACKGROUND;
+    return Thread::THREAD_PRIORITY_LOWEST;
+}
+
+class ThreadHandle {
+public:
+    ThreadHandle(int32_t tid, DWORD access)
+        : m_handle(::OpenThread(access, FALSE, static_cast<DWORD>(tid)))
+    {
+    }
+    ~ThreadHandle()
+    {
+        if (m_handle)
+            ::CloseHandle(m_handle);
+    }
+
+    operator HANDLE() const { return m_handle; }
+
+private:
+    HANDLE m_handle;
+};
+
+bool Thread::setThreadPriority(int32_t tid, int32_t priority)
+{
+    ThreadHandle thread(tid, THREAD_SET_INFORMATION);
+    return thread && ::SetThreadPriority(thread, toWindowsPriority(priority));
+}
+
+int32_t Thread::getThreadPriority(int32_t tid)
+{
+    ThreadHandle thread(tid, THREAD_QUERY_INFORMATION);
+    int priority = thread ? ::GetThreadPriority(thread) : THREAD_PRIORITY_ERROR_RETURN;
+    return priority == THREAD_PRIORITY_ERROR_RETURN ? THREAD_PRIORITY_DEFAULT : fromWindowsPriority(priority);
+}
+
+// Windows has no real-time policies for threads; both map to the time critical priority level.
+bool Thread::setThreadScheduler(int32_t tid, SchedulingPolicy policy, int32_t)
+{
+    ThreadHandle thread(tid, THREAD_SET_INFORMATION);
+    int priority = policy == SchedulingPolicy::Normal ? THREAD_PRIORITY_NORMAL : THREAD_PRIORITY_TIME_CRITICAL;
+    return thread && ::SetThreadPriority(thread, priority);
+}
+
+Thread::SchedulingPolicy Thread::getThreadScheduler(int32_t tid)
+{
+    ThreadHandle thread(tid, THREAD_QUERY_INFORMATION);
+    return thread && ::GetThreadPriority(thread) == THREAD_PRIORITY_TIME_CRITICAL ? SchedulingPolicy::Fifo : SchedulingPolicy::Normal;
+}
+
+bool Thread::setThreadAffinity(int32_t tid, uint64_t mask)
+{
+    ThreadHandle thread(tid, THREAD_SET_INFORMATION | THREAD_QUERY_INFORMATION);
+    return thread && ::SetThreadAffinityMask(thread, static_cast<DWORD_PTR>(mask));
+}
+
+// Windows can only read the affinity of a thread back by setting it, so the process mask is reported.
+uint64_t Thread::getThreadAffinity(int32_t)
+{
+    DWORD_PTR processMask;
+    DWORD_PTR systemMask;
+    if (!::GetProcessAffinityMask(::GetCurrentProcess(), &processMask, &systemMask))
+        return 0;
+    return processMask;
+}
+
+std::chrono::nanoseconds Thread::getThreadCpuTime(std::thread::native_handle_type handle)
+{
+    FILETIME creationTime, exitTime, kernelTime, userTime;
+    if (!::GetThreadTimes(handle, &creationTime, &exitTime, &kernelTime, &userTime))
+        return std::chrono::nanoseconds::zero();
+
+    // FILETIME counts 100ns intervals.
+    uint64_t kernel = (static_cast<uint64_t>(kernelTime.dwHighDateTime) << 32) | kernelTime.dwLowDateTime;
+    uint64_t user = (static_cast<uint64_t>(userTime.dwHighDateTime) << 32) | userTime.dwLowDateTime;
+    return std::chrono::nanoseconds((kernel + user) * 100);
+}
+
+void Thread::initializeWorkerThread()
+{
+    pthread_init_current_np(mainThreadIdentifier);
+}
+
 } // namespace appkit
 } // namespace os
 } // namespace android
@@ -0,0 +1,393 @@
+/*
+ * Copyright (C) 2016 Naver Corp. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <android/os/AsyncIOProvider.h>
+
+#include <android/os/AsyncBufferPool.h>
+
+#include <cstring>
+#include <deque>
+#include <errno.h>
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <mutex>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#include <assert>
+
+namespace android {
+namespace os {
+
+static int openFlags(int32_t mode)
+{
+    int flags = O_CLOEXEC;
+    if ((mode & AsyncFile::MODE_READ_WRITE) == AsyncFile::MODE_READ_WRITE)
+        flags |= O_RDWR;
+    else if (mode & AsyncFile::MODE_WRITE_ONLY)
+        flags |= O_WRONLY;
+    else
+        flags |= O_RDONLY;
+
+    if (mode & AsyncFile::MODE_CREATE)
+        flags |= O_CREAT;
+    if (mode & AsyncFile::MODE_TRUNCATE)
+        flags |= O_TRUNC;
+    if (mode & AsyncFile::MODE_APPEND)
+        flags |= O_APPEND;
+    return flags;
+}
+
+static const mode_t creationMode = 0666;
+
+template<typename Function>
+static int32_t retryOnInterrupt(Function function)
+{
+    ssize_t result;
+    do {
+        result = function();
+    } while (result < 0 && errno == EINTR);
+    return result < 0 ? -errno : static_cast<int32_t>(result);
+}
+
+int32_t AsyncIOProvider::perform(AsyncIORequest& request)
+{
+    switch (request.operation) {
+    case AsyncIORequest::Operation::Open:
+        return retryOnInterrupt([&] { return ::open(request.path.c_str(), openFlags(request.mode), creationMode); });
+    case AsyncIORequest::Operation::Read:
+        return retryOnInterrupt([&] { return ::pread(request.descriptor->fd(), request.buffer.data(), request.length, request.offset); });
+    case AsyncIORequest::Operation::Write:
+        return retryOnInterrupt([&] { return ::pwrite(request.descriptor->fd(), request.buffer.data(), request.length, request.offset); });
+    case AsyncIORequest::Operation::Fsync:
+        return retryOnInterrupt([&] { return ::fsync(request.descriptor->fd()); });
+    }
+    return -EINVAL;
+}
+
+void AsyncIOProvider::close(int32_t fd)
+{
+    ::close(fd);
+}
+
+// Submits requests to an io_uring through the raw system calls. A single thread waits for
+// completions and posts them to the handlers of the requests. The buffers of AsyncBufferPool
+// are registered with the ring, so that pooled reads and writes use the fixed buffer operations.
+class AsyncIOProviderLinux final : public AsyncIOProvider {
+public:
+    static const unsigned entryCount = 256;
+
+    AsyncIOProviderLinux();
+    ~AsyncIOProviderLinux();
+
+    bool isValid() const { return m_ringFd >= 0; }
+
+    void submit(std::unique_ptr<AsyncIORequest>) override;
+
+private:
+    bool supportsOperations();
+    bool mapRings(const struct io_uring_params&);
+    void registerBuffers();
+
+    void pushSubmission(AsyncIORequest*);
+    void prepareSubmission(struct io_uring_sqe&, AsyncIORequest&);
+    void enter(unsigned toSubmit, unsigned minComplete, unsigned flags);
+    void reapCompletions();
+
+    int m_ringFd;
+    void* m_submissionRing;
+    size_t m_submissionRingSize;
+    void* m_completionRing;
+    size_t m_completionRingSize;
+    struct io_uring_sqe* m_submissionEntries;
+    size_t m_submissionEntriesSize;
+
+    unsigned* m_submissionHead;
+    unsigned* m_submissionTail;
+    unsigned m_submissionMask;
+    unsigned* m_submissionArray;
+    unsigned* m_completionHead;
+    unsigned* m_completionTail;
+    unsigned m_completionMask;
+    struct io_uring_cqe* m_completionEntries;
+
+    bool m_fixedBuffers;
+
+    // Requests in flight are bounded by the ring size, so that the completion queue never overflows.
+    std::mutex m_submissionMutex;
+    unsigned m_inFlight;
+    std::deque<std::unique_ptr<AsyncIORequest>> m_backlog;
+    bool m_stopping;
+
+    std::thread m_completionThread;
+};
+
+AsyncIOProviderLinux::AsyncIOProviderLinux()
+    : m_ringFd(-1)
+    , m_submissionRing(MAP_FAILED)
+    , m_submissionRingSize(0)
+    , m_completionRing(MAP_FAILED)
+    , m_completionRingSize(0)
+    , m_submissionEntries(static_cast<struct io_uring_sqe*>(MAP_FAILED))
+    , m_submissionEntriesSize(0)
+    , m_fixedBuffers(false)
+    , m_inFlight(0)
+    , m_stopping(false)
+{
+    struct io_uring_params params = {};
+    int ringFd = static_cast<int>(::syscall(__NR_io_uring_setup, entryCount, &params));
+    if (ringFd < 0)
+        return;
+
+    m_ringFd = ringFd;
+    if (!supportsOperations() || !mapRings(params)) {
+        ::close(m_ringFd);
+        m_ringFd = -1;
+        return;
+    }
+
+    registerBuffers();
+
+    m_completionThread = std::thread([this] { reapCompletions(); });
+}
+
+AsyncIOProviderLinux::~AsyncIOProviderLinux()
+{
+    if (m_completionThread.joinable()) {
+        // A request without user data stops the completion thread.
+        {
+            std::lock_guard<std::mutex> lock(m_submissionMutex);
+            m_stopping = true;
+            pushSubmission(nullptr);
+        }
+        m_completionThread.join();
+    }
+
+    if (m_submissionEntries != MAP_FAILED)
+        ::munmap(m_submissionEntries, m_submissionEntriesSize);
+    if (m_completionRing != MAP_FAILED && m_completionRing != m_submissionRing)
+        ::munmap(m_completionRing, m_completionRingSize);
+    if (m_submissionRing != MAP_FAILED)
+        ::munmap(m_submissionRing, m_submissionRingSize);
+    if (m_ringFd >= 0)
+        ::close(m_ringFd);
+}
+
+// Rings of kernels before 5.6 accept neither the probe nor the operations of AsyncIORequest.
+bool AsyncIOProviderLinux::supportsOperations()
+{
+    static const uint8_t requiredOperations[] = { IORING_OP_OPENAT, IORING_OP_READ, IORING_OP_WRITE, IORING_OP_FSYNC };
+    static const unsigned probedOperationCount = 256;
+
+    std::vector<uint8_t> buffer(sizeof(struct io_uring_probe) + probedOperationCount * sizeof(struct io_uring_probe_op));
+    struct io_uring_probe* probe = reinterpret_cast<struct io_uring_probe*>(buffer.data());
+    if (::syscall(__NR_io_uring_register, m_ringFd, IORING_REGISTER_PROBE, probe, probedOperationCount) < 0)
+        return false;
+
+    for (uint8_t operation : requiredOperations) {
+        if (operation > probe->last_op || !(probe->ops[operation].flags & IO_URING_OP_SUPPORTED))
+            return false;
+    }
+    return true;
+}
+
+bool AsyncIOProviderLinux::mapRings(const struct io_uring_params& params)
+{
+    m_submissionRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    m_completionRingSize = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    // Recent kernels map both rings with a single mmap.
+    if (params.features & IORING_FEAT_SINGLE_MMAP)
+        m_submissionRingSize = m_completionRingSize = std::max(m_submissionRingSize, m_completionRingSize);
+
+    m_submissionRing = ::mmap(nullptr, m_submissionRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_ringFd, IORING_OFF_SQ_RING);
+    if (m_submissionRing == MAP_FAILED)
+        return false;
+
+    if (params.features & IORING_FEAT_SINGLE_MMAP)
+        m_completionRing = m_submissionRing;
+    else
+        m_completionRing = ::mmap(nullptr, m_completionRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_ringFd, IORING_OFF_CQ_RING);
+    if (m_completionRing == MAP_FAILED)
+        return false;
+
+    m_submissionEntriesSize = params.sq_entries * sizeof(struct io_uring_sqe);
+    m_submissionEntries = static_cast<struct io_uring_sqe*>(::mmap(nullptr, m_submissionEntriesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_ringFd, IORING_OFF_SQES));
+    if (m_submissionEntries == MAP_FAILED)
+        return false;
+
+    uint8_t* submissionRing = static_cast<uint8_t*>(m_submissionRing);
+    m_submissionHead = reinterpret_cast<unsigned*>(submissionRing + params.sq_off.head);
+    m_submissionTail = reinterpret_cast<unsigned*>(submissionRing + params.sq_off.tail);
+    m_submissionMask = *reinterpret_cast<unsigned*>(submissionRing + params.sq_off.ring_mask);
+    m_submissionArray = reinterpret_cast<unsigned*>(submissionRing + params.sq_off.array);
+
+    uint8_t* completionRing = static_cast<uint8_t*>(m_completionRing);
+    m_completionHead = reinterpret_cast<unsigned*>(completionRing + params.cq_off.head);
+    m_completionTail = reinterpret_cast<unsigned*>(completionRing + params.cq_off.tail);
+    m_completionMask = *reinterpret_cast<unsigned*>(completionRing + params.cq_off.ring_mask);
+    m_completionEntries = reinterpret_cast<struct io_uring_cqe*>(completionRing + params.cq_off.cqes);
+    return true;
+}
+
+// Registration pins the pool, which can exceed RLIMIT_MEMLOCK; pooled buffers then use the plain operations.
+void AsyncIOProviderLinux::registerBuffers()
+{
+    AsyncBufferPool& pool = AsyncBufferPool::shared();
+    std::vector<struct iovec> buffers(AsyncBufferPool::bufferCount);
+    for (size_t index = 0; index < buffers.size(); ++index) {
+        buffers[index].iov_base = pool.data(static_cast<int32_t>(index));
+        buffers[index].iov_len = pool.bufferSize();
+    }
+
+    m_fixedBuffers = !::syscall(__NR_io_uring_register, m_ringFd, IORING_REGISTER_BUFFERS, buffers.data(), buffers.size());
+}
+
+void AsyncIOProviderLinux::submit(std::unique_ptr<AsyncIORequest> request)
+{
+    assert(request->handler);
+
+    std::lock_guard<std::mutex> lock(m_submissionMutex);
+    if (m_inFlight >= entryCount) {
+        m_backlog.push_back(std::move(request));
+        return;
+    }
+
+    pushSubmission(request.release());
+}
+
+// Must be called with the submission mutex held.
+void AsyncIOProviderLinux::pushSubmission(AsyncIORequest* request)
+{
+    unsigned tail = *m_submissionTail;
+    unsigned index = tail & m_submissionMask;
+    struct io_uring_sqe& entry = m_submissionEntries[index];
+    ::memset(&entry, 0, sizeof(entry));
+    if (request)
+        prepareSubmission(entry, *request);
+    else
+        entry.opcode = IORING_OP_NOP;
+    entry.user_data = reinterpret_cast<uint64_t>(request);
+
+    m_submissionArray[index] = index;
+    __atomic_store_n(m_submissionTail, tail + 1, __ATOMIC_RELEASE);
+    ++m_inFlight;
+
+    enter(1, 0, 0);
+}
+
+void AsyncIOProviderLinux::prepareSubmission(struct io_uring_sqe& entry, AsyncIORequest& request)
+{
+    bool fixedBuffer = m_fixedBuffers && request.buffer.poolIndex() >= 0;
+
+    switch (request.operation) {
+    case AsyncIORequest::Operation::Open:
+        entry.opcode = IORING_OP_OPENAT;
+        entry.fd = AT_FDCWD;
+        entry.addr = reinterpret_cast<uint64_t>(request.path.c_str());
+        entry.open_flags = openFlags(request.mode);
+        entry.len = creationMode;
+        break;
+    case AsyncIORequest::Operation::Read:
+    case AsyncIORequest::Operation::Write:
+        if (request.operation == AsyncIORequest::Operation::Read)
+            entry.opcode = fixedBuffer ? IORING_OP_READ_FIXED : IORING_OP_READ;
+        else
+            entry.opcode = fixedBuffer ? IORING_OP_WRITE_FIXED : IORING_OP_WRITE;
+        entry.fd = request.descriptor->fd();
+        entry.addr = reinterpret_cast<uint64_t>(request.buffer.data());
+        entry.len = static_cast<uint32_t>(request.length);
+        entry.off = static_cast<uint64_t>(request.offset);
+        if (fixedBuffer)
+            entry.buf_index = static_cast<uint16_t>(request.buffer.poolIndex());
+        break;
+    case AsyncIORequest::Operation::Fsync:
+        entry.opcode = IORING_OP_FSYNC;
+        entry.fd = request.descriptor->fd();
+        break;
+    }
+}
+
+void AsyncIOProviderLinux::enter(unsigned toSubmit, unsigned minComplete, unsigned flags)
+{
+    while (::syscall(__NR_io_uring_enter, m_ringFd, toSubmit, minComplete, flags, nullptr, 0) < 0) {
+        if (errno != EINTR)
+            break;
+    }
+}
+
+void AsyncIOProviderLinux::reapCompletions()
+{
+    std::vector<std::pair<AsyncIORequest*, int32_t>> completions;
+
+    while (true) {
+        enter(0, 1, IORING_ENTER_GETEVENTS);
+
+        bool stopped = false;
+        unsigned head = *m_completionHead;
+        unsigned tail = __atomic_load_n(m_completionTail, __ATOMIC_ACQUIRE);
+        for (; head != tail; ++head) {
+            struct io_uring_cqe& entry = m_completionEntries[head & m_completionMask];
+            AsyncIORequest* request = reinterpret_cast<AsyncIORequest*>(entry.user_data);
+            if (request)
+                completions.emplace_back(request, entry.res);
+            else
+                stopped = true;
+        }
+        __atomic_store_n(m_completionHead, head, __ATOMIC_RELEASE);
+
+        {
+            std::lock_guard<std::mutex> lock(m_submissionMutex);
+            m_inFlight -= completions.size() + (stopped ? 1 : 0);
+            while (!m_backlog.empty() && m_inFlight < entryCount && !m_stopping) {
+                pushSubmission(m_backlog.front().release());
+                m_backlog.pop_front();
+            }
+        }
+
+        for (auto& completion : completions)
+            complete(std::unique_ptr<AsyncIORequest>(completion.first), completion.second);
+        completions.clear();
+
+        if (stopped)
+            break;
+    }
+}
+
+// Kernels without io_uring or without its file operations, or sandboxes which forbid it, fall back to the thread pool.
+std::unique_ptr<AsyncIOProvider> AsyncIOProvider::create()
+{
+    std::unique_ptr<AsyncIOProviderLinux> provider(new AsyncIOProviderLinux);
+    if (provider->isValid())
+        return provider;
+
+    return createThreadPool();
+}
+
+} // namespace os
+} // namespace android
@@ -0,0 +1,247 @@
+/*
+ * Copyright (C) 2016 Naver Corp. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "HandlerProviderLinux.h"
+
+#include "MessagePacket.h"
+#include <android/os/MessageQueue.h>
+#include <platforms/LogHelper.h>
+
+#include <algorithm>
+#include <atomic>
+#include <unordered_map>
+
+#include <assert>
+
+namespace android {
+namespace os {
+
+// Accepts connections on the abstract socket of a Handler and receives the messages sent over them
+// on the thread of its Looper, without ever blocking it.
+class MessageEndpoint final : public MessageQueue::OnFileDescriptorEventListener, public std::enable_shared_from_this<MessageEndpoint> {
+public:
+    static std::shared_ptr<MessageEndpoint> listen(IBinder, std::shared_ptr<MessageQueue>);
+    ~MessageEndpoint();
+
+    void close();
+
+    int32_t onFileDescriptorEvents(int32_t fd, int32_t events) override;
+
+private:
+    MessageEndpoint(IBinder, std::shared_ptr<MessageQueue>, int32_t socket);
+
+    void accept();
+    bool receive(int32_t connection);
+
+    std::mutex m_lock;
+    IBinder m_binder;
+    std::shared_ptr<MessageQueue> m_queue;
+    int32_t m_socket;
+    std::vector<int32_t> m_connections;
+    MessagePacket::Messengers m_replyTo;
+};
+
+static std::mutex& endpointsLock()
+{
+    static std::mutex* lock = new std::mutex;
+    return *lock;
+}
+
+// Handlers of this process by the serial number of their binder.
+static std::unordered_map<uint32_t, HandlerProviderLinux*>& endpoints()
+{
+    static std::unordered_map<uint32_t, HandlerProviderLinux*>* endpoints = new std::unordered_map<uint32_t, HandlerProviderLinux*>;
+    return *endpoints;
+}
+
+static std::atomic<uint32_t> nextEndpointSerial(1);
+
+std::unique_ptr<HandlerProvider> HandlerProvider::create(Handler& client)
+{
+    return std::unique_ptr<HandlerProvider>(new HandlerProviderLinux(client));
+}
+
+HandlerProviderLinux::HandlerProviderLinux(Handler& client)
+    : HandlerProvider(client)
+    , m_binder(nullptr)
+{
+}
+
+HandlerProviderLinux::~HandlerProviderLinux()
+{
+    if (!m_binder)
+        return;
+
+    {
+        std::lock_guard<std::mutex> lock(endpointsLock());
+        endpoints().erase(MessagePacket::serialOf(m_binder));
+    }
+
+    if (m_endpoint)
+        m_endpoint->close();
+}
+
+IBinder HandlerProviderLinux::endpointHandle(HandlerProvider& provider)
+{
+    HandlerProviderLinux& self = static_cast<HandlerProviderLinux&>(provider);
+    std::lock_guard<std::mutex> lock(self.m_lock);
+    if (self.m_binder)
+        return self.m_binder;
+
+    self.m_binder = MessagePacket::binder(::getpid(), nextEndpointSerial++);
+    {
+        std::lock_guard<std::mutex> lock(endpointsLock());
+        endpoints()[MessagePacket::serialOf(self.m_binder)] = &self;
+    }
+
+    // Messengers of this process still reach the Handler if it cannot listen.
+    self.m_endpoint = MessageEndpoint::listen(self.m_binder, self.messageQueue());
+    if (!self.m_endpoint)
+        LOGW("Handler %u is not reachable from other processes, errno %d", MessagePacket::serialOf(self.m_binder), errno);
+
+    return self.m_binder;
+}
+
+bool HandlerProviderLinux::sendToEndpoint(IBinder binder, Message& message)
+{
+    assert(MessagePacket::processOf(binder) == ::getpid());
+
+    std::lock_guard<std::mutex> lock(endpointsLock());
+    auto it = endpoints().find(MessagePacket::serialOf(binder));
+    if (it == endpoints().end())
+        return false;
+
+    it->second->receivedMessage(message);
+    return true;
+}
+
+std::shared_ptr<MessageEndpoint> MessageEndpoint::listen(IBinder binder, std::shared_ptr<MessageQueue> queue)
+{
+    int32_t socket = ::socket(AF_UNIX, SOCK_SEQPACKET | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (socket < 0)
+        return nullptr;
+
+    struct sockaddr_un address;
+    socklen_t length = MessagePacket::address(binder, address);
+    if (::bind(socket, reinterpret_cast<struct sockaddr*>(&address), length) || ::listen(socket, SOMAXCONN)) {
+        ::close(socket);
+        return nullptr;
+    }
+
+    std::shared_ptr<MessageEndpoint> endpoint(new MessageEndpoint(binder, std::move(queue), socket));
+    if (!endpoint->m_queue->addOnFileDescriptorEventListener(socket, MessageQueue::OnFileDescriptorEventListener::EVENT_INPUT, endpoint)) {
+        endpoint->close();
+        return nullptr;
+    }
+    return endpoint;
+}
+
+MessageEndpoint::MessageEndpoint(IBinder binder, std::shared_ptr<MessageQueue> queue, int32_t socket)
+    : m_binder(binder)
+    , m_queue(std::move(queue))
+    , m_socket(socket)
+{
+}
+
+MessageEndpoint::~MessageEndpoint()
+{
+    assert(m_socket < 0);
+}
+
+void MessageEndpoint::close()
+{
+    std::lock_guard<std::mutex> lock(m_lock);
+    if (m_socket < 0)
+        return;
+
+    for (int32_t connection : m_connections) {
+        m_queue->removeOnFileDescriptorEventListener(connection);
+        ::close(connection);
+    }
+    m_connections.clear();
+
+    m_queue->removeOnFileDescriptorEventListener(m_socket);
+    ::close(m_socket);
+    m_socket = -1;
+}
+
+int32_t MessageEndpoint::onFileDescriptorEvents(int32_t fd, int32_t events)
+{
+    std::lock_guard<std::mutex> lock(m_lock);
+    if (m_socket < 0)
+        return 0;
+
+    if (fd == m_socket) {
+        accept();
+        return MessageQueue::OnFileDescriptorEventListener::EVENT_INPUT;
+    }
+
+    if (receive(fd))
+        return MessageQueue::OnFileDescriptorEventListener::EVENT_INPUT;
+
+    // The queue forgets the connection before its descriptor can be reused.
+    m_connections.erase(std::find(m_connections.begin(), m_connections.end(), fd));
+    m_queue->removeOnFileDescriptorEventListener(fd);
+    ::close(fd);
+    return 0;
+}
+
+void MessageEndpoint::accept()
+{
+    int32_t connection;
+    while ((connection = ::accept4(m_socket, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC)) >= 0) {
+        // Abstract sockets are visible to every process of the network namespace, so only the same user is let in.
+        struct ucred credentials;
+        socklen_t length = sizeof(credentials);
+        if (::getsockopt(connection, SOL_SOCKET, SO_PEERCRED, &credentials, &length) || credentials.uid != ::getuid()) {
+            ::close(connection);
+            continue;
+        }
+
+        if (!m_queue->addOnFileDescriptorEventListener(connection, MessageQueue::OnFileDescriptorEventListener::EVENT_INPUT, shared_from_this())) {
+            ::close(connection);
+            continue;
+        }
+        m_connections.push_back(connection);
+    }
+}
+
+// Returns false once the connection is closed by the peer or broken.
+bool MessageEndpoint::receive(int32_t connection)
+{
+    MessagePacket packet;
+    MessagePacket::Result result;
+    while ((result = MessagePacket::receive(connection, packet)) == MessagePacket::Result::Done) {
+        Message message;
+        if (!MessagePacket::unpack(message, packet, m_replyTo) || !HandlerProviderLinux::sendToEndpoint(m_binder, message)) {
+            for (int32_t fd : packet.fileDescriptors)
+                ::close(fd);
+        }
+    }
+    return result == MessagePacket::Result::WouldBlock;
+}
+
+} // namespace os
+} // namespace android
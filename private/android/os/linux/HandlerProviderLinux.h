@@ -0,0 +1,58 @@
+/*
+ * Copyright (C) 2016 Naver Corp. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <android/os/HandlerProvider.h>
+#include <android/os/IBinder.h>
+
+#include <mutex>
+
+namespace android {
+namespace os {
+
+class MessageEndpoint;
+
+class HandlerProviderLinux : public HandlerProvider {
+    friend class HandlerProvider;
+public:
+    ~HandlerProviderLinux();
+
+    // Returns the binder Messengers of this and other processes reach the Handler with.
+    // The Handler starts listening for messages from other processes on first use.
+    static IBinder endpointHandle(HandlerProvider&);
+    // Delivers message to the Handler of binder, which lives in this process. Returns false if it is gone.
+    static bool sendToEndpoint(IBinder, Message&);
+
+private:
+    HandlerProviderLinux(Handler&);
+
+    std::mutex m_lock;
+    IBinder m_binder;
+    std::shared_ptr<MessageEndpoint> m_endpoint;
+};
+
+} // namespace os
+} // namespace android
@@ -0,0 +1,177 @@
+/*
+ * Copyright (C) 2016 Naver Corp. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "LooperProviderLinux.h"
+
+#include <android/os/Looper.h>
+
+#include <assert>
+#include <errno.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+namespace android {
+namespace os {
+
+std::unique_ptr<LooperProvider> LooperProvider::create(MessageQueue& client)
+{
+    return std::unique_ptr<LooperProvider>(new LooperProviderLinux(client));
+}
+
+LooperProviderLinux& LooperProviderLinux::current()
+{
+    return static_cast<LooperProviderLinux&>(LooperProvider::from(Looper::myQueue()));
+}
+
+LooperProviderLinux::LooperProviderLinux(MessageQueue& client)
+    : LooperProvider(client)
+    , m_epollFd(::epoll_create1(EPOLL_CLOEXEC))
+    , m_wakeEventFd(::eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK))
+    , m_timerFd(::timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC | TFD_NONBLOCK))
+    , m_pending(false)
+    , m_quit(false)
+{
+    assert(m_epollFd >= 0 && m_wakeEventFd >= 0 && m_timerFd >= 0);
+
+    struct epoll_event event = {};
+    event.events = EPOLLIN;
+    event.data.fd = m_wakeEventFd;
+    ::epoll_ctl(m_epollFd, EPOLL_CTL_ADD, m_wakeEventFd, &event);
+
+    event.data.fd = m_timerFd;
+    ::epoll_ctl(m_epollFd, EPOLL_CTL_ADD, m_timerFd, &event);
+}
+
+LooperProviderLinux::~LooperProviderLinux()
+{
+    ::close(m_timerFd);
+    ::close(m_wakeEventFd);
+    ::close(m_epollFd);
+}
+
+bool LooperProviderLinux::start()
+{
+    // Only the first post since the last dispatch needs to kick the loop.
+    if (!m_pending.exchange(true))
+        wake();
+    return true;
+}
+
+bool LooperProviderLinux::startAtTime(std::chrono::nanoseconds uptime)
+{
+    struct itimerspec timerSpec = { { 0, 0 }, { 0, 0 } };
+    std::chrono::seconds seconds = std::chrono::duration_cast<std::chrono::seconds>(uptime);
+    timerSpec.it_value.tv_sec = seconds.count();
+    timerSpec.it_value.tv_nsec = (uptime - seconds).count();
+    // A zero it_value disarms the timer, so a deadline at boot time still has to fire.
+    if (!timerSpec.it_value.tv_sec && !timerSpec.it_value.tv_nsec)
+        timerSpec.it_value.tv_nsec = 1;
+
+    return !::timerfd_settime(m_timerFd, TFD_TIMER_ABSTIME, &timerSpec, nullptr);
+}
+
+void LooperProviderLinux::stop()
+{
+    struct itimerspec timerSpec = { { 0, 0 }, { 0, 0 } };
+    ::timerfd_settime(m_timerFd, TFD_TIMER_ABSTIME, &timerSpec, nullptr);
+}
+
+bool LooperProviderLinux::watchFileDescriptor(int32_t fd, int32_t events, bool edgeTriggered, bool oneShot)
+{
+    struct epoll_event event = {};
+    if (events & MessageQueue::OnFileDescriptorEventListener::EVENT_INPUT)
+        event.events |= EPOLLIN;
+    if (events & MessageQueue::OnFileDescriptorEventListener::EVENT_OUTPUT)
+        event.events |= EPOLLOUT;
+    if (edgeTriggered)
+        event.events |= EPOLLET;
+    if (oneShot)
+        event.events |= EPOLLONESHOT;
+    event.data.fd = fd;
+
+    if (!::epoll_ctl(m_epollFd, EPOLL_CTL_MOD, fd, &event))
+        return true;
+    return errno == ENOENT && !::epoll_ctl(m_epollFd, EPOLL_CTL_ADD, fd, &event);
+}
+
+void LooperProviderLinux::unwatchFileDescriptor(int32_t fd)
+{
+    // Fails harmlessly if fd was already closed, which removed it from the epoll instance.
+    ::epoll_ctl(m_epollFd, EPOLL_CTL_DEL, fd, nullptr);
+}
+
+void LooperProviderLinux::loop()
+{
+    static const int maxEvents = 8;
+    struct epoll_event events[maxEvents];
+
+    while (!m_quit) {
+        int count = ::epoll_wait(m_epollFd, events, maxEvents, -1);
+        if (count < 0) {
+            if (errno == EINTR)
+                continue;
+            assert(false);
+            break;
+        }
+
+        for (int i = 0; i < count; ++i) {
+            uint64_t value;
+            if (events[i].data.fd == m_wakeEventFd) {
+                ::read(m_wakeEventFd, &value, sizeof(value));
+            } else if (events[i].data.fd == m_timerFd) {
+                ::read(m_timerFd, &value, sizeof(value));
+            } else {
+                int32_t fileDescriptorEvents = 0;
+                if (events[i].events & EPOLLIN)
+                    fileDescriptorEvents |= MessageQueue::OnFileDescriptorEventListener::EVENT_INPUT;
+                if (events[i].events & EPOLLOUT)
+                    fileDescriptorEvents |= MessageQueue::OnFileDescriptorEventListener::EVENT_OUTPUT;
+                if (events[i].events & (EPOLLERR | EPOLLHUP))
+                    fileDescriptorEvents |= MessageQueue::OnFileDescriptorEventListener::EVENT_ERROR;
+                performFileDescriptorEvents(events[i].data.fd, fileDescriptorEvents);
+            }
+        }
+
+        m_pending = false;
+        performMessages();
+    }
+}
+
+void LooperProviderLinux::quit()
+{
+    m_quit = true;
+    wake();
+}
+
+void LooperProviderLinux::wake()
+{
+    uint64_t value = 1;
+    ::write(m_wakeEventFd, &value, sizeof(value));
+}
+
+} // namespace os
+} // namespace android
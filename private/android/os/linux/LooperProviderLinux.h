@@ -0,0 +1,71 @@
+/*
+ * Copyright (C) 2016 Naver Corp. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <android/os/LooperProvider.h>
+
+#include <atomic>
+
+namespace android {
+namespace os {
+
+// One epoll instance per Looper. Cross-thread wakeups go through an eventfd and
+// the earliest deadline of the message queue is kept in a single timerfd.
+// File descriptors watched for the queue are added to the same epoll instance.
+class LooperProviderLinux final : public LooperProvider {
+    friend class LooperProvider;
+public:
+    ~LooperProviderLinux();
+
+    // Returns the provider of the Looper of the current thread.
+    static LooperProviderLinux& current();
+
+    bool start() override;
+    bool startAtTime(std::chrono::nanoseconds) override;
+    void stop() override;
+
+    bool watchFileDescriptor(int32_t fd, int32_t events, bool edgeTriggered, bool oneShot) override;
+    void unwatchFileDescriptor(int32_t fd) override;
+
+    void loop();
+    void quit();
+
+private:
+    LooperProviderLinux(MessageQueue&);
+
+    void wake();
+
+    int m_epollFd;
+    int m_wakeEventFd;
+    int m_timerFd;
+
+    std::atomic<bool> m_pending;
+    // Set from any thread, and left set, so that a quit before loop() still ends it right away.
+    std::atomic<bool> m_quit;
+};
+
+} // namespace os
+} // namespace android
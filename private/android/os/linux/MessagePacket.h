@@ -0,0 +1,410 @@
+/*
+ * Copyright (C) 2016 Naver Corp. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <android/os/Bundle.h>
+#include <android/os/BundlePrivate.h>
+#include <android/os/Message.h>
+#include <android/os/Messenger.h>
+
+#include <algorithm>
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <unordered_map>
+
+#include <assert>
+
+namespace android {
+namespace os {
+
+// Messages sent to a Handler of another process travel as one packet over a SOCK_SEQPACKET Unix socket,
+// and the file descriptors of their Bundle as SCM_RIGHTS ancillary data of that packet.
+// Small Bundles are inlined into the packet. Larger ones go out-of-line, into a sealed memfd passed
+// along with the packet, which the receiver maps read-only instead of the socket copying them.
+struct MessagePacket {
+    // The most descriptors the kernel passes along with a single packet, SCM_MAX_FD, less the out-of-line Bundle.
+    static const size_t fileDescriptorLimit = 252;
+    // Bundles larger than this go out-of-line.
+    static const size_t inlineLimit = 16 * 1024;
+
+    enum class Result {
+        Done,
+        WouldBlock,
+        Failed,
+    };
+
+    struct Header {
+        int32_t what;
+        int32_t arg1;
+        int32_t arg2;
+        int32_t requestId;
+        int64_t obj;
+        uint64_t replyTo;
+        uint32_t bundleSize;
+        uint16_t fileDescriptorCount;
+        uint16_t flags;
+    };
+
+    enum Flags {
+        BundleOutOfLine = 1 << 0,
+    };
+
+    // The replyTo Messengers of received messages, by binder, which stay valid as long as the receiver.
+    typedef std::unordered_map<uint64_t, std::unique_ptr<Messenger>> Messengers;
+
+    MessagePacket() = default;
+    MessagePacket(MessagePacket&&);
+    MessagePacket& operator=(MessagePacket&&);
+    ~MessagePacket();
+
+    Parcel data;
+    // The descriptors of the Bundle, taken out of its parcel.
+    std::vector<int32_t> fileDescriptors;
+    // The memfd holding an out-of-line Bundle, which belongs to the packet.
+    int32_t payload { -1 };
+
+    // The binder of a Handler which is reachable from other processes names an abstract socket
+    // from the id of its process and a serial number of the Handler in that process.
+    static IBinder binder(pid_t process, uint32_t serial);
+    static pid_t processOf(IBinder);
+    static uint32_t serialOf(IBinder);
+    static socklen_t address(IBinder, struct sockaddr_un&);
+
+    // Fails when the Bundle of the message holds more descriptors than a packet can pass.
+    static bool pack(MessagePacket&, Message&);
+    // Parcels the Bundle straight into a sealed memfd of capacity bytes, and returns the memfd, or -1.
+    static int32_t packOutOfLine(Bundle&, size_t capacity, uint32_t& bundleSize, std::vector<int32_t>& fileDescriptors);
+    // Leaves only the descriptors held by the Bundle of the message in the packet, and closes the others.
+    static bool unpack(Message&, MessagePacket&, Messengers& replyTo);
+
+    static Result send(int32_t socket, const MessagePacket&);
+    static Result receive(int32_t socket, MessagePacket&);
+};
+
+static_assert(sizeof(IBinder) >= sizeof(uint64_t), "A binder has to hold both a process id and a serial number");
+static_assert(sizeof(MessagePacket::Header) % 4 == 0, "The Bundle has to start at the alignment of the parcel");
+
+inline MessagePacket::MessagePacket(MessagePacket&& other)
+    : data(std::move(other.data))
+    , fileDescriptors(std::move(other.fileDescriptors))
+    , payload(other.payload)
+{
+    other.payload = -1;
+}
+
+inline MessagePacket& MessagePacket::operator=(MessagePacket&& other)
+{
+    if (payload >= 0)
+        ::close(payload);
+    data = std::move(other.data);
+    fileDescriptors = std::move(other.fileDescriptors);
+    payload = other.payload;
+    other.payload = -1;
+    return *this;
+}
+
+inline MessagePacket::~MessagePacket()
+{
+    if (payload >= 0)
+        ::close(payload);
+}
+
+inline IBinder MessagePacket::binder(pid_t process, uint32_t serial)
+{
+    return reinterpret_cast<IBinder>((static_cast<uint64_t>(process) << 32) | serial);
+}
+
+inline pid_t MessagePacket::processOf(IBinder binder)
+{
+    return static_cast<pid_t>(reinterpret_cast<uint64_t>(binder) >> 32);
+}
+
+inline uint32_t MessagePacket::serialOf(IBinder binder)
+{
+    return static_cast<uint32_t>(reinterpret_cast<uint64_t>(binder));
+}
+
+inline socklen_t MessagePacket::address(IBinder binder, struct sockaddr_un& address)
+{
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    // A leading NUL puts the name into the abstract namespace, which needs no cleanup when the process dies.
+    int length = snprintf(address.sun_path + 1, sizeof(address.sun_path) - 1, "androidpp.%d.%u", processOf(binder), serialOf(binder));
+    return static_cast<socklen_t>(offsetof(struct sockaddr_un, sun_path) + 1 + length);
+}
+
+inline bool MessagePacket::pack(MessagePacket& out, Message& in)
+{
+    Header header;
+    header.what = in.what;
+    header.arg1 = in.arg1;
+    header.arg2 = in.arg2;
+    header.requestId = in.getRequestId();
+    header.obj = in.obj;
+    header.replyTo = in.replyTo ? reinterpret_cast<uint64_t>(in.replyTo->getBinder()) : 0;
+    header.bundleSize = 0;
+    header.fileDescriptorCount = 0;
+    header.flags = 0;
+
+    // The header is written again once the size of the Bundle is known.
+    out.data.freeData();
+    out.data.write(&header, sizeof(header));
+    out.fileDescriptors.clear();
+    if (out.payload >= 0)
+        ::close(out.payload);
+    out.payload = -1;
+
+    Bundle* bundle = in.peekData();
+    if (!bundle)
+        return true;
+
+    // Bundles which may not fit inline are parceled straight into a memfd, and inline otherwise,
+    // or when the memfd cannot be made.
+    size_t capacity = BundlePrivate::parcelCapacity(*bundle);
+    if (capacity > inlineLimit)
+        out.payload = packOutOfLine(*bundle, capacity, header.bundleSize, out.fileDescriptors);
+    if (out.payload >= 0) {
+        header.flags |= BundleOutOfLine;
+    } else {
+        bundle->writeToParcel(out.data, 0);
+        out.fileDescriptors = out.data.fileDescriptors();
+        header.bundleSize = static_cast<uint32_t>(out.data.dataSize() - sizeof(header));
+    }
+
+    if (out.fileDescriptors.size() > fileDescriptorLimit) {
+        out.data.freeData();
+        out.fileDescriptors.clear();
+        if (out.payload >= 0)
+            ::close(out.payload);
+        out.payload = -1;
+        return false;
+    }
+    header.fileDescriptorCount = static_cast<uint16_t>(out.fileDescriptors.size());
+
+    out.data.setDataPosition(0);
+    out.data.write(&header, sizeof(header));
+    return true;
+}
+
+inline int32_t MessagePacket::packOutOfLine(Bundle& bundle, size_t capacity, uint32_t& bundleSize, std::vector<int32_t>& fileDescriptors)
+{
+    int32_t payload = ::memfd_create("MessagePacket", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    if (payload < 0)
+        return -1;
+
+    void* buffer = MAP_FAILED;
+    if (!::ftruncate(payload, capacity))
+        buffer = ::mmap(nullptr, capacity, PROT_READ | PROT_WRITE, MAP_SHARED, payload, 0);
+    if (buffer == MAP_FAILED) {
+        ::close(payload);
+        return -1;
+    }
+
+    Parcel parcel;
+    parcel.setDataBuffer(buffer, capacity);
+    bundle.writeToParcel(parcel, 0);
+    // The capacity is an upper bound, so the parcel never has to move out of the mapping.
+    bool inPlace = parcel.data() == buffer;
+    bundleSize = static_cast<uint32_t>(parcel.dataSize());
+    fileDescriptors = parcel.fileDescriptors();
+    parcel.freeData();
+    ::munmap(buffer, capacity);
+
+    // Sealed, so that the receiver can read the Bundle in place without the sender changing it underneath.
+    // The write seal cannot be added while a writable mapping is left, so the memfd is sealed once unmapped.
+    if (!inPlace || ::ftruncate(payload, bundleSize)
+        || ::fcntl(payload, F_ADD_SEALS, F_SEAL_WRITE | F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_SEAL)) {
+        ::close(payload);
+        return -1;
+    }
+    return payload;
+}
+
+inline bool MessagePacket::unpack(Message& out, MessagePacket& in, Messengers& replyTo)
+{
+    Header header;
+    in.data.setDataPosition(0);
+    if (!in.data.read(&header, sizeof(header)))
+        return false;
+
+    bool outOfLine = header.flags & BundleOutOfLine;
+    if (in.data.dataSize() != sizeof(header) + (outOfLine ? 0 : header.bundleSize)
+        || in.fileDescriptors.size() != static_cast<size_t>(header.fileDescriptorCount) + (outOfLine ? 1 : 0))
+        return false;
+
+    // Inline Bundles are read right from the packet, and out-of-line ones from the mapping of their memfd.
+    Parcel* parcel = &in.data;
+    Parcel mapping;
+    void* bundleData = nullptr;
+    if (outOfLine) {
+        // The out-of-line Bundle comes after the descriptors of the Bundle.
+        in.payload = in.fileDescriptors.back();
+        in.fileDescriptors.pop_back();
+
+        struct stat status;
+        int seals = ::fcntl(in.payload, F_GET_SEALS);
+        if (seals < 0 || !(seals & F_SEAL_WRITE) || !(seals & F_SEAL_SHRINK) || ::fstat(in.payload, &status) || status.st_size < header.bundleSize)
+            return false;
+
+        bundleData = ::mmap(nullptr, header.bundleSize, PROT_READ, MAP_SHARED, in.payload, 0);
+        if (bundleData == MAP_FAILED)
+            return false;
+        mapping.setDataReference(bundleData, header.bundleSize);
+        parcel = &mapping;
+    }
+
+    out = Message::obtain(nullptr, header.what, header.arg1, header.arg2, static_cast<intptr_t>(header.obj));
+    out.setRequestId(header.requestId);
+    if (header.replyTo) {
+        std::unique_ptr<Messenger>& messenger = replyTo[header.replyTo];
+        if (!messenger)
+            messenger.reset(new Messenger(reinterpret_cast<IBinder>(header.replyTo)));
+        out.replyTo = messenger.get();
+    }
+
+    if (header.bundleSize > 0 || header.fileDescriptorCount > 0) {
+        parcel->setFileDescriptors(in.fileDescriptors);
+        out.getData().readFromParcel(*parcel);
+    }
+
+    if (bundleData)
+        ::munmap(bundleData, header.bundleSize);
+
+    // A rejected Bundle holds no descriptors, and a well-formed one need not refer to all of them.
+    if (!in.fileDescriptors.empty()) {
+        std::vector<int32_t> bundleFileDescriptors;
+        if (Bundle* bundle = out.peekData())
+            BundlePrivate::fileDescriptors(*bundle, bundleFileDescriptors);
+        for (int32_t fd : in.fileDescriptors) {
+            if (std::find(bundleFileDescriptors.begin(), bundleFileDescriptors.end(), fd) == bundleFileDescriptors.end())
+                ::close(fd);
+        }
+        std::sort(bundleFileDescriptors.begin(), bundleFileDescriptors.end());
+        bundleFileDescriptors.erase(std::unique(bundleFileDescriptors.begin(), bundleFileDescriptors.end()), bundleFileDescriptors.end());
+        in.fileDescriptors = std::move(bundleFileDescriptors);
+    }
+
+    return true;
+}
+
+inline MessagePacket::Result MessagePacket::send(int32_t socket, const MessagePacket& packet)
+{
+    struct iovec vector;
+    vector.iov_base = const_cast<uint8_t*>(packet.data.data());
+    vector.iov_len = packet.data.dataSize();
+
+    struct msghdr header = {};
+    header.msg_iov = &vector;
+    header.msg_iovlen = 1;
+
+    char control[CMSG_SPACE(sizeof(int32_t) * (fileDescriptorLimit + 1))];
+    size_t count = packet.fileDescriptors.size() + (packet.payload >= 0 ? 1 : 0);
+    if (count > fileDescriptorLimit + 1)
+        return Result::Failed;
+    if (count) {
+        size_t size = sizeof(int32_t) * count;
+        header.msg_control = control;
+        header.msg_controllen = CMSG_SPACE(size);
+        struct cmsghdr* message = CMSG_FIRSTHDR(&header);
+        message->cmsg_level = SOL_SOCKET;
+        message->cmsg_type = SCM_RIGHTS;
+        message->cmsg_len = CMSG_LEN(size);
+        int32_t* fds = reinterpret_cast<int32_t*>(CMSG_DATA(message));
+        memcpy(fds, packet.fileDescriptors.data(), sizeof(int32_t) * packet.fileDescriptors.size());
+        if (packet.payload >= 0)
+            fds[packet.fileDescriptors.size()] = packet.payload;
+    }
+
+    while (::sendmsg(socket, &header, MSG_DONTWAIT | MSG_NOSIGNAL) < 0) {
+        if (errno == EINTR)
+            continue;
+        return (errno == EAGAIN || errno == EWOULDBLOCK) ? Result::WouldBlock : Result::Failed;
+    }
+    return Result::Done;
+}
+
+inline MessagePacket::Result MessagePacket::receive(int32_t socket, MessagePacket& packet)
+{
+    // Peeking without room for ancillary data tells the size of the next packet without receiving its descriptors.
+    ssize_t size;
+    while ((size = ::recv(socket, nullptr, 0, MSG_DONTWAIT | MSG_PEEK | MSG_TRUNC)) < 0 && errno == EINTR) { }
+    if (size < 0)
+        return (errno == EAGAIN || errno == EWOULDBLOCK) ? Result::WouldBlock : Result::Failed;
+
+    // The packet is received straight into the buffer of the parcel.
+    packet.data.freeData();
+    void* buffer = packet.data.writeInplace(size);
+    if (size && !buffer)
+        return Result::Failed;
+    packet.data.setDataSize(size);
+    packet.fileDescriptors.clear();
+    if (packet.payload >= 0)
+        ::close(packet.payload);
+    packet.payload = -1;
+
+    struct iovec vector;
+    vector.iov_base = buffer;
+    vector.iov_len = size;
+
+    char control[CMSG_SPACE(sizeof(int32_t) * (fileDescriptorLimit + 1))];
+    struct msghdr header = {};
+    header.msg_iov = &vector;
+    header.msg_iovlen = 1;
+    header.msg_control = control;
+    header.msg_controllen = sizeof(control);
+
+    ssize_t received;
+    while ((received = ::recvmsg(socket, &header, MSG_DONTWAIT | MSG_CMSG_CLOEXEC)) < 0 && errno == EINTR) { }
+    // An orderly shutdown of the peer reads as an empty packet, which is never sent otherwise.
+    if (received <= 0)
+        return (received < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) ? Result::WouldBlock : Result::Failed;
+
+    for (struct cmsghdr* message = CMSG_FIRSTHDR(&header); message; message = CMSG_NXTHDR(&header, message)) {
+        if (message->cmsg_level != SOL_SOCKET || message->cmsg_type != SCM_RIGHTS)
+            continue;
+        size_t count = (message->cmsg_len - CMSG_LEN(0)) / sizeof(int32_t);
+        const int32_t* fds = reinterpret_cast<const int32_t*>(CMSG_DATA(message));
+        packet.fileDescriptors.insert(packet.fileDescriptors.end(), fds, fds + count);
+    }
+
+    if (received != size || (header.msg_flags & (MSG_TRUNC | MSG_CTRUNC))) {
+        for (int32_t fd : packet.fileDescriptors)
+            ::close(fd);
+        packet.fileDescriptors.clear();
+        return Result::Failed;
+    }
+    return Result::Done;
+}
+
+} // namespace os
+} // namespace android
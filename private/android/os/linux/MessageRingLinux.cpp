@@ -0,0 +1,116 @@
+/*
+ * Copyright (C) 2016 Naver Corp. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <android/os/MessageRing.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace android {
+namespace os {
+
+bool MessageRing::platformCreateMemory(size_t size, Memory& memory)
+{
+    memory.fd = ::memfd_create("MessageRing", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    memory.address = nullptr;
+    memory.size = size;
+    if (memory.fd < 0)
+        return false;
+
+    // The other end can neither shrink the memory under the mapping of this one, nor grow it.
+    if (::ftruncate(memory.fd, size) || ::fcntl(memory.fd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_SEAL)) {
+        platformUnmapMemory(memory);
+        return false;
+    }
+
+    return platformMapMemory(memory.fd, memory);
+}
+
+bool MessageRing::platformMapMemory(int32_t fd, Memory& memory)
+{
+    struct stat status;
+    if (::fstat(fd, &status))
+        return false;
+
+    void* address = ::mmap(nullptr, status.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (address == MAP_FAILED)
+        return false;
+
+    memory.fd = fd;
+    memory.address = address;
+    memory.size = status.st_size;
+    return true;
+}
+
+void MessageRing::platformUnmapMemory(Memory& memory)
+{
+    if (memory.address)
+        ::munmap(memory.address, memory.size);
+    if (memory.fd >= 0)
+        ::close(memory.fd);
+    memory.fd = -1;
+    memory.address = nullptr;
+}
+
+int32_t MessageRing::platformCreateEvent()
+{
+    return ::eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+}
+
+void MessageRing::platformSignalEvent(int32_t event)
+{
+    uint64_t value = 1;
+    while (::write(event, &value, sizeof(value)) < 0 && errno == EINTR) { }
+}
+
+void MessageRing::platformClearEvent(int32_t event)
+{
+    uint64_t value;
+    while (::read(event, &value, sizeof(value)) < 0 && errno == EINTR) { }
+}
+
+void MessageRing::platformCloseEvent(int32_t event)
+{
+    if (event >= 0)
+        ::close(event);
+}
+
+int32_t MessageRing::platformDuplicateDescriptor(int32_t fd)
+{
+    return ::fcntl(fd, F_DUPFD_CLOEXEC, 0);
+}
+
+void MessageRing::platformCloseDescriptor(int32_t fd)
+{
+    if (fd >= 0)
+        ::close(fd);
+}
+
+} // namespace os
+} // namespace android
@@ -0,0 +1,353 @@
+/*
+ * Copyright (C) 2016 Naver Corp. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <android/os/MessageTarget.h>
+
+#include "HandlerProviderLinux.h"
+#include "MessagePacket.h"
+#include <android/os/Handler.h>
+#include <android/os/Looper.h>
+#include <android/os/Message.h>
+#include <android/os/MessageQueue.h>
+#include <platforms/LogHelper.h>
+
+#include <deque>
+#include <fcntl.h>
+#include <mutex>
+#include <unordered_map>
+
+#include <assert>
+
+namespace android {
+namespace os {
+
+// A connection which is refused because the listen backlog of the receiver is full is retried after this long.
+static const std::chrono::milliseconds connectRetryDelay(10);
+
+// Sends messages to a Handler of another process, over a connection which all Messengers of this process
+// targeting that Handler share. Messages which do not fit into the socket buffer wait in a backlog, which the
+// output thread of MessageTarget flushes once the socket is writable again, so that a busy receiver never
+// blocks the sender, and senders need no Looper of their own.
+class MessageSender final : public MessageQueue::OnFileDescriptorEventListener, public std::enable_shared_from_this<MessageSender> {
+public:
+    static std::shared_ptr<MessageSender> get(IBinder);
+    ~MessageSender();
+
+    void send(Message&);
+
+    int32_t onFileDescriptorEvents(int32_t fd, int32_t events) override;
+
+private:
+    explicit MessageSender(IBinder);
+
+    MessagePacket::Result connect();
+    MessagePacket::Result flush();
+    void retry();
+    void waitForOutput();
+    void fail();
+
+    std::mutex m_lock;
+    IBinder m_binder;
+    int32_t m_socket;
+    bool m_connected;
+    std::deque<MessagePacket> m_backlog;
+    // Whether the backlog waits for the socket to become writable, or for the next attempt to connect.
+    bool m_waiting;
+    std::shared_ptr<Handler> m_handler;
+};
+
+class InProcessMessageTarget : public MessageTarget {
+public:
+    InProcessMessageTarget(IBinder target);
+    ~InProcessMessageTarget();
+
+    void send(Message&) override;
+
+    IBinder handle() const override;
+
+private:
+    IBinder m_target;
+};
+
+class SocketMessageTarget : public MessageTarget {
+public:
+    SocketMessageTarget(IBinder target);
+    ~SocketMessageTarget();
+
+    void send(Message&) override;
+
+    IBinder handle() const override;
+
+private:
+    IBinder m_target;
+    std::shared_ptr<MessageSender> m_sender;
+};
+
+static std::mutex& sendersLock()
+{
+    static std::mutex* lock = new std::mutex;
+    return *lock;
+}
+
+static std::unordered_map<IBinder, std::weak_ptr<MessageSender>>& senders()
+{
+    static std::unordered_map<IBinder, std::weak_ptr<MessageSender>>* senders = new std::unordered_map<IBinder, std::weak_ptr<MessageSender>>;
+    return *senders;
+}
+
+std::shared_ptr<MessageSender> MessageSender::get(IBinder binder)
+{
+    std::lock_guard<std::mutex> lock(sendersLock());
+    std::weak_ptr<MessageSender>& entry = senders()[binder];
+    std::shared_ptr<MessageSender> sender = entry.lock();
+    if (!sender) {
+        sender = std::shared_ptr<MessageSender>(new MessageSender(binder));
+        entry = sender;
+    }
+    return sender;
+}
+
+MessageSender::MessageSender(IBinder binder)
+    : m_binder(binder)
+    , m_socket(-1)
+    , m_connected(false)
+    , m_waiting(false)
+{
+}
+
+MessageSender::~MessageSender()
+{
+    {
+        std::lock_guard<std::mutex> lock(sendersLock());
+        auto it = senders().find(m_binder);
+        if (it != senders().end() && it->second.expired())
+            senders().erase(it);
+    }
+
+    // Pending flushes hold a reference, so nothing waits for the socket anymore.
+    assert(!m_waiting);
+    fail();
+}
+
+void MessageSender::send(Message& message)
+{
+    MessagePacket packet;
+    if (!MessagePacket::pack(packet, message)) {
+        LOGW("Message %d is dropped, its Bundle holds more than %u descriptors", message.what,
+            static_cast<uint32_t>(MessagePacket::fileDescriptorLimit));
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(m_lock);
+    // Messages still in the backlog go first, which keeps them in order.
+    MessagePacket::Result result = flush();
+    if (result == MessagePacket::Result::Done)
+        result = MessagePacket::send(m_socket, packet);
+
+    switch (result) {
+    case MessagePacket::Result::Done:
+        return;
+    case MessagePacket::Result::Failed:
+        LOGW("Message %d is dropped, Handler %u of process %d is not reachable", message.what,
+            MessagePacket::serialOf(m_binder), MessagePacket::processOf(m_binder));
+        fail();
+        return;
+    case MessagePacket::Result::WouldBlock:
+        break;
+    }
+
+    // The caller may close its descriptors once send() returns, while the packet still waits for its turn.
+    for (size_t i = 0; i < packet.fileDescriptors.size(); ++i) {
+        int32_t fd = ::fcntl(packet.fileDescriptors[i], F_DUPFD_CLOEXEC, 0);
+        if (fd < 0) {
+            LOGW("Message %d is dropped, its descriptors cannot be kept, errno %d", message.what, errno);
+            for (size_t j = 0; j < i; ++j)
+                ::close(packet.fileDescriptors[j]);
+            return;
+        }
+        packet.fileDescriptors[i] = fd;
+    }
+    m_backlog.push_back(std::move(packet));
+    waitForOutput();
+}
+
+int32_t MessageSender::onFileDescriptorEvents(int32_t fd, int32_t events)
+{
+    std::lock_guard<std::mutex> lock(m_lock);
+    MessagePacket::Result result = flush();
+    if (result == MessagePacket::Result::WouldBlock)
+        return MessageQueue::OnFileDescriptorEventListener::EVENT_OUTPUT;
+
+    // fail() has the queue forget the socket before closing it.
+    if (result == MessagePacket::Result::Failed)
+        fail();
+    m_waiting = false;
+    return 0;
+}
+
+MessagePacket::Result MessageSender::connect()
+{
+    if (m_connected)
+        return MessagePacket::Result::Done;
+
+    if (m_socket < 0) {
+        m_socket = ::socket(AF_UNIX, SOCK_SEQPACKET | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (m_socket < 0)
+            return MessagePacket::Result::Failed;
+    }
+
+    struct sockaddr_un address;
+    socklen_t length = MessagePacket::address(m_binder, address);
+    if (!::connect(m_socket, reinterpret_cast<struct sockaddr*>(&address), length)) {
+        m_connected = true;
+        return MessagePacket::Result::Done;
+    }
+    return (errno == EAGAIN || errno == EINTR) ? MessagePacket::Result::WouldBlock : MessagePacket::Result::Failed;
+}
+
+MessagePacket::Result MessageSender::flush()
+{
+    MessagePacket::Result result = connect();
+    while (result == MessagePacket::Result::Done && !m_backlog.empty()) {
+        result = MessagePacket::send(m_socket, m_backlog.front());
+        if (result != MessagePacket::Result::Done)
+            break;
+
+        for (int32_t fd : m_backlog.front().fileDescriptors)
+            ::close(fd);
+        m_backlog.pop_front();
+    }
+    return result;
+}
+
+void MessageSender::retry()
+{
+    std::lock_guard<std::mutex> lock(m_lock);
+    m_waiting = false;
+    switch (flush()) {
+    case MessagePacket::Result::Done:
+        break;
+    case MessagePacket::Result::Failed:
+        fail();
+        break;
+    case MessagePacket::Result::WouldBlock:
+        waitForOutput();
+        break;
+    }
+}
+
+void MessageSender::waitForOutput()
+{
+    if (m_waiting)
+        return;
+
+    if (!m_handler)
+        m_handler = MessageTarget::outputHandler();
+
+    m_waiting = true;
+    if (m_connected && m_handler->getLooper()->getQueue().addOnFileDescriptorEventListener(m_socket,
+        MessageQueue::OnFileDescriptorEventListener::EVENT_OUTPUT, shared_from_this()))
+        return;
+
+    std::shared_ptr<MessageSender> sender = shared_from_this();
+    m_handler->postDelayed([sender] { sender->retry(); }, connectRetryDelay);
+}
+
+void MessageSender::fail()
+{
+    if (m_waiting && m_connected) {
+        m_handler->getLooper()->getQueue().removeOnFileDescriptorEventListener(m_socket);
+        m_waiting = false;
+    }
+
+    for (MessagePacket& packet : m_backlog) {
+        for (int32_t fd : packet.fileDescriptors)
+            ::close(fd);
+    }
+    m_backlog.clear();
+
+    if (m_socket >= 0)
+        ::close(m_socket);
+    m_socket = -1;
+    m_connected = false;
+}
+
+InProcessMessageTarget::InProcessMessageTarget(IBinder target)
+    : m_target(target)
+{
+    assert(target);
+}
+
+InProcessMessageTarget::~InProcessMessageTarget()
+{
+}
+
+void InProcessMessageTarget::send(Message& message)
+{
+    if (!HandlerProviderLinux::sendToEndpoint(m_target, message))
+        LOGW("Message %d is dropped, Handler %u is gone", message.what, MessagePacket::serialOf(m_target));
+}
+
+IBinder InProcessMessageTarget::handle() const
+{
+    return m_target;
+}
+
+SocketMessageTarget::SocketMessageTarget(IBinder target)
+    : m_target(target)
+    , m_sender(MessageSender::get(target))
+{
+    assert(target);
+}
+
+SocketMessageTarget::~SocketMessageTarget()
+{
+}
+
+void SocketMessageTarget::send(Message& message)
+{
+    m_sender->send(message);
+}
+
+IBinder SocketMessageTarget::handle() const
+{
+    return m_target;
+}
+
+std::unique_ptr<MessageTarget> MessageTarget::create(IBinder target)
+{
+    if (MessagePacket::processOf(target) == ::getpid())
+        return std::unique_ptr<MessageTarget>(new InProcessMessageTarget(target));
+
+    return std::unique_ptr<MessageTarget>(new SocketMessageTarget(target));
+}
+
+IBinder MessageTarget::platformGetHandlerHandle(Handler& handler)
+{
+    return HandlerProviderLinux::endpointHandle(*handler.m_handler);
+}
+
+} // namespace os
+} // namespace android
@@ -0,0 +1,107 @@
+/*
+ * Copyright (C) 2016 Naver Corp. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <android/os/AsyncIOProvider.h>
+
+#include <platforms/StringConversion.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <io.h>
+#include <sys/stat.h>
+#include <windows.h>
+
+namespace android {
+namespace os {
+
+static int openFlags(int32_t mode)
+{
+    int flags = _O_BINARY | _O_NOINHERIT;
+    if ((mode & AsyncFile::MODE_READ_WRITE) == AsyncFile::MODE_READ_WRITE)
+        flags |= _O_RDWR;
+    else if (mode & AsyncFile::MODE_WRITE_ONLY)
+        flags |= _O_WRONLY;
+    else
+        flags |= _O_RDONLY;
+
+    if (mode & AsyncFile::MODE_CREATE)
+        flags |= _O_CREAT;
+    if (mode & AsyncFile::MODE_TRUNCATE)
+        flags |= _O_TRUNC;
+    if (mode & AsyncFile::MODE_APPEND)
+        flags |= _O_APPEND;
+    return flags;
+}
+
+// Positioned reads and writes go through an OVERLAPPED offset, which leaves the file pointer
+// alone, so that concurrent requests on the same file do not race on it.
+static int32_t transfer(AsyncIORequest& request)
+{
+    HANDLE file = reinterpret_cast<HANDLE>(::_get_osfhandle(request.descriptor->fd()));
+    if (file == INVALID_HANDLE_VALUE)
+        return -EBADF;
+
+    OVERLAPPED overlapped = {};
+    overlapped.Offset = static_cast<DWORD>(request.offset);
+    overlapped.OffsetHigh = static_cast<DWORD>(static_cast<uint64_t>(request.offset) >> 32);
+
+    DWORD transferred = 0;
+    BOOL succeeded = request.operation == AsyncIORequest::Operation::Read
+        ? ::ReadFile(file, request.buffer.data(), static_cast<DWORD>(request.length), &transferred, &overlapped)
+        : ::WriteFile(file, request.buffer.data(), static_cast<DWORD>(request.length), &transferred, &overlapped);
+    if (!succeeded)
+        return ::GetLastError() == ERROR_HANDLE_EOF ? 0 : -EIO;
+
+    return static_cast<int32_t>(transferred);
+}
+
+int32_t AsyncIOProvider::perform(AsyncIORequest& request)
+{
+    switch (request.operation) {
+    case AsyncIORequest::Operation::Open: {
+        int fd = ::_wopen(std::s2ws(request.path).c_str(), openFlags(request.mode), _S_IREAD | _S_IWRITE);
+        return fd < 0 ? -errno : fd;
+    }
+    case AsyncIORequest::Operation::Read:
+    case AsyncIORequest::Operation::Write:
+        return transfer(request);
+    case AsyncIORequest::Operation::Fsync:
+        return ::_commit(request.descriptor->fd()) ? -errno : 0;
+    }
+    return -EINVAL;
+}
+
+void AsyncIOProvider::close(int32_t fd)
+{
+    ::_close(fd);
+}
+
+std::unique_ptr<AsyncIOProvider> AsyncIOProvider::create()
+{
+    return createThreadPool();
+}
+
+} // namespace os
+} // namespace android
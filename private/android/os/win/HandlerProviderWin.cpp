@@ -27,46 +27,17 @@
 
 #include "MessageCopyData.h"
 #include <android/os/Messenger.h>
-#include <java/lang/System.h>
 
 #include <array>
 #include <mutex>
 
 #include <assert>
-#include <mmsystem.h>
-
-// Derived from Code from Webkit (https://webkit.org/) under LGPL v2 and BSD licenses (https://webkit.org/licensing-webkit/)
-
-// These aren't in winuser.h with the MSVS 2003 Platform SDK, 
-// so use default values in that case.
-#ifndef USER_TIMER_MINIMUM
-#define USER_TIMER_MINIMUM 0x0000000A
-#endif
-
-#ifndef USER_TIMER_MAXIMUM
-#define USER_TIMER_MAXIMUM 0x7FFFFFFF
-#endif
-
-#ifndef QS_RAWINPUT
-#define QS_RAWINPUT         0x0400
-#endif
 
 namespace android {
 namespace os {
 
 static const LPWSTR kMessageWindowClassName = L"MessageWindow";
 
-const int timerResolution = 1; // To improve timer resolution, we call timeBeginPeriod/timeEndPeriod with this value to increase timer resolution to 1ms.
-const int highResolutionThresholdMsec = 16; // Only activate high-res timer for sub-16ms timers (Windows can fire timers at 16ms intervals without changing the system resolution).
-const int stopHighResTimerInMsec = 300; // Stop high-res timer after 0.3 seconds to lessen power consumption (we don't use a smaller time since oscillating between high and low resolution breaks timer accuracy on XP).
-
-static UINT timerFiredMessage = 0;
-
-enum {
-    sharedTimerID = 1000,
-    endHighResTimerID = 1001,
-};
-
 std::unique_ptr<HandlerProvider> HandlerProvider::create(Handler& client)
 {
     return std::unique_ptr<HandlerProvider>(new HandlerProviderWin(client));
@@ -77,10 +48,6 @@ class HandlerProviderWindow : public HandlerProvider {
 public:
     ~HandlerProviderWindow();
 
-    bool start() override;
-    bool startAtTime(std::chrono::milliseconds) override;
-    void stop() override;
-
     void close();
 
 private:
@@ -90,17 +57,8 @@ private:
 
     static LRESULT CALLBACK messageWindowProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam);
     static LRESULT messageWindowProcInternal(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam);
-    static void NTAPI messageWindowQueueTimerCallback(PVOID parameter, BOOLEAN);
 
     HWND m_messageWindow;
-
-    UINT m_activeTimerID;
-    bool m_shouldUseHighResolutionTimers;
-    HANDLE m_timerQueue;
-    HANDLE m_timerQueueTimer;
-    bool m_highResTimerActive;
-    bool m_processingCustomTimerMessage;
-    LONG m_pendingTimers;
 };
 
 HandlerProviderWin::HandlerProviderWin(Handler& client)
@@ -114,21 +72,6 @@ HandlerProviderWin::~HandlerProviderWin()
     m_window.close();
 }
 
-bool HandlerProviderWin::start()
-{
-    return m_window.start();
-}
-
-bool HandlerProviderWin::startAtTime(std::chrono::milliseconds uptimeMillis)
-{
-    return m_window.startAtTime(uptimeMillis);
-}
-
-void HandlerProviderWin::stop()
-{
-    m_window.stop();
-}
-
 HWND HandlerProviderWin::messageWindowHandle(HandlerProvider& handler)
 {
     return static_cast<HandlerProviderWin&>(handler).m_window.m_messageWindow;
@@ -136,13 +79,6 @@ HWND HandlerProviderWin::messageWindowHandle(HandlerProvider& handler)
 
 HandlerProviderWindow::HandlerProviderWindow(Handler& client)
     : HandlerProvider(client)
-    , m_activeTimerID(0)
-    , m_shouldUseHighResolutionTimers(true)
-    , m_timerQueue(::CreateTimerQueue())
-    , m_timerQueueTimer(0)
-    , m_highResTimerActive(0)
-    , m_processingCustomTimerMessage(false)
-    , m_pendingTimers(0)
 {
     registerMessageWindowClass();
 
@@ -163,8 +99,6 @@ void HandlerProviderWindow::registerMessageWindowClass()
         windowClass.cbWndExtra = sizeof(HandlerProviderWindow*) * 2;
         windowClass.lpszClassName = kMessageWindowClassName;
 
-        timerFiredMessage = ::RegisterWindowMessage(L"HandlerTimerFired");
-
         if (!::RegisterClass(&windowClass))
             assert(0);
     });
@@ -202,126 +136,21 @@ LRESULT HandlerProviderWindow::messageWindowProcInternal(HWND hWnd, UINT message
         HWND replyTo = (HWND)wParam;
         COPYDATASTRUCT* data = (COPYDATASTRUCT*)lParam;
         DWORD processIdentifier = data->dwData;
-        MessageCopyData::Data values;
-        memcpy(&values, data->lpData, data->cbData);
         Message message;
-        MessageCopyData::unpack(message, values);
+        // The data is only valid while the sender waits, so it is unpacked before returning.
+        if (!MessageCopyData::unpack(message, data->lpData, data->cbData, processIdentifier))
+            return 0;
         message.replyTo = new Messenger((IBinder)replyTo);
         handler->receivedMessage(message);
         return 0;
     }
-    case WM_TIMER:
-        if (wParam == sharedTimerID) {
-            ::KillTimer(hWnd, sharedTimerID);
-            handler->performMessages();
-        } else if (wParam == endHighResTimerID) {
-            ::KillTimer(hWnd, endHighResTimerID);
-            handler->m_highResTimerActive = false;
-            ::timeEndPeriod(timerResolution);
-        }
-        return 0;
     default:
-        if (message == timerFiredMessage) {
-            ::InterlockedExchange(&handler->m_pendingTimers, 0);
-            handler->m_processingCustomTimerMessage = true;
-            handler->performMessages();
-            handler->m_processingCustomTimerMessage = false;
-            return 0;
-        }
         break;
     }
 
     return ::DefWindowProc(hWnd, message, wParam, lParam);
 }
 
-void NTAPI HandlerProviderWindow::messageWindowQueueTimerCallback(PVOID parameter, BOOLEAN)
-{
-    HandlerProviderWindow* handler = static_cast<HandlerProviderWindow*>(parameter);
-    handler->start();
-}
-
-bool HandlerProviderWindow::start()
-{
-    if (::InterlockedIncrement(&m_pendingTimers) == 1)
-        ::PostMessage(m_messageWindow, timerFiredMessage, 0, 0);
-    return true;
-}
-
-bool HandlerProviderWindow::startAtTime(std::chrono::milliseconds uptimeMillis)
-{
-    std::chrono::milliseconds delayMillis = uptimeMillis - System::currentTimeMillis();
-
-    DWORD dueTime;
-    if (delayMillis.count() > USER_TIMER_MAXIMUM)
-        dueTime = USER_TIMER_MAXIMUM;
-    else if (delayMillis.count() < 0)
-        dueTime = 0;
-    else
-        dueTime = static_cast<DWORD>(delayMillis.count());
-
-    if (dueTime == 0) {
-        start();
-        return true;
-    }
-
-    bool timerSet = false;
-
-    if (m_shouldUseHighResolutionTimers) {
-        if (dueTime < highResolutionThresholdMsec) {
-            if (!m_highResTimerActive) {
-                m_highResTimerActive = true;
-                ::timeBeginPeriod(timerResolution);
-            }
-            ::SetTimer(m_messageWindow, endHighResTimerID, stopHighResTimerInMsec, 0);
-        }
-
-        DWORD queueStatus = LOWORD(::GetQueueStatus(QS_PAINT | QS_MOUSEBUTTON | QS_KEY | QS_RAWINPUT));
-
-        // Win32 has a tri-level queue with application messages > user input > WM_PAINT/WM_TIMER.
-
-        // If the queue doesn't contains input events, we use a higher priorty timer event posting mechanism.
-        if (!(queueStatus & (QS_MOUSEBUTTON | QS_KEY | QS_RAWINPUT))) {
-            if (dueTime < USER_TIMER_MINIMUM && !m_processingCustomTimerMessage && !(queueStatus & QS_PAINT)) {
-                // Call PostMessage immediately if the timer is already expired, unless a paint is pending.
-                // (we prioritize paints over timers)
-                if (::InterlockedIncrement(&m_pendingTimers) == 1)
-                    ::PostMessage(m_messageWindow, timerFiredMessage, 0, 0);
-                timerSet = true;
-            } else {
-                // Otherwise, delay the PostMessage via a CreateTimerQueueTimer
-                if (m_timerQueueTimer)
-                    ::DeleteTimerQueueTimer(m_timerQueue, m_timerQueueTimer, 0);
-                timerSet = ::CreateTimerQueueTimer(&m_timerQueueTimer, m_timerQueue, messageWindowQueueTimerCallback, this, dueTime, 0, WT_EXECUTEINTIMERTHREAD | WT_EXECUTEONLYONCE);
-            }
-        }
-    }
-
-    if (timerSet) {
-        if (m_activeTimerID) {
-            ::KillTimer(m_messageWindow, m_activeTimerID);
-            m_activeTimerID = 0;
-        }
-    } else {
-        m_activeTimerID = ::SetTimer(m_messageWindow, sharedTimerID, dueTime, 0);
-        m_timerQueueTimer = 0;
-    }
-
-    return true;
-}
-
-void HandlerProviderWindow::stop()
-{
-    if (m_timerQueue && m_timerQueueTimer) {
-        ::DeleteTimerQueueTimer(m_timerQueue, m_timerQueueTimer, 0);
-        m_timerQueueTimer = 0;
-    }
-
-    if (m_activeTimerID) {
-        ::KillTimer(m_messageWindow, m_activeTimerID);
-        m_activeTimerID = 0;
-    }
-}
-
 void HandlerProviderWindow::close()
 {
     ::SetWindowLongPtr(m_messageWindow, GWLP_HANDLERPTR(0), 0);
@@ -39,10 +39,6 @@ class HandlerProviderWin : public HandlerProvider {
 public:
     ~HandlerProviderWin();
 
-    bool start() override;
-    bool startAtTime(std::chrono::milliseconds) override;
-    void stop() override;
-
     static HWND messageWindowHandle(HandlerProvider&);
 
 private:
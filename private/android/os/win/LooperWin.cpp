@@ -25,15 +25,23 @@
 
 #include <android/os/Looper.h>
 
+#include <pthread.h>
 #include <windows.h>
 
 namespace android {
 namespace os {
 
+namespace appkit {
+extern pthread_main_np_t mainThreadIdentifier; // ThreadWin.cpp
+}
+
 static thread_local bool isMainThreadLooper = false;
 
 void Looper::platformLooperPrepareMain()
 {
+    pthread_init_main_np();
+    appkit::mainThreadIdentifier = pthread_get_main_np();
+
     isMainThreadLooper = true;
 }
 
@@ -25,67 +25,157 @@
 
 #pragma once
 
+#include <android/os/BundlePrivate.h>
 #include <android/os/Message.h>
+#include <android/os/Parcel.h>
 
-#include <array>
-#include <assert.h>
+#include <Windows.h>
 
 namespace android {
 namespace os {
 
+// Messages sent to a message window travel as WM_COPYDATA, a compact header followed by the Bundle.
+// Large Bundles go out-of-line, into a file mapping of the sender which the receiver duplicates
+// read-only while the sender waits, so that neither side copies them into the message itself.
 struct MessageCopyData {
-    static const size_t sizeLimit = 1024; // 4K
-
-    enum DataField {
-        MessageWhat,
-        MessageArg1,
-        MessageArg2,
-        MessageObj,
-        MessageBundleSize,
-        MessageBundleData,
+    // Bundles larger than this go out-of-line.
+    static const size_t inlineLimit = 16 * 1024;
+
+    struct Header {
+        int32_t what;
+        int32_t arg1;
+        int32_t arg2;
+        int32_t requestId;
+        int64_t obj;
+        uint32_t bundleSize;
+        uint32_t flags;
+        // The file mapping of an out-of-line Bundle, as a handle of the sending process.
+        uint64_t bundleMapping;
+    };
+
+    enum Flags {
+        BundleOutOfLine = 1 << 0,
     };
 
-    typedef std::array<intptr_t, sizeLimit> Data;
+    typedef Parcel Data;
 
-    static size_t pack(Data&, Message&);
-    static bool unpack(Message&, const Data&);
+    static bool pack(Data&, Message&);
+    // Reads a message sent by the process senderProcessIdentifier, duplicating its file mapping if any.
+    static bool unpack(Message&, const void* data, size_t size, DWORD senderProcessIdentifier);
+    // Closes the file mapping of a message once it was sent, or could not be.
+    static void release(const Data&);
 };
 
-inline size_t MessageCopyData::pack(Data& out, Message& in)
+inline bool MessageCopyData::pack(Data& out, Message& in)
 {
-    out[MessageWhat] = in.what;
-    out[MessageArg1] = in.arg1;
-    out[MessageArg2] = in.arg2;
-    out[MessageObj] = in.obj;
+    Header header;
+    header.what = in.what;
+    header.arg1 = in.arg1;
+    header.arg2 = in.arg2;
+    header.requestId = in.getRequestId();
+    header.obj = in.obj;
+    header.bundleSize = 0;
+    header.flags = 0;
+    header.bundleMapping = 0;
 
-    intptr_t messageBundleSize = 0;
-    Parcel parcel;
-    if (in.peekData()) {
-        in.peekData()->writeToParcel(parcel, 0);
-        assert(parcel.size() < (sizeLimit - MessageBundleData) * sizeof(intptr_t));
-        messageBundleSize = parcel.size();
-        if (messageBundleSize > 0)
-            memcpy(&out[MessageBundleData], parcel.data(), messageBundleSize);
+    // The header is written again once the size of the Bundle is known.
+    out.freeData();
+    out.write(&header, sizeof(header));
+
+    // Bundles which may not fit inline are parceled straight into a file mapping sized for them.
+    Bundle* bundle = in.peekData();
+    size_t capacity = bundle ? BundlePrivate::parcelCapacity(*bundle) : 0;
+    if (capacity > inlineLimit) {
+        HANDLE mapping = ::CreateFileMappingW(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE, 0, static_cast<DWORD>(capacity), NULL);
+        if (!mapping)
+            return false;
+
+        void* view = ::MapViewOfFile(mapping, FILE_MAP_WRITE, 0, 0, capacity);
+        if (!view) {
+            ::CloseHandle(mapping);
+            return false;
+        }
+
+        Parcel parcel;
+        parcel.setDataBuffer(view, capacity);
+        bundle->writeToParcel(parcel, 0);
+        // The capacity is an upper bound, so the parcel never has to move out of the view.
+        bool inPlace = parcel.data() == view;
+        header.bundleSize = static_cast<uint32_t>(parcel.dataSize());
+        parcel.freeData();
+        ::UnmapViewOfFile(view);
+        if (!inPlace) {
+            ::CloseHandle(mapping);
+            return false;
+        }
+
+        // The receiver duplicates the handle with read access only, this process closes it in release().
+        header.flags |= BundleOutOfLine;
+        header.bundleMapping = reinterpret_cast<uint64_t>(mapping);
+    } else if (bundle) {
+        bundle->writeToParcel(out, 0);
+        header.bundleSize = static_cast<uint32_t>(out.dataSize() - sizeof(header));
     }
 
-    out[MessageBundleSize] = messageBundleSize;
-    return sizeof(intptr_t) * MessageBundleData + messageBundleSize;
+    out.setDataPosition(0);
+    out.write(&header, sizeof(header));
+    return true;
 }
 
-inline bool MessageCopyData::unpack(Message& out, const Data& in)
+inline bool MessageCopyData::unpack(Message& out, const void* data, size_t size, DWORD senderProcessIdentifier)
 {
-    out = Message::obtain(nullptr, in[MessageWhat], in[MessageArg1], in[MessageArg2], in[MessageObj]);
+    // The Bundle is read in place, from the message or from the view of its file mapping.
+    Parcel parcel;
+    parcel.setDataReference(data, size);
 
-    if (in[MessageBundleSize] > 0) {
-        Parcel parcel;
-        const char* dataBegin = reinterpret_cast<const char*>(&in[MessageBundleData]);
-        const char* dataEnd = dataBegin + in[MessageBundleSize];
-        parcel.insert(parcel.end(), dataBegin, dataEnd);
+    Header header;
+    if (!parcel.read(&header, sizeof(header)))
+        return false;
+
+    bool outOfLine = header.flags & BundleOutOfLine;
+    if (size != sizeof(header) + (outOfLine ? 0 : header.bundleSize))
+        return false;
+
+    out = Message::obtain(nullptr, header.what, header.arg1, header.arg2, static_cast<intptr_t>(header.obj));
+    out.setRequestId(header.requestId);
+
+    if (!header.bundleSize)
+        return true;
+
+    if (!outOfLine) {
         out.getData().readFromParcel(parcel);
+        return true;
     }
 
+    // The handle is only valid in the sender, which keeps it open until this message returns.
+    HANDLE senderProcess = ::OpenProcess(PROCESS_DUP_HANDLE, FALSE, senderProcessIdentifier);
+    if (!senderProcess)
+        return false;
+
+    HANDLE mapping = NULL;
+    BOOL duplicated = ::DuplicateHandle(senderProcess, reinterpret_cast<HANDLE>(header.bundleMapping), ::GetCurrentProcess(), &mapping, FILE_MAP_READ, FALSE, 0);
+    ::CloseHandle(senderProcess);
+    if (!duplicated)
+        return false;
+
+    const void* view = ::MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, header.bundleSize);
+    ::CloseHandle(mapping);
+    if (!view)
+        return false;
+
+    parcel.setDataReference(view, header.bundleSize);
+    out.getData().readFromParcel(parcel);
+    ::UnmapViewOfFile(view);
+
     return true;
 }
 
+inline void MessageCopyData::release(const Data& data)
+{
+    const Header& header = *reinterpret_cast<const Header*>(data.data());
+    if (header.flags & BundleOutOfLine)
+        ::CloseHandle(reinterpret_cast<HANDLE>(header.bundleMapping));
+}
+
 } // namespace os
 } // namespace android
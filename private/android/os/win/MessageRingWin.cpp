@@ -0,0 +1,73 @@
+/*
+ * Copyright (C) 2016 Naver Corp. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <android/os/MessageRing.h>
+
+namespace android {
+namespace os {
+
+// FIXME: The Looper of Windows cannot wait for events yet, so messages keep going through the message window.
+bool MessageRing::platformCreateMemory(size_t size, Memory& memory)
+{
+    return false;
+}
+
+bool MessageRing::platformMapMemory(int32_t fd, Memory& memory)
+{
+    return false;
+}
+
+void MessageRing::platformUnmapMemory(Memory& memory)
+{
+}
+
+int32_t MessageRing::platformCreateEvent()
+{
+    return -1;
+}
+
+void MessageRing::platformSignalEvent(int32_t event)
+{
+}
+
+void MessageRing::platformClearEvent(int32_t event)
+{
+}
+
+void MessageRing::platformCloseEvent(int32_t event)
+{
+}
+
+int32_t MessageRing::platformDuplicateDescriptor(int32_t fd)
+{
+    return -1;
+}
+
+void MessageRing::platformCloseDescriptor(int32_t fd)
+{
+}
+
+} // namespace os
+} // namespace android
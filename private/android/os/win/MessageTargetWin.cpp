@@ -30,7 +30,7 @@
 #include <android/os/Message.h>
 #include <android/os/Messenger.h>
 
-#include <array>
+#include <platforms/LogHelper.h>
 
 #include <assert>
 
@@ -66,8 +66,12 @@ void DataCopyWindowMessageTarget::send(Message& message)
 {
     COPYDATASTRUCT data;
     MessageCopyData::Data values;
+    if (!MessageCopyData::pack(values, message)) {
+        LOGW("Message %d is dropped, its Bundle could not be shared", message.what);
+        return;
+    }
     data.dwData = (ULONG_PTR)m_processIdentifier;
-    data.cbData = MessageCopyData::pack(values, message);
+    data.cbData = static_cast<DWORD>(values.dataSize());
     data.lpData = (PVOID)values.data();
     while (!::SendMessageTimeoutA(m_target, WM_COPYDATA, (WPARAM)message.replyTo->getBinder(), (LPARAM)&data,
         SMTO_ABORTIFHUNG | SMTO_NOTIMEOUTIFNOTHUNG | SMTO_ERRORONEXIT, 1, NULL)) {
@@ -79,8 +83,11 @@ void DataCopyWindowMessageTarget::send(Message& message)
             // FIXME: Figure out whether the target window is actually invalid or not.
             continue;
         // FIXME: Do something!
+        MessageCopyData::release(values);
         assert(false);
+        return;
     }
+    MessageCopyData::release(values);
 }
 
 IBinder DataCopyWindowMessageTarget::handle() const
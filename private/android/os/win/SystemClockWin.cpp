@@ -0,0 +1,77 @@
+/*
+ * Copyright (C) 2016 Naver Corp. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <android/os/SystemClock.h>
+
+#include <mutex>
+
+#include <windows.h>
+
+namespace android {
+namespace os {
+
+static std::chrono::nanoseconds performanceCounterNanos()
+{
+    static LARGE_INTEGER frequency;
+    static std::once_flag onceFlag;
+    std::call_once(onceFlag, [] {
+        ::QueryPerformanceFrequency(&frequency);
+    });
+
+    LARGE_INTEGER counter;
+    ::QueryPerformanceCounter(&counter);
+
+    // Split the conversion to avoid overflowing the intermediate product.
+    int64_t seconds = counter.QuadPart / frequency.QuadPart;
+    int64_t remainder = counter.QuadPart % frequency.QuadPart;
+    return std::chrono::seconds(seconds) + std::chrono::nanoseconds(remainder * 1000000000 / frequency.QuadPart);
+}
+
+// QueryUnbiasedInterruptTime() excludes sleep but only advances with the system timer tick,
+// so the uptime clock uses the performance counter as well to keep sub-millisecond resolution.
+std::chrono::nanoseconds SystemClock::platformUptimeNanos()
+{
+    return performanceCounterNanos();
+}
+
+std::chrono::nanoseconds SystemClock::platformElapsedRealtimeNanos()
+{
+    return performanceCounterNanos();
+}
+
+std::chrono::nanoseconds SystemClock::currentThreadTimeNanos()
+{
+    FILETIME creationTime, exitTime, kernelTime, userTime;
+    if (!::GetThreadTimes(::GetCurrentThread(), &creationTime, &exitTime, &kernelTime, &userTime))
+        return std::chrono::nanoseconds::zero();
+
+    // FILETIME counts 100ns intervals.
+    uint64_t kernel = (static_cast<uint64_t>(kernelTime.dwHighDateTime) << 32) | kernelTime.dwLowDateTime;
+    uint64_t user = (static_cast<uint64_t>(userTime.dwHighDateTime) << 32) | userTime.dwLowDateTime;
+    return std::chrono::nanoseconds((kernel + user) * 100);
+}
+
+} // namespace os
+} // namespace android
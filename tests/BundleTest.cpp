@@ -0,0 +1,219 @@
+/*
+ * Copyright (C) 2016 Naver Corp. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "TestHelper.h"
+
+#include <android/os/Bundle.h>
+
+#include <vector>
+
+static Bundle roundTrip(Bundle& bundle)
+{
+    Parcel parcel;
+    bundle.writeToParcel(parcel, 0);
+    parcel.setDataPosition(0);
+    Bundle result;
+    result.readFromParcel(parcel);
+    return result;
+}
+
+static void putEveryType(Bundle& bundle)
+{
+    bundle.putBoolean(L"boolean", true);
+    bundle.putInt(L"int", INT32_MIN);
+    bundle.putLong(L"long", INT64_MAX);
+    bundle.putFloat(L"float", -0.5f);
+    bundle.putDouble(L"double", 1e-300);
+    bundle.putString(L"string", L"한글 \U0001F600");
+    bundle.putString(L"empty", String());
+    bundle.putByteArray(L"bytes", { -128, 0, 127 });
+    bundle.putBooleanArray(L"booleans", { true, false, true });
+    bundle.putIntArray(L"ints", { 1, -2, 3 });
+    bundle.putIntArray(L"no ints", { });
+    bundle.putLongArray(L"longs", { INT64_MIN, 0 });
+    bundle.putFloatArray(L"floats", { 0.25f });
+    bundle.putDoubleArray(L"doubles", { -1.5, 2.5 });
+    bundle.putStringArray(L"strings", { L"a", String(), L"\U0001F600" });
+    bundle.putFileDescriptor(L"fd", 5);
+}
+
+static bool hasEveryType(Bundle& bundle)
+{
+    return bundle.getBoolean(L"boolean")
+        && bundle.getInt(L"int") == INT32_MIN
+        && bundle.getLong(L"long") == INT64_MAX
+        && bundle.getFloat(L"float") == -0.5f
+        && bundle.getDouble(L"double") == 1e-300
+        && bundle.getString(L"string") == L"한글 \U0001F600"
+        && bundle.containsKey(L"empty") && bundle.getString(L"empty", L"default").empty()
+        && bundle.getByteArray(L"bytes") == std::vector<int8_t>({ -128, 0, 127 })
+        && bundle.getBooleanArray(L"booleans") == std::vector<bool>({ true, false, true })
+        && bundle.getIntArray(L"ints") == std::vector<int32_t>({ 1, -2, 3 })
+        && bundle.containsKey(L"no ints") && bundle.getIntArray(L"no ints").empty()
+        && bundle.getLongArray(L"longs") == std::vector<int64_t>({ INT64_MIN, 0 })
+        && bundle.getFloatArray(L"floats") == std::vector<float>({ 0.25f })
+        && bundle.getDoubleArray(L"doubles") == std::vector<double>({ -1.5, 2.5 })
+        && bundle.getStringArray(L"strings") == std::vector<String>({ L"a", String(), L"\U0001F600" })
+        && bundle.getFileDescriptor(L"fd") == 5;
+}
+
+// Every type, nested Bundles included, reads back from a parcel as it was put in.
+static void testRoundTrip()
+{
+    Bundle bundle;
+    putEveryType(bundle);
+    EXPECT(hasEveryType(bundle));
+
+    Bundle inner;
+    inner.putInt(L"depth", 2);
+    inner.putFileDescriptor(L"fd", 6);
+    Bundle nested;
+    putEveryType(nested);
+    nested.putBundle(L"inner", inner);
+    bundle.putBundle(L"nested", nested);
+
+    Bundle result = roundTrip(bundle);
+    EXPECT(result.size() == bundle.size());
+    EXPECT(result.keySet() == bundle.keySet());
+    EXPECT(hasEveryType(result));
+    Bundle resultNested = result.getBundle(L"nested");
+    EXPECT(hasEveryType(resultNested));
+    EXPECT(resultNested.getBundle(L"inner").getInt(L"depth") == 2);
+    EXPECT(resultNested.getBundle(L"inner").getFileDescriptor(L"fd") == 6);
+
+    EXPECT(roundTrip(inner).keySet() == std::vector<String>({ L"depth", L"fd" }));
+    Bundle empty;
+    EXPECT(roundTrip(empty).isEmpty());
+}
+
+// Keys are kept sorted and unique, values of the wrong type read as the default, and values replaced
+// over and over stay intact as the storage is compacted.
+static void testMapping()
+{
+    Bundle bundle;
+    bundle.putString(L"b", L"second");
+    bundle.putInt(L"a", 1);
+    bundle.putInt(L"c", 3);
+    EXPECT(bundle.keySet() == std::vector<String>({ L"a", L"b", L"c" }));
+
+    bundle.putString(L"a", L"replaced");
+    EXPECT(bundle.size() == 3);
+    EXPECT(bundle.getInt(L"a", -1) == -1);
+    EXPECT(bundle.getString(L"a") == L"replaced");
+    EXPECT(bundle.getFileDescriptor(L"a") == -1);
+
+    bundle.remove(L"b");
+    EXPECT(!bundle.containsKey(L"b"));
+    EXPECT(bundle.getString(L"b", L"default") == L"default");
+
+    for (int32_t i = 0; i < 1000; ++i)
+        bundle.putString(L"a", String(i % 100, L'x'));
+    EXPECT(bundle.getString(L"a") == String(99, L'x'));
+    EXPECT(bundle.getInt(L"c") == 3);
+
+    // A nested Bundle is copied when it is put in.
+    Bundle nested;
+    nested.putInt(L"value", 1);
+    bundle.putBundle(L"nested", nested);
+    nested.putInt(L"value", 2);
+    EXPECT(bundle.getBundle(L"nested").getInt(L"value") == 1);
+
+    bundle.clear();
+    EXPECT(bundle.isEmpty());
+}
+
+static bool readsNested(size_t depth)
+{
+    std::vector<Bundle> chain(depth + 1);
+    chain[depth].putInt(L"leaf", 7);
+    for (size_t i = depth; i > 0; --i)
+        chain[i - 1].putBundle(L"nested", chain[i]);
+    return !roundTrip(chain[0]).isEmpty();
+}
+
+// Bundles nested deeper than the parcel format allows leave the Bundle empty, instead of
+// exhausting the stack of the reader.
+static void testNestingLimit()
+{
+    EXPECT(readsNested(64));
+    EXPECT(!readsNested(65));
+}
+
+// Truncated or corrupted parcels leave the Bundle empty.
+static void testMalformedParcels()
+{
+    Bundle bundle;
+    putEveryType(bundle);
+    Parcel parcel;
+    bundle.writeToParcel(parcel, 0);
+
+    size_t accepted = 0;
+    for (size_t size = 0; size < parcel.dataSize(); size += 4) {
+        Parcel truncated;
+        truncated.setDataReference(parcel.data(), size);
+        truncated.setFileDescriptors(parcel.fileDescriptors());
+        Bundle result;
+        result.readFromParcel(truncated);
+        accepted += !result.isEmpty();
+    }
+    EXPECT(!accepted);
+
+    // An unknown type, and a count of entries beyond the data.
+    Parcel unknownType;
+    unknownType.writeInt32(1);
+    unknownType.writeString16(String(L"key"));
+    unknownType.writeInt32(1000);
+    unknownType.writeInt32(0);
+    unknownType.setDataPosition(0);
+    Bundle result;
+    result.readFromParcel(unknownType);
+    EXPECT(result.isEmpty());
+
+    Parcel tooMany;
+    tooMany.writeInt32(INT32_MAX);
+    tooMany.setDataPosition(0);
+    result.readFromParcel(tooMany);
+    EXPECT(result.isEmpty());
+
+    // A descriptor index past the descriptors sent along.
+    Bundle descriptor;
+    descriptor.putFileDescriptor(L"fd", 5);
+    Parcel missingDescriptor;
+    descriptor.writeToParcel(missingDescriptor, 0);
+    missingDescriptor.setFileDescriptors(std::vector<int32_t>());
+    missingDescriptor.setDataPosition(0);
+    result.readFromParcel(missingDescriptor);
+    EXPECT(result.getFileDescriptor(L"fd") == -1);
+}
+
+int main()
+{
+    testRoundTrip();
+    testMapping();
+    testNestingLimit();
+    testMalformedParcels();
+
+    return testResult("BundleTest");
+}
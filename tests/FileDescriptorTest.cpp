@@ -0,0 +1,196 @@
+/*
+ * Copyright (C) 2016 Naver Corp. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "TestHelper.h"
+
+#include <android/os/Handler.h>
+#include <android/os/Looper.h>
+#include <android/os/MessageQueue.h>
+
+#include <functional>
+#include <sys/eventfd.h>
+#include <thread>
+#include <unistd.h>
+
+typedef MessageQueue::OnFileDescriptorEventListener Listener;
+
+class FunctionListener : public Listener {
+public:
+    explicit FunctionListener(std::function<int32_t (int32_t, int32_t)> function)
+        : m_function(std::move(function))
+    {
+    }
+
+    int32_t onFileDescriptorEvents(int32_t fd, int32_t events) override { return m_function(fd, events); }
+
+private:
+    std::function<int32_t (int32_t, int32_t)> m_function;
+};
+
+static void writeByte(int32_t fd)
+{
+    char value = 'x';
+    EXPECT(::write(fd, &value, 1) == 1);
+}
+
+// Level triggered listeners are called as long as the pipe has data, edge triggered ones only when data arrives.
+static void testLevelAndEdge()
+{
+    int32_t level[2];
+    int32_t edge[2];
+    EXPECT(!::pipe(level) && !::pipe(edge));
+    writeByte(level[1]);
+    writeByte(edge[1]);
+
+    MessageQueue& queue = Looper::myQueue();
+    int32_t levelCalls = 0;
+    int32_t edgeCalls = 0;
+    // Neither listener reads, so only the level triggered one is called again for the same byte.
+    EXPECT(queue.addOnFileDescriptorEventListener(level[0], Listener::EVENT_INPUT,
+        std::make_shared<FunctionListener>([&levelCalls] (int32_t, int32_t events) {
+            EXPECT(events & Listener::EVENT_INPUT);
+            return ++levelCalls < 3 ? Listener::EVENT_INPUT : 0;
+        })));
+    EXPECT(queue.addOnFileDescriptorEventListener(edge[0], Listener::EVENT_INPUT,
+        std::make_shared<FunctionListener>([&edgeCalls] (int32_t, int32_t events) {
+            EXPECT(events & Listener::EVENT_INPUT);
+            ++edgeCalls;
+            return Listener::EVENT_INPUT;
+        }), MessageQueue::TriggerMode::Edge));
+
+    std::shared_ptr<Handler> handler = Handler::create();
+    handler->postDelayed([&] {
+        EXPECT(edgeCalls == 1);
+        writeByte(edge[1]);
+    }, std::chrono::milliseconds(50));
+    handler->postDelayed([&] {
+        queue.removeOnFileDescriptorEventListener(edge[0]);
+        Looper::myLooper()->quit();
+    }, std::chrono::milliseconds(100));
+    Looper::loop();
+
+    EXPECT(levelCalls == 3);
+    EXPECT(edgeCalls == 2);
+    for (int32_t fd : { level[0], level[1], edge[0], edge[1] })
+        ::close(fd);
+}
+
+// Callbacks given a Handler run as its work, here held back by a sync barrier, and are not reported
+// again while they wait, even though the eventfd stays readable.
+static void testHandlerCallbacks()
+{
+    int32_t fd = ::eventfd(1, EFD_CLOEXEC | EFD_NONBLOCK);
+    EXPECT(fd >= 0);
+
+    Looper& looper = *Looper::myLooper();
+    std::shared_ptr<Handler> handler = Handler::create();
+    std::shared_ptr<Handler> asyncHandler = Handler::createAsync();
+    int32_t barrier = looper.getQueue().postSyncBarrier();
+    int32_t calls = 0;
+    EXPECT(looper.addFd(fd, Listener::EVENT_INPUT, MessageQueue::TriggerMode::Level, [&] (int32_t, int32_t) {
+        ++calls;
+        uint64_t value;
+        EXPECT(::read(fd, &value, sizeof(value)) == sizeof(value));
+        if (calls == 1) {
+            asyncHandler->postDelayed([fd] {
+                uint64_t value = 1;
+                EXPECT(::write(fd, &value, sizeof(value)) == sizeof(value));
+            }, std::chrono::milliseconds(10));
+            return Listener::EVENT_INPUT;
+        }
+        looper.quit();
+        return 0;
+    }, handler));
+
+    asyncHandler->postDelayed([&] {
+        EXPECT(calls == 0);
+        looper.getQueue().removeSyncBarrier(barrier);
+    }, std::chrono::milliseconds(50));
+    asyncHandler->postDelayed([&] { looper.quit(); }, std::chrono::seconds(10));
+    Looper::loop();
+
+    EXPECT(calls == 2);
+    ::close(fd);
+}
+
+// A callback which was posted before its file descriptor was added again must not act on the new
+// registration, such as removing it by returning 0.
+static void testStaleCallbackAfterReAdd()
+{
+    int32_t fd = ::eventfd(1, EFD_CLOEXEC | EFD_NONBLOCK);
+    EXPECT(fd >= 0);
+
+    Looper& looper = *Looper::myLooper();
+    std::shared_ptr<Handler> handler = Handler::create();
+    std::shared_ptr<Handler> asyncHandler = Handler::createAsync();
+    int32_t barrier = looper.getQueue().postSyncBarrier();
+    int32_t staleCalls = 0;
+    int32_t newCalls = 0;
+    EXPECT(looper.addFd(fd, Listener::EVENT_INPUT, MessageQueue::TriggerMode::Level, [&] (int32_t, int32_t) {
+        ++staleCalls;
+        return 0;
+    }, handler));
+
+    // By then the first callback waits behind the barrier. It runs right after the barrier is removed,
+    // before the new callback is called for the eventfd, which stays readable.
+    asyncHandler->postDelayed([&] {
+        looper.removeFd(fd);
+        EXPECT(looper.addFd(fd, Listener::EVENT_INPUT, MessageQueue::TriggerMode::Level, [&] (int32_t, int32_t) {
+            ++newCalls;
+            uint64_t value;
+            EXPECT(::read(fd, &value, sizeof(value)) == sizeof(value));
+            looper.quit();
+            return 0;
+        }, handler));
+        looper.getQueue().removeSyncBarrier(barrier);
+    }, std::chrono::milliseconds(50));
+    asyncHandler->postDelayed([&] {
+        looper.removeFd(fd);
+        looper.quit();
+    }, std::chrono::seconds(10));
+    Looper::loop();
+
+    EXPECT(staleCalls == 1);
+    EXPECT(newCalls == 1);
+    ::close(fd);
+}
+
+static void runOnLooperThread(void (*test)())
+{
+    std::thread([test] {
+        Looper::prepare();
+        test();
+    }).join();
+}
+
+// Each test runs on a thread of its own, as the Looper of a thread is gone once loop() returns.
+int main()
+{
+    runOnLooperThread(testLevelAndEdge);
+    runOnLooperThread(testHandlerCallbacks);
+    runOnLooperThread(testStaleCallbackAfterReAdd);
+
+    return testResult("FileDescriptorTest");
+}
@@ -0,0 +1,106 @@
+/*
+ * Copyright (C) 2016 Naver Corp. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "TestHelper.h"
+
+#include <android/os/Future.h>
+#include <android/os/Handler.h>
+#include <android/os/Looper.h>
+#include <android/os/SystemClock.h>
+
+// The Future is cancelled once the last copy of its Promise is gone without setting the value.
+static void testDroppedPromiseCancelsFuture()
+{
+    Future<int32_t> future;
+    {
+        Promise<int32_t> promise;
+        future = promise.getFuture();
+        {
+            Promise<int32_t> copy = promise;
+        }
+        EXPECT(!future.isCancelled() && !future.isDone());
+    }
+    EXPECT(future.isCancelled() && !future.isDone());
+    EXPECT(future.get() == 0);
+}
+
+// then() runs its function on the Looper of the Handler, and its result is cancelled instead
+// if the Handler is gone, either when the value is set or before the function got to run.
+static void testThenOnDestroyedHandlerCancels()
+{
+    std::shared_ptr<Handler> handler = Handler::create();
+    Promise<int32_t> promise;
+    Future<int32_t> result = promise.getFuture().then(handler, [] (int32_t value) { return value + 1; });
+    promise.setValue(1);
+    EXPECT(!result.isDone());
+    Looper::myLooper()->idle();
+    EXPECT(result.isDone() && result.get() == 2);
+
+    Promise<int32_t> gonePromise;
+    Future<int32_t> goneResult = gonePromise.getFuture().then(handler, [] (int32_t value) { return value + 1; });
+    handler.reset();
+    gonePromise.setValue(1);
+    EXPECT(goneResult.isCancelled());
+
+    handler = Handler::create();
+    Promise<int32_t> pendingPromise;
+    Future<int32_t> pendingResult = pendingPromise.getFuture().then(handler, [] (int32_t value) { return value + 1; });
+    pendingPromise.setValue(1);
+    EXPECT(!pendingResult.isCancelled());
+    handler.reset();
+    Looper::myLooper()->idle();
+    EXPECT(pendingResult.isCancelled());
+}
+
+// Futures of void only tell that the function ran, and chain like any other.
+static void testPostForResultVoid()
+{
+    std::shared_ptr<Handler> handler = Handler::create();
+    bool ran = false;
+    Future<void> future = handler->postForResult<void>([&ran] { ran = true; });
+    EXPECT(future.isValid() && !future.isDone());
+
+    Future<int32_t> chained = future.then(handler, [&ran] { return ran ? 1 : 0; });
+    Looper::myLooper()->idle();
+    EXPECT(ran);
+    EXPECT(chained.isDone() && chained.get() == 1);
+
+    Future<void> done = handler->postForResult<void>([] { });
+    Looper::myLooper()->idle();
+    EXPECT(done.isDone() && !done.isCancelled());
+    done.get();
+}
+
+int main()
+{
+    SystemClock::setVirtualTimeEnabled(true);
+    Looper::prepareMainLooper();
+
+    testDroppedPromiseCancelsFuture();
+    testThenOnDestroyedHandlerCancels();
+    testPostForResultVoid();
+
+    return testResult("FutureTest");
+}
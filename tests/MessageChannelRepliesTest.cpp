@@ -0,0 +1,91 @@
+/*
+ * Copyright (C) 2016 Naver Corp. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "TestHelper.h"
+
+#include <android/os/Future.h>
+#include <android/os/Message.h>
+#include <android/os/appkit/MessageChannelReplies.h>
+
+#include <vector>
+
+// Two pipelined requests answered in the reverse order each get the reply carrying their own request id.
+static void testOutOfOrderReplies()
+{
+    MessageChannelReplies replies;
+    Promise<Message> firstPromise;
+    Promise<Message> secondPromise;
+    Future<Message> first = firstPromise.getFuture();
+    Future<Message> second = secondPromise.getFuture();
+    int32_t firstId = replies.add([firstPromise] (const Message& reply) mutable { firstPromise.setValue(Message(reply)); });
+    int32_t secondId = replies.add([secondPromise] (const Message& reply) mutable { secondPromise.setValue(Message(reply)); });
+    EXPECT(firstId && secondId && firstId != secondId);
+
+    Message secondReply = Message::obtain(nullptr, 2);
+    secondReply.setRequestId(secondId);
+    MessageChannelReplies::Callback onSecondReply = replies.take(secondReply.getRequestId());
+    EXPECT(!!onSecondReply);
+    onSecondReply(secondReply);
+    EXPECT(second.isDone() && !first.isDone());
+
+    Message firstReply = Message::obtain(nullptr, 1);
+    firstReply.setRequestId(firstId);
+    MessageChannelReplies::Callback onFirstReply = replies.take(firstReply.getRequestId());
+    EXPECT(!!onFirstReply);
+    onFirstReply(firstReply);
+
+    Message firstResult = first.get();
+    Message secondResult = second.get();
+    EXPECT(firstResult.what == 1 && firstResult.getRequestId() == firstId);
+    EXPECT(secondResult.what == 2 && secondResult.getRequestId() == secondId);
+
+    // A reply is delivered once, and one to no pending request is left to receive().
+    EXPECT(!replies.take(firstId));
+    EXPECT(!replies.take(secondId + 1));
+}
+
+// Requests still waiting when the channel goes away get an empty reply, and only once.
+static void testFailedReplies()
+{
+    MessageChannelReplies replies;
+    std::vector<int32_t> failed;
+    int32_t first = replies.add([&failed] (const Message& reply) { failed.push_back(reply.what + 1); });
+    replies.add([&failed] (const Message& reply) { failed.push_back(reply.what + 2); });
+    replies.fail(first);
+    replies.fail(first);
+    EXPECT(failed == std::vector<int32_t>({ 1 }));
+
+    replies.failAll();
+    replies.failAll();
+    EXPECT(failed == std::vector<int32_t>({ 1, 2 }));
+}
+
+int main()
+{
+    testOutOfOrderReplies();
+    testFailedReplies();
+
+    return testResult("MessageChannelRepliesTest");
+}
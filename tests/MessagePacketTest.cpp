@@ -0,0 +1,239 @@
+/*
+ * Copyright (C) 2016 Naver Corp. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "TestHelper.h"
+
+#include <android/os/linux/MessagePacket.h>
+
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using android::os::MessagePacket;
+
+static bool isOpen(int32_t fd)
+{
+    return ::fcntl(fd, F_GETFD) >= 0;
+}
+
+static bool transfer(int32_t sockets[2], Message& sent, Message& received, MessagePacket::Messengers& replyTo)
+{
+    MessagePacket packet;
+    if (!MessagePacket::pack(packet, sent))
+        return false;
+    if (MessagePacket::send(sockets[0], packet) != MessagePacket::Result::Done)
+        return false;
+
+    MessagePacket receivedPacket;
+    if (MessagePacket::receive(sockets[1], receivedPacket) != MessagePacket::Result::Done)
+        return false;
+    return MessagePacket::unpack(received, receivedPacket, replyTo);
+}
+
+// The fields of the message and a small Bundle travel inline in the packet.
+static void testInlineRoundTrip(int32_t sockets[2])
+{
+    MessagePacket::Messengers replyTo;
+    Messenger sender(MessagePacket::binder(::getpid(), 1));
+
+    Message sent = Message::obtain(nullptr, 1, 2, 3, 4);
+    sent.setRequestId(5);
+    sent.replyTo = &sender;
+    sent.getData().putInt(L"int", -7);
+    sent.getData().putString(L"string", L"inline");
+    Bundle nested;
+    nested.putDouble(L"double", 0.5);
+    sent.getData().putBundle(L"nested", nested);
+
+    Message received;
+    EXPECT(transfer(sockets, sent, received, replyTo));
+    EXPECT(received.what == 1 && received.arg1 == 2 && received.arg2 == 3 && received.obj == 4);
+    EXPECT(received.getRequestId() == 5);
+    EXPECT(received.replyTo && received.replyTo->getBinder() == sender.getBinder());
+    EXPECT(received.getData().getInt(L"int") == -7);
+    EXPECT(received.getData().getString(L"string") == L"inline");
+    EXPECT(received.getData().getBundle(L"nested").getDouble(L"double") == 0.5);
+
+    // Messages from the same sender share one replyTo Messenger.
+    Message again;
+    EXPECT(transfer(sockets, sent, again, replyTo));
+    EXPECT(again.replyTo == received.replyTo);
+    EXPECT(replyTo.size() == 1);
+}
+
+// A large Bundle goes out-of-line through a sealed memfd, and arrives unchanged.
+static void testOutOfLineRoundTrip(int32_t sockets[2])
+{
+    MessagePacket::Messengers replyTo;
+    Message sent = Message::obtain(nullptr, 1, 0, 0);
+    std::vector<int32_t> values(MessagePacket::inlineLimit);
+    for (size_t i = 0; i < values.size(); ++i)
+        values[i] = static_cast<int32_t>(i * 2654435761u);
+    sent.getData().putIntArray(L"values", values);
+
+    MessagePacket packet;
+    EXPECT(MessagePacket::pack(packet, sent));
+    EXPECT(packet.payload >= 0);
+    EXPECT(packet.data.dataSize() == sizeof(MessagePacket::Header));
+
+    Message received;
+    EXPECT(transfer(sockets, sent, received, replyTo));
+    EXPECT(received.getData().getIntArray(L"values") == values);
+}
+
+// Out-of-line Bundles are parceled straight into their memfd, which is trimmed to the size of the Bundle.
+static void testOutOfLineStrings(int32_t sockets[2])
+{
+    MessagePacket::Messengers replyTo;
+    Message sent = Message::obtain(nullptr, 1, 0, 0);
+    String text(MessagePacket::inlineLimit, L'a');
+    text += L"\u00e9\u4e2d\U0001F600";
+    std::vector<String> strings(64, L"\u00e9t\u00e9");
+    Bundle nested;
+    nested.putString(L"text", text);
+    nested.putStringArray(L"strings", strings);
+    sent.getData().putBundle(L"nested", nested);
+    sent.getData().putLong(L"long", -1);
+
+    MessagePacket packet;
+    EXPECT(MessagePacket::pack(packet, sent));
+    EXPECT(packet.payload >= 0);
+    MessagePacket::Header header;
+    memcpy(&header, packet.data.data(), sizeof(header));
+    struct stat status;
+    EXPECT(!::fstat(packet.payload, &status) && status.st_size == header.bundleSize);
+
+    Message received;
+    EXPECT(transfer(sockets, sent, received, replyTo));
+    EXPECT(received.getData().getLong(L"long") == -1);
+    EXPECT(received.getData().getBundle(L"nested").getString(L"text") == text);
+    EXPECT(received.getData().getBundle(L"nested").getStringArray(L"strings") == strings);
+}
+
+// Descriptors of the Bundle arrive as descriptors of the receiver, and those the Bundle does not hold are closed.
+static void testFileDescriptors(int32_t sockets[2])
+{
+    MessagePacket::Messengers replyTo;
+    int32_t pipe[2];
+    EXPECT(!::pipe(pipe));
+    EXPECT(::write(pipe[1], "x", 1) == 1);
+
+    Message sent = Message::obtain(nullptr, 1, 0, 0);
+    sent.getData().putFileDescriptor(L"fd", pipe[0]);
+    Message received;
+    EXPECT(transfer(sockets, sent, received, replyTo));
+    int32_t fd = received.getData().getFileDescriptor(L"fd");
+    char value = 0;
+    EXPECT(fd >= 0 && fd != pipe[0]);
+    EXPECT(::read(fd, &value, 1) == 1 && value == 'x');
+    ::close(fd);
+
+    // The header counts one descriptor, but the Bundle is empty, so the descriptor is left over.
+    MessagePacket packet;
+    Message empty = Message::obtain(nullptr, 1, 0, 0);
+    MessagePacket::pack(packet, empty);
+    MessagePacket::Header header;
+    memcpy(&header, packet.data.data(), sizeof(header));
+    header.fileDescriptorCount = 1;
+    packet.data.setDataPosition(0);
+    packet.data.write(&header, sizeof(header));
+    packet.fileDescriptors.push_back(pipe[0]);
+    EXPECT(MessagePacket::send(sockets[0], packet) == MessagePacket::Result::Done);
+
+    MessagePacket receivedPacket;
+    EXPECT(MessagePacket::receive(sockets[1], receivedPacket) == MessagePacket::Result::Done);
+    EXPECT(receivedPacket.fileDescriptors.size() == 1);
+    int32_t leftOver = receivedPacket.fileDescriptors.empty() ? -1 : receivedPacket.fileDescriptors[0];
+    EXPECT(MessagePacket::unpack(received, receivedPacket, replyTo));
+    EXPECT(receivedPacket.fileDescriptors.empty());
+    EXPECT(!isOpen(leftOver));
+
+    ::close(pipe[0]);
+    ::close(pipe[1]);
+}
+
+// A Bundle with more descriptors than one packet can pass is not packed, and nothing is sent.
+static void testFileDescriptorLimit()
+{
+    Message sent = Message::obtain(nullptr, 1, 0, 0);
+    for (size_t i = 0; i <= MessagePacket::fileDescriptorLimit; ++i)
+        sent.getData().putFileDescriptor(std::to_wstring(i), STDIN_FILENO);
+
+    MessagePacket packet;
+    EXPECT(!MessagePacket::pack(packet, sent));
+    EXPECT(packet.fileDescriptors.empty() && packet.payload < 0);
+
+    sent.getData().remove(L"0");
+    EXPECT(MessagePacket::pack(packet, sent));
+    EXPECT(packet.fileDescriptors.size() == MessagePacket::fileDescriptorLimit);
+}
+
+// Packets whose size or descriptor count does not match their header are rejected.
+static void testMalformedPackets()
+{
+    MessagePacket::Messengers replyTo;
+    Message sent = Message::obtain(nullptr, 1, 0, 0);
+    sent.getData().putString(L"string", L"value");
+    Message received;
+
+    MessagePacket truncated;
+    MessagePacket::pack(truncated, sent);
+    truncated.data.setDataSize(truncated.data.dataSize() - 4);
+    EXPECT(!MessagePacket::unpack(received, truncated, replyTo));
+
+    MessagePacket shortHeader;
+    MessagePacket::pack(shortHeader, sent);
+    shortHeader.data.setDataSize(sizeof(MessagePacket::Header) - 1);
+    EXPECT(!MessagePacket::unpack(received, shortHeader, replyTo));
+
+    MessagePacket missingDescriptor;
+    MessagePacket::pack(missingDescriptor, sent);
+    MessagePacket::Header header;
+    memcpy(&header, missingDescriptor.data.data(), sizeof(header));
+    header.fileDescriptorCount = 1;
+    missingDescriptor.data.setDataPosition(0);
+    missingDescriptor.data.write(&header, sizeof(header));
+    EXPECT(!MessagePacket::unpack(received, missingDescriptor, replyTo));
+}
+
+int main()
+{
+    int32_t sockets[2];
+    if (::socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, sockets)) {
+        perror("socketpair");
+        return 1;
+    }
+
+    testInlineRoundTrip(sockets);
+    testOutOfLineRoundTrip(sockets);
+    testOutOfLineStrings(sockets);
+    testFileDescriptors(sockets);
+    testFileDescriptorLimit();
+    testMalformedPackets();
+
+    ::close(sockets[0]);
+    ::close(sockets[1]);
+    return testResult("MessagePacketTest");
+}
@@ -0,0 +1,149 @@
+/*
+ * Copyright (C) 2016 Naver Corp. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "TestHelper.h"
+
+#include <android/os/Handler.h>
+#include <android/os/Looper.h>
+#include <android/os/Message.h>
+#include <android/os/SystemClock.h>
+
+#include <random>
+#include <vector>
+
+struct Dispatch {
+    int32_t index;
+    std::chrono::nanoseconds fireTime;
+    std::chrono::nanoseconds time;
+};
+
+class RecordingHandler : public Handler {
+public:
+    void handleMessage(Message& message) override
+    {
+        whats.push_back(message.what);
+    }
+
+    std::vector<int32_t> whats;
+};
+
+// Work posted in random order runs by fire time, and in posting order for equal fire times.
+static void testFireTimeOrder()
+{
+    std::shared_ptr<Handler> handler = Handler::create();
+    std::vector<Dispatch> dispatches;
+    std::mt19937 random(1);
+
+    std::chrono::nanoseconds start = SystemClock::uptimeNanos();
+    for (int32_t i = 0; i < 1000; ++i) {
+        std::chrono::nanoseconds fireTime = start + std::chrono::milliseconds(random() % 100);
+        handler->postAtTime([&dispatches, i, fireTime] {
+            dispatches.push_back({ i, fireTime, SystemClock::uptimeNanos() });
+        }, fireTime);
+    }
+    Looper::myLooper()->runToEndOfTasks();
+
+    EXPECT(dispatches.size() == 1000);
+    for (size_t i = 0; i < dispatches.size(); ++i) {
+        EXPECT(dispatches[i].time == dispatches[i].fireTime);
+        if (!i)
+            continue;
+        EXPECT(dispatches[i - 1].fireTime <= dispatches[i].fireTime);
+        if (dispatches[i - 1].fireTime == dispatches[i].fireTime)
+            EXPECT(dispatches[i - 1].index < dispatches[i].index);
+    }
+}
+
+// All Handlers of a thread share one queue, so their work interleaves by fire time.
+static void testHandlersShareQueue()
+{
+    std::shared_ptr<Handler> first = Handler::create();
+    std::shared_ptr<Handler> second = Handler::create();
+    std::vector<int32_t> order;
+
+    first->postDelayed([&order] { order.push_back(3); }, std::chrono::milliseconds(30));
+    second->postDelayed([&order] { order.push_back(1); }, std::chrono::milliseconds(10));
+    first->postDelayed([&order] { order.push_back(2); }, std::chrono::milliseconds(20));
+    second->post([&order] { order.push_back(0); });
+    Looper::myLooper()->runToEndOfTasks();
+
+    EXPECT(order == std::vector<int32_t>({ 0, 1, 2, 3 }));
+}
+
+// Removed work never runs, whether it is at the top of the heap or deep inside it.
+static void testRemoval()
+{
+    std::shared_ptr<Handler> handler = Handler::create();
+    std::vector<Handler::Token> tokens;
+    std::vector<int32_t> ran;
+
+    for (int32_t i = 0; i < 300; ++i)
+        tokens.push_back(handler->postDelayed([&ran, i] { ran.push_back(i); }, std::chrono::milliseconds(300 - i)));
+    for (int32_t i = 0; i < 300; i += 3)
+        handler->removeCallbacks(tokens[i]);
+    Looper::myLooper()->runToEndOfTasks();
+
+    EXPECT(ran.size() == 200);
+    for (size_t i = 0; i < ran.size(); ++i) {
+        EXPECT(ran[i] % 3);
+        if (i)
+            EXPECT(ran[i - 1] > ran[i]);
+    }
+}
+
+// Messages are removed by what, only from the Handler they were sent to, and the front of the queue goes first.
+static void testMessages()
+{
+    std::shared_ptr<RecordingHandler> handler = std::make_shared<RecordingHandler>();
+    std::shared_ptr<RecordingHandler> other = std::make_shared<RecordingHandler>();
+
+    handler->sendEmptyMessage(1);
+    handler->sendEmptyMessageDelayed(2, std::chrono::milliseconds(5));
+    other->sendEmptyMessage(2);
+    handler->sendEmptyMessage(3);
+    Message front = handler->obtainMessage(4);
+    handler->sendMessageAtFrontOfQueue(front);
+    EXPECT(handler->hasMessages(2));
+    handler->removeMessages(2);
+    EXPECT(!handler->hasMessages(2));
+    EXPECT(other->hasMessages(2));
+    Looper::myLooper()->runToEndOfTasks();
+
+    EXPECT(handler->whats == std::vector<int32_t>({ 4, 1, 3 }));
+    EXPECT(other->whats == std::vector<int32_t>({ 2 }));
+}
+
+int main()
+{
+    SystemClock::setVirtualTimeEnabled(true);
+    Looper::prepareMainLooper();
+
+    testFireTimeOrder();
+    testHandlersShareQueue();
+    testRemoval();
+    testMessages();
+
+    return testResult("MessageQueueTest");
+}
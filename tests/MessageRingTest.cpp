@@ -0,0 +1,236 @@
+/*
+ * Copyright (C) 2016 Naver Corp. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "TestHelper.h"
+
+#include <android/os/Handler.h>
+#include <android/os/Looper.h>
+#include <android/os/MessageRing.h>
+#include <android/os/Messenger.h>
+
+#include <atomic>
+#include <functional>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+
+using android::os::MessageRing;
+
+// The layout of the shared memory, to write frames as a misbehaving peer would.
+static const size_t tailOffset = 64;
+static const size_t consumerParkedOffset = 128;
+static const size_t dataOffset = 192;
+
+class FunctionHandler : public Handler {
+public:
+    explicit FunctionHandler(std::function<void (Message&)> function)
+        : m_function(std::move(function))
+    {
+    }
+
+    void handleMessage(Message& message) override { m_function(message); }
+
+private:
+    std::function<void (Message&)> m_function;
+};
+
+// Opens the consumer end of ring from duplicates of its descriptors, as the process on the other end would.
+static std::shared_ptr<MessageRing> openConsumer(MessageRing& ring, Bundle& descriptors)
+{
+    ring.writeToBundle(descriptors, L"ring");
+    Bundle duplicates;
+    for (const String& key : descriptors.keySet())
+        duplicates.putFileDescriptor(key, ::dup(descriptors.getFileDescriptor(key)));
+    return MessageRing::open(duplicates, L"ring");
+}
+
+// Runs the Looper of the thread until finish is called, or the messages did not all arrive in time. The ring
+// is closed from within the loop, since its Looper is gone once loop() returns.
+static void loopUntilFinished(MessageRing& consumer, std::function<void ()>& finish)
+{
+    std::shared_ptr<Handler> timeout = Handler::create();
+    finish = [&consumer] {
+        consumer.close();
+        Looper::myLooper()->quit();
+    };
+    timeout->postDelayed([&finish] { finish(); }, std::chrono::seconds(10));
+    Looper::loop();
+}
+
+// Messages arrive in order with their fields and Bundles, across the wrap around of the ring, including
+// those which waited in the backlog for the consumer to make room.
+static void testRoundTrip()
+{
+    std::shared_ptr<MessageRing> producer = MessageRing::create(4096);
+    Bundle descriptors;
+    std::shared_ptr<MessageRing> consumer = openConsumer(*producer, descriptors);
+    EXPECT(producer && consumer);
+    if (!producer || !consumer)
+        return;
+
+    const int32_t count = 2000;
+    int32_t received = 0;
+    bool valid = true;
+    std::function<void ()> finish;
+    std::shared_ptr<Handler> handler = std::make_shared<FunctionHandler>([&] (Message& message) {
+        valid &= message.what == 1 && message.arg1 == received && message.arg2 == -received && message.obj == received * 3;
+        valid &= message.getRequestId() == received + 1;
+        valid &= message.getData().getString(L"string") == std::to_wstring(received);
+        valid &= message.getData().getIntArray(L"values").size() == static_cast<size_t>(received % 64);
+        if (++received == count)
+            finish();
+    });
+    EXPECT(consumer->receive(handler));
+
+    // Everything is sent before the loop drains anything, so most of it waits in the backlog.
+    for (int32_t i = 0; i < count; ++i) {
+        Message message = Message::obtain(nullptr, 1, i, -i, i * 3);
+        message.setRequestId(i + 1);
+        message.getData().putString(L"string", std::to_wstring(i));
+        message.getData().putIntArray(L"values", std::vector<int32_t>(i % 64, i));
+        producer->send(message, nullptr);
+    }
+    loopUntilFinished(*consumer, finish);
+
+    EXPECT(received == count);
+    EXPECT(valid);
+    producer->close();
+}
+
+// Messages which cannot go through the ring, with descriptors or too large for it, go through the
+// fallback Messenger, but are still delivered in the order they were sent.
+static void testFallbackOrder()
+{
+    std::shared_ptr<MessageRing> producer = MessageRing::create(4096);
+    Bundle descriptors;
+    std::shared_ptr<MessageRing> consumer = openConsumer(*producer, descriptors);
+    EXPECT(producer && consumer);
+    if (!producer || !consumer)
+        return;
+
+    const int32_t count = 500;
+    int32_t received = 0;
+    int32_t receivedAround = 0;
+    bool inOrder = true;
+    std::function<void ()> finish;
+    std::shared_ptr<Handler> handler = std::make_shared<FunctionHandler>([&] (Message& message) {
+        inOrder &= message.arg1 == received;
+        // A Messenger within the process passes descriptors by number, which the ring may have closed already.
+        if (message.what == 2)
+            inOrder &= message.getData().getFileDescriptor(L"fd") >= 0;
+        if (message.what == 3)
+            inOrder &= message.getData().getString(L"string").size() == 4096;
+        if (++received == count)
+            finish();
+    });
+    std::shared_ptr<Handler> fallbackHandler = std::make_shared<FunctionHandler>([&] (Message& message) {
+        ++receivedAround;
+        consumer->receiveFallback(message);
+    });
+    std::shared_ptr<Messenger> fallback = std::make_shared<Messenger>(fallbackHandler);
+    EXPECT(consumer->receive(handler));
+
+    for (int32_t i = 0; i < count; ++i) {
+        Message message = Message::obtain(nullptr, 1, i, 0);
+        if (i % 50 == 7) {
+            int32_t fd = ::dup(STDIN_FILENO);
+            message.what = 2;
+            message.getData().putFileDescriptor(L"fd", fd);
+            producer->send(message, fallback);
+            // The ring keeps descriptors of its own for messages which wait in the backlog.
+            ::close(fd);
+            continue;
+        }
+        if (i % 50 == 31) {
+            message.what = 3;
+            message.getData().putString(L"string", String(4096, L's'));
+        }
+        producer->send(message, fallback);
+    }
+    loopUntilFinished(*consumer, finish);
+
+    EXPECT(received == count);
+    EXPECT(receivedAround == 20);
+    EXPECT(inOrder);
+    producer->close();
+}
+
+// A frame whose Bundle would reach past the frame closes the ring instead of being read.
+static void testMalformedFrame()
+{
+    std::shared_ptr<MessageRing> producer = MessageRing::create(4096);
+    Bundle descriptors;
+    std::shared_ptr<MessageRing> consumer = openConsumer(*producer, descriptors);
+    EXPECT(producer && consumer);
+    if (!producer || !consumer)
+        return;
+
+    int32_t memory = descriptors.getFileDescriptor(L"ring.memory");
+    struct stat status;
+    EXPECT(!::fstat(memory, &status));
+    char* address = static_cast<char*>(::mmap(nullptr, status.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, memory, 0));
+    EXPECT(address != MAP_FAILED);
+    if (address == MAP_FAILED)
+        return;
+
+    int32_t received = 0;
+    std::shared_ptr<Handler> handler = std::make_shared<FunctionHandler>([&] (Message&) { ++received; });
+    EXPECT(consumer->receive(handler));
+
+    // A frame of 48 bytes claiming a Bundle of 100, published and signalled like the producer does.
+    uint32_t frame[12] = { 48, 100 };
+    memcpy(address + dataOffset, frame, sizeof(frame));
+    reinterpret_cast<std::atomic<uint64_t>*>(address + tailOffset)->store(sizeof(frame));
+    if (reinterpret_cast<std::atomic<uint32_t>*>(address + consumerParkedOffset)->exchange(0)) {
+        uint64_t one = 1;
+        EXPECT(::write(descriptors.getFileDescriptor(L"ring.consumer"), &one, sizeof(one)) == sizeof(one));
+    }
+
+    bool closed = false;
+    std::shared_ptr<Handler> check = Handler::create();
+    check->postDelayed([&] {
+        closed = !consumer->isReceiving();
+        consumer->close();
+        Looper::myLooper()->quit();
+    }, std::chrono::milliseconds(100));
+    Looper::loop();
+
+    EXPECT(!received);
+    EXPECT(closed);
+    ::munmap(address, status.st_size);
+    producer->close();
+}
+
+// Each test runs on a thread of its own, as the Looper of a thread is gone once loop() returns.
+int main()
+{
+    std::thread(testRoundTrip).join();
+    std::thread(testFallbackOrder).join();
+    std::thread(testMalformedFrame).join();
+
+    return testResult("MessageRingTest");
+}
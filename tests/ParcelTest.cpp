@@ -0,0 +1,155 @@
+/*
+ * Copyright (C) 2016 Naver Corp. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "TestHelper.h"
+
+#include <android/os/Parcel.h>
+
+#include <string.h>
+
+// Values read back the way they were written, each padded to 4 bytes.
+static void testTypedRoundTrip()
+{
+    const uint8_t blob[5] = { 1, 2, 3, 4, 5 };
+
+    Parcel parcel;
+    parcel.writeInt32(-1);
+    parcel.writeInt64(INT64_MIN);
+    parcel.writeFloat(0.25f);
+    parcel.writeDouble(-1e300);
+    parcel.writeString16(String());
+    parcel.writeString16(String(L"parcel"));
+    // Korean within the BMP, and an emoji which takes a surrogate pair in UTF-16.
+    parcel.writeString16(String(L"한글 \U0001F600"));
+    parcel.writeBlob(blob, sizeof(blob));
+    parcel.writeFileDescriptor(3);
+    parcel.writeInt32(42);
+    EXPECT(parcel.dataSize() % 4 == 0);
+    EXPECT(parcel.dataPosition() == parcel.dataSize());
+    EXPECT(parcel.fileDescriptors().size() == 1);
+
+    parcel.setDataPosition(0);
+    EXPECT(parcel.readInt32() == -1);
+    EXPECT(parcel.readInt64() == INT64_MIN);
+    EXPECT(parcel.readFloat() == 0.25f);
+    EXPECT(parcel.readDouble() == -1e300);
+    EXPECT(parcel.readString16().empty());
+    EXPECT(parcel.readString16() == L"parcel");
+    EXPECT(parcel.readString16() == L"한글 \U0001F600");
+    size_t blobSize;
+    const void* readBlob = parcel.readBlob(&blobSize);
+    EXPECT(readBlob && blobSize == sizeof(blob) && !memcmp(readBlob, blob, sizeof(blob)));
+    EXPECT(parcel.readFileDescriptor() == 3);
+    EXPECT(parcel.readInt32() == 42);
+    EXPECT(!parcel.dataAvail());
+}
+
+// Reads of data set with setDataReference() point into it, and writing copies it first.
+static void testInplaceReads()
+{
+    Parcel source;
+    source.writeString16(String(L"in place"));
+    const uint8_t blob[3] = { 7, 8, 9 };
+    source.writeBlob(blob, sizeof(blob));
+
+    Parcel parcel;
+    parcel.setDataReference(source.data(), source.dataSize());
+    size_t length;
+    const char16_t* string = parcel.readString16Inplace(&length);
+    EXPECT(length == 8);
+    EXPECT(reinterpret_cast<const uint8_t*>(string) == source.data() + sizeof(int32_t));
+    EXPECT(string && string[0] == u'i' && !string[length]);
+    size_t blobSize;
+    const void* readBlob = parcel.readBlob(&blobSize);
+    EXPECT(blobSize == sizeof(blob));
+    EXPECT(readBlob > static_cast<const void*>(source.data()) && readBlob < static_cast<const void*>(source.data() + source.dataSize()));
+
+    std::vector<uint8_t> original(source.data(), source.data() + source.dataSize());
+    parcel.setDataPosition(0);
+    parcel.writeInt32(-1);
+    EXPECT(parcel.data() != source.data());
+    EXPECT(!memcmp(source.data(), original.data(), original.size()));
+    EXPECT(parcel.dataSize() == source.dataSize());
+    parcel.setDataPosition(0);
+    EXPECT(parcel.readInt32() == -1);
+}
+
+// Writes go into the buffer of the caller until it is full, then move into a buffer of the parcel.
+static void testCallerBuffer()
+{
+    uint32_t buffer[4];
+    Parcel parcel;
+    parcel.setDataBuffer(buffer, sizeof(buffer));
+    for (int32_t i = 0; i < 4; ++i)
+        parcel.writeInt32(i);
+    EXPECT(parcel.data() == reinterpret_cast<uint8_t*>(buffer));
+
+    parcel.writeInt32(4);
+    EXPECT(parcel.data() != reinterpret_cast<uint8_t*>(buffer));
+    parcel.setDataPosition(0);
+    bool valid = true;
+    for (int32_t i = 0; i < 5; ++i)
+        valid &= parcel.readInt32() == i;
+    EXPECT(valid);
+}
+
+// Reads past the data or of malformed values fail without moving the position.
+static void testMalformedReads()
+{
+    Parcel parcel;
+    parcel.writeInt32(1000);
+    parcel.writeInt32(0x00610061);
+    parcel.setDataPosition(0);
+
+    size_t length;
+    EXPECT(!parcel.readString16Inplace(&length) && !length);
+    EXPECT(parcel.dataPosition() == 0);
+    size_t size;
+    EXPECT(!parcel.readBlob(&size) && !size);
+    EXPECT(parcel.dataPosition() == 0);
+    EXPECT(parcel.readFileDescriptor() == -1);
+
+    // A string of one character whose terminator is missing.
+    Parcel unterminated;
+    unterminated.writeInt32(1);
+    unterminated.writeInt32(0x00620061);
+    unterminated.setDataPosition(0);
+    EXPECT(!unterminated.readString16Inplace(&length));
+    EXPECT(unterminated.readString16().empty());
+
+    Parcel empty;
+    EXPECT(!empty.readInplace(4));
+    EXPECT(!empty.readInt32() && !empty.readInt64() && !empty.readDouble());
+}
+
+int main()
+{
+    testTypedRoundTrip();
+    testInplaceReads();
+    testCallerBuffer();
+    testMalformedReads();
+
+    return testResult("ParcelTest");
+}
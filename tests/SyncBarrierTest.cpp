@@ -0,0 +1,118 @@
+/*
+ * Copyright (C) 2016 Naver Corp. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "TestHelper.h"
+
+#include <android/os/Handler.h>
+#include <android/os/Looper.h>
+#include <android/os/Message.h>
+#include <android/os/MessageQueue.h>
+#include <android/os/SystemClock.h>
+
+#include <string>
+
+class RecordingHandler : public Handler {
+public:
+    void handleMessage(Message& message) override
+    {
+        log += (message.isAsynchronous() ? "async" : "sync") + std::to_string(message.what) + " ";
+    }
+
+    std::string log;
+};
+
+// Synchronous work posted before a barrier still runs, later synchronous work waits for its removal,
+// and asynchronous work runs right through it.
+static void testBarrierHoldsBackSynchronousWork()
+{
+    std::shared_ptr<RecordingHandler> handler = std::make_shared<RecordingHandler>();
+    MessageQueue& queue = Looper::myQueue();
+
+    handler->sendEmptyMessage(1);
+    int32_t barrier = queue.postSyncBarrier();
+    handler->sendEmptyMessage(2);
+    Message asynchronous = handler->obtainMessage(3);
+    asynchronous.setAsynchronous(true);
+    handler->sendMessage(asynchronous);
+    Looper::myLooper()->idle();
+    EXPECT(handler->log == "sync1 async3 ");
+
+    queue.removeSyncBarrier(barrier);
+    Looper::myLooper()->idle();
+    EXPECT(handler->log == "sync1 async3 sync2 ");
+}
+
+// Delayed synchronous work due after the barrier waits too, even if it was posted before it,
+// while delayed work of an asynchronous Handler runs at its fire time.
+static void testBarrierHoldsBackDelayedWork()
+{
+    std::shared_ptr<Handler> handler = Handler::create();
+    std::shared_ptr<Handler> asyncHandler = Handler::createAsync();
+    MessageQueue& queue = Looper::myQueue();
+    std::string log;
+
+    handler->postDelayed([&log] { log += "sync "; }, std::chrono::milliseconds(10));
+    int32_t barrier = queue.postSyncBarrier();
+    asyncHandler->postDelayed([&log] { log += "async "; }, std::chrono::milliseconds(20));
+    Looper::myLooper()->idleFor(std::chrono::milliseconds(30));
+    EXPECT(log == "async ");
+
+    queue.removeSyncBarrier(barrier);
+    Looper::myLooper()->idle();
+    EXPECT(log == "async sync ");
+}
+
+// Synchronous work waits until every barrier it is behind is removed.
+static void testNestedBarriers()
+{
+    std::shared_ptr<Handler> handler = Handler::create();
+    MessageQueue& queue = Looper::myQueue();
+    bool ran = false;
+
+    int32_t outer = queue.postSyncBarrier();
+    int32_t inner = queue.postSyncBarrier();
+    EXPECT(outer != inner);
+    handler->post([&ran] { ran = true; });
+
+    queue.removeSyncBarrier(inner);
+    Looper::myLooper()->idle();
+    EXPECT(!ran);
+
+    queue.removeSyncBarrier(outer);
+    Looper::myLooper()->idle();
+    EXPECT(ran);
+}
+
+int main()
+{
+    SystemClock::setVirtualTimeEnabled(true);
+    Looper::prepareMainLooper();
+
+    testBarrierHoldsBackSynchronousWork();
+    testBarrierHoldsBackDelayedWork();
+    testNestedBarriers();
+
+    return testResult("SyncBarrierTest");
+}
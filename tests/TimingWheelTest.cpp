@@ -0,0 +1,117 @@
+/*
+ * Copyright (C) 2016 Naver Corp. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "TestHelper.h"
+
+#include <android/os/Handler.h>
+#include <android/os/Looper.h>
+#include <android/os/SystemClock.h>
+
+#include <random>
+#include <vector>
+
+struct Dispatch {
+    int32_t index;
+    std::chrono::nanoseconds fireTime;
+    std::chrono::nanoseconds time;
+};
+
+static void expectInOrder(const std::vector<Dispatch>& dispatches)
+{
+    for (size_t i = 0; i < dispatches.size(); ++i) {
+        EXPECT(dispatches[i].time == dispatches[i].fireTime);
+        if (!i)
+            continue;
+        EXPECT(dispatches[i - 1].fireTime <= dispatches[i].fireTime);
+        if (dispatches[i - 1].fireTime == dispatches[i].fireTime)
+            EXPECT(dispatches[i - 1].index < dispatches[i].index);
+    }
+}
+
+// Work held by the wheel still runs exactly at its fire time, in the same order as from the heaps,
+// whether it is due within milliseconds or hours, and whatever is cancelled never runs.
+static void testFireTimeOrder()
+{
+    Looper::myLooper()->setTimingWheelEnabled(true);
+    std::shared_ptr<Handler> handler = Handler::create();
+    std::vector<Dispatch> dispatches;
+    std::vector<Handler::Token> tokens;
+    std::mt19937 random(1);
+
+    std::chrono::nanoseconds start = SystemClock::uptimeNanos();
+    for (int32_t i = 0; i < 10000; ++i) {
+        // Spread over every level of the wheel, with some fire times shared.
+        std::chrono::nanoseconds fireTime = start + std::chrono::milliseconds((random() % 1000) << (random() % 24) >> 10);
+        tokens.push_back(handler->postAtTime([&dispatches, i, fireTime] {
+            dispatches.push_back({ i, fireTime, SystemClock::uptimeNanos() });
+        }, fireTime));
+    }
+    for (size_t i = 0; i < tokens.size(); i += 2)
+        handler->removeCallbacks(tokens[i]);
+    Looper::myLooper()->runToEndOfTasks();
+
+    EXPECT(dispatches.size() == 5000);
+    for (const Dispatch& dispatch : dispatches)
+        EXPECT(dispatch.index % 2);
+    expectInOrder(dispatches);
+}
+
+// Work moves between the wheel and the heaps when the wheel is turned on or off, without changing its order.
+static void testToggling()
+{
+    std::shared_ptr<Handler> handler = Handler::create();
+    std::vector<Dispatch> dispatches;
+
+    Looper::myLooper()->setTimingWheelEnabled(false);
+    std::chrono::nanoseconds start = SystemClock::uptimeNanos();
+    for (int32_t i = 0; i < 1000; ++i) {
+        std::chrono::nanoseconds fireTime = start + std::chrono::seconds((i * 7919) % 1000);
+        handler->postAtTime([&dispatches, i, fireTime] {
+            dispatches.push_back({ i, fireTime, SystemClock::uptimeNanos() });
+        }, fireTime);
+        if (i == 500)
+            Looper::myLooper()->setTimingWheelEnabled(true);
+    }
+
+    Looper::myLooper()->idleFor(std::chrono::seconds(300));
+    Looper::myLooper()->setTimingWheelEnabled(false);
+    Looper::myLooper()->idleFor(std::chrono::seconds(300));
+    Looper::myLooper()->setTimingWheelEnabled(true);
+    Looper::myLooper()->runToEndOfTasks();
+
+    EXPECT(dispatches.size() == 1000);
+    expectInOrder(dispatches);
+}
+
+int main()
+{
+    SystemClock::setVirtualTimeEnabled(true);
+    Looper::prepareMainLooper();
+
+    testFireTimeOrder();
+    testToggling();
+
+    return testResult("TimingWheelTest");
+}